@@ -0,0 +1,81 @@
+#!/usr/bin/env python2
+# Copyright (c) 2019 The papara developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Benchmark getblocktemplate with a filled mempool.
+# Times a template built from scratch after a new block, repeated calls
+# with an unchanged mempool, and calls after single transactions enter
+# the pool, which only extend the previous transaction selection.
+#
+
+from test_framework import BitcoinTestFramework
+from util import *
+import time
+
+NUM_MEMPOOL_TXS = 1000
+NUM_CALLS = 50
+
+def median(values):
+    values = sorted(values)
+    return values[len(values) / 2]
+
+class GetBlockTemplateLatencyTest(BitcoinTestFramework):
+
+    def setup_network(self):
+        args = ["-debug=bench", "-maxtxfee=1", "-limitfreerelay=1000"]
+        self.nodes = []
+        self.nodes.append(start_node(0, self.options.tmpdir, args))
+        self.is_network_split = False
+
+    def timed_template(self):
+        start = time.time()
+        templat = self.nodes[0].getblocktemplate()
+        return (time.time() - start) * 1000, templat
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        # split the mature coins into many outputs so the mempool can be filled
+        outputs = {}
+        for i in range(100):
+            outputs[node.getnewaddress()] = 10
+        node.sendmany("", outputs)
+        node.setgenerate(True, 1)
+
+        print "Filling the mempool with %d transactions..." % NUM_MEMPOOL_TXS
+        address = node.getnewaddress()
+        for i in range(NUM_MEMPOOL_TXS):
+            node.sendtoaddress(address, 0.01)
+        assert_equal(len(node.getrawmempool()), NUM_MEMPOOL_TXS)
+
+        # new template after a block: the selection is built from scratch
+        full_ms, templat = self.timed_template()
+        ntxs = len(templat['transactions'])
+        assert(ntxs > 0)
+
+        # unchanged mempool: the selection is reused as it is
+        reuse = []
+        for i in range(NUM_CALLS):
+            ms, templat = self.timed_template()
+            reuse.append(ms)
+        assert_equal(len(templat['transactions']), ntxs)
+
+        # one more transaction each time: the selection is extended
+        extend = []
+        for i in range(NUM_CALLS):
+            txid = node.sendtoaddress(address, 0.01)
+            ms, templat = self.timed_template()
+            extend.append(ms)
+            if ntxs < NUM_MEMPOOL_TXS:
+                continue
+            assert(txid in [tx['hash'] for tx in templat['transactions']])
+
+        print "getblocktemplate with %d transactions in the template:" % len(templat['transactions'])
+        print "  new tip:          %8.2f ms" % full_ms
+        print "  unchanged pool:   %8.2f ms (median of %d)" % (median(reuse), NUM_CALLS)
+        print "  one tx added:     %8.2f ms (median of %d)" % (median(extend), NUM_CALLS)
+
+if __name__ == '__main__':
+    GetBlockTemplateLatencyTest().main()
@@ -0,0 +1,63 @@
+#!/usr/bin/env python2
+# Copyright (c) 2019 The papara developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Benchmark -reindex and a wallet rescan with block files read through
+# stdio (-blockmmap=0) and through memory mappings (-blockmmap=1), and
+# -reindex with the blocks decoded on the import thread (-reindexthreads=-64)
+# and by the decoding pipeline.
+#
+
+from test_framework import BitcoinTestFramework
+from util import *
+import time
+
+NUM_BLOCKS = 1000
+
+class ReindexThroughputTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = []
+        self.is_network_split = False
+        self.nodes.append(start_node(0, self.options.tmpdir))
+
+    def restart(self, args):
+        stop_node(self.nodes[0], 0)
+        wait_bitcoinds()
+        start = time.time()
+        self.nodes[0] = start_node(0, self.options.tmpdir, args)
+        while self.nodes[0].getblockcount() < NUM_BLOCKS:
+            time.sleep(0.05)
+        return time.time() - start
+
+    def run_test(self):
+        self.nodes[0].setgenerate(True, NUM_BLOCKS)
+        assert_equal(self.nodes[0].getblockcount(), NUM_BLOCKS)
+        tip = self.nodes[0].getbestblockhash()
+
+        results = []
+        for mmap in [0, 1]:
+            reindex = self.restart(["-reindex", "-blockmmap=%d" % mmap, "-reindexthreads=-64"])
+            assert_equal(self.nodes[0].getbestblockhash(), tip)
+            rescan = self.restart(["-rescan", "-blockmmap=%d" % mmap])
+            results.append(("-blockmmap=%d" % mmap, reindex, rescan))
+        for threads in [1, 0]:
+            reindex = self.restart(["-reindex", "-reindexthreads=%d" % threads])
+            assert_equal(self.nodes[0].getbestblockhash(), tip)
+            results.append(("-reindexthreads=%d" % threads, reindex, None))
+
+        print "%d blocks:" % NUM_BLOCKS
+        for (args, reindex, rescan) in results:
+            line = "  %-18s reindex %6.2fs (%7.1f blocks/s)" % (args + ":", reindex, NUM_BLOCKS / reindex)
+            if rescan is not None:
+                line += ", rescan %6.2fs" % rescan
+            print line
+
+if __name__ == '__main__':
+    ReindexThroughputTest().main()
@@ -0,0 +1,151 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "util.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** Largest gap between two reads that still counts as reading sequentially */
+static const uint64_t SEQUENTIAL_READ_GAP = 0x100000; // 1 MiB
+
+CBlockFileMap blockFileMap;
+
+CMappedBlockFile::CMappedBlockFile() : pbegin(NULL), nSize(0), nLastEnd(0), nPrefetched(0)
+{
+}
+
+CMappedBlockFile::~CMappedBlockFile()
+{
+#ifndef WIN32
+    if (pbegin)
+        munmap((void*)pbegin, nSize);
+#endif
+}
+
+bool CMappedBlockFile::Map(const boost::filesystem::path& path)
+{
+#ifdef WIN32
+    return false;
+#else
+    assert(pbegin == NULL);
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t)st.st_size != (size_t)st.st_size) {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (p == MAP_FAILED) {
+        LogPrintf("%s : unable to map %s (%s)\n", __func__, path.string(), strerror(errno));
+        return false;
+    }
+    pbegin = (const char*)p;
+    nSize = st.st_size;
+    return true;
+#endif
+}
+
+void CMappedBlockFile::NoteRead(uint64_t nPos, uint64_t nLength) const
+{
+#ifndef WIN32
+    uint64_t nEnd = nPos + nLength;
+    uint64_t nFrom, nTo;
+    {
+        LOCK(cs);
+        bool fSequential = nPos >= nLastEnd && nPos - nLastEnd <= SEQUENTIAL_READ_GAP;
+        nLastEnd = nEnd;
+        // one call per half window, not one per block
+        if (!fSequential || nPrefetched >= nEnd + BLOCKFILE_READAHEAD_SIZE / 2 || nEnd >= nSize)
+            return;
+        nFrom = std::max(nEnd, nPrefetched);
+        nTo = std::min((uint64_t)nSize, nEnd + BLOCKFILE_READAHEAD_SIZE);
+        nPrefetched = nTo;
+    }
+    // madvise wants a page aligned start
+    static const uint64_t nPageSize = sysconf(_SC_PAGESIZE);
+    nFrom -= nFrom % nPageSize;
+    if (nTo > nFrom)
+        madvise((void*)(pbegin + nFrom), nTo - nFrom, MADV_WILLNEED);
+#endif
+}
+
+CBlockFileMap::CBlockFileMap() : nMaxFiles(sizeof(void*) >= 8 ? 8 : 2), fEnabled(DEFAULT_BLOCK_MMAP)
+{
+}
+
+void CBlockFileMap::SetEnabled(bool fEnabledIn)
+{
+    LOCK(cs);
+    fEnabled = fEnabledIn;
+    if (!fEnabled) {
+        lru.clear();
+        mapFiles.clear();
+    }
+}
+
+bool CBlockFileMap::IsEnabled() const
+{
+    LOCK(cs);
+    return fEnabled;
+}
+
+CMappedBlockFileRef CBlockFileMap::Get(int nFile, const boost::filesystem::path& path, uint64_t nMinSize)
+{
+    LOCK(cs);
+    if (!fEnabled)
+        return CMappedBlockFileRef();
+
+    std::map<int, CEntry>::iterator it = mapFiles.find(nFile);
+    if (it != mapFiles.end()) {
+        if (it->second.file->size() >= nMinSize) {
+            lru.splice(lru.begin(), lru, it->second.itLru);
+            return it->second.file;
+        }
+        // the file grew since it was mapped
+        lru.erase(it->second.itLru);
+        mapFiles.erase(it);
+    }
+
+    boost::shared_ptr<CMappedBlockFile> file(new CMappedBlockFile());
+    if (!file->Map(path) || file->size() < nMinSize)
+        return CMappedBlockFileRef();
+
+    while (mapFiles.size() >= nMaxFiles) {
+        mapFiles.erase(lru.back());
+        lru.pop_back();
+    }
+    lru.push_front(nFile);
+    CEntry& entry = mapFiles[nFile];
+    entry.file = file;
+    entry.itLru = lru.begin();
+    return file;
+}
+
+void CBlockFileMap::Erase(int nFile)
+{
+    LOCK(cs);
+    std::map<int, CEntry>::iterator it = mapFiles.find(nFile);
+    if (it != mapFiles.end()) {
+        lru.erase(it->second.itLru);
+        mapFiles.erase(it);
+    }
+}
+
+void CBlockFileMap::Clear()
+{
+    LOCK(cs);
+    lru.clear();
+    mapFiles.clear();
+}
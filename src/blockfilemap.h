@@ -0,0 +1,103 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEMAP_H
+#define BITCOIN_BLOCKFILEMAP_H
+
+#include "sync.h"
+
+#include <list>
+#include <map>
+#include <stdint.h>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/shared_ptr.hpp>
+
+/** Default for -blockmmap */
+static const bool DEFAULT_BLOCK_MMAP = true;
+/** Bytes of a block file prefetched ahead of a sequential reader */
+static const unsigned int BLOCKFILE_READAHEAD_SIZE = 0x800000; // 8 MiB
+
+/**
+ * A read-only memory mapping of a whole block file, as long as the file was
+ * when it got mapped. Readers deserialize straight from the mapped memory, so
+ * reading a block costs no system calls once its pages are resident.
+ */
+class CMappedBlockFile
+{
+private:
+    // Disallow copies
+    CMappedBlockFile(const CMappedBlockFile&);
+    CMappedBlockFile& operator=(const CMappedBlockFile&);
+
+    const char* pbegin;
+    size_t nSize;
+
+    //! end of the last read, to detect sequential readers
+    mutable CCriticalSection cs;
+    mutable uint64_t nLastEnd;
+    mutable uint64_t nPrefetched;
+
+public:
+    CMappedBlockFile();
+    ~CMappedBlockFile();
+
+    bool Map(const boost::filesystem::path& path);
+
+    const char* begin() const { return pbegin; }
+    size_t size() const { return nSize; }
+
+    /**
+     * Note a read of [nPos, nPos + nLength). When it continues where the previous
+     * read ended, ask the kernel to page in the BLOCKFILE_READAHEAD_SIZE bytes
+     * that follow, so the next reads find their data resident.
+     */
+    void NoteRead(uint64_t nPos, uint64_t nLength) const;
+};
+
+typedef boost::shared_ptr<const CMappedBlockFile> CMappedBlockFileRef;
+
+/**
+ * Least recently used set of mapped block files, shared by all block readers.
+ * A reader holds a reference to its mapping, so evicting a file from the set
+ * never invalidates memory that is still being deserialized.
+ */
+class CBlockFileMap
+{
+private:
+    struct CEntry {
+        CMappedBlockFileRef file;
+        std::list<int>::iterator itLru;
+    };
+
+    mutable CCriticalSection cs;
+    size_t nMaxFiles;
+    bool fEnabled;
+    std::list<int> lru; // most recently used first
+    std::map<int, CEntry> mapFiles;
+
+public:
+    CBlockFileMap();
+
+    //! turn mapping on or off; when off, Get always fails and callers fall back to stdio
+    void SetEnabled(bool fEnabledIn);
+    bool IsEnabled() const;
+
+    /**
+     * Return the mapping of block file nFile, mapping it (again) if it is not
+     * in the set or was mapped when it was shorter than nMinSize bytes.
+     * Returns an empty reference if the file cannot be mapped that far.
+     */
+    CMappedBlockFileRef Get(int nFile, const boost::filesystem::path& path, uint64_t nMinSize);
+
+    //! forget the mapping of block file nFile, e.g. because the file was truncated
+    void Erase(int nFile);
+
+    //! forget all mappings
+    void Clear();
+};
+
+extern CBlockFileMap blockFileMap;
+
+#endif // BITCOIN_BLOCKFILEMAP_H
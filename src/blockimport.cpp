@@ -0,0 +1,191 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+
+#include "clientversion.h"
+#include "crypto/common.h"
+#include "streams.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <boost/bind.hpp>
+
+CBlockImportPipeline::CBlockImportPipeline(const CMappedBlockFileRef& fileIn, const unsigned char* pchMessageStartIn, int nThreads) : file(fileIn), nScanPos(0), fScanDone(false), nGeneration(0), fStop(false)
+{
+    memcpy(pchMessageStart, pchMessageStartIn, sizeof(pchMessageStart));
+    threads.create_thread(boost::bind(&CBlockImportPipeline::ThreadRead, this));
+    for (int i = 0; i < nThreads; i++)
+        threads.create_thread(boost::bind(&CBlockImportPipeline::ThreadDecode, this));
+}
+
+CBlockImportPipeline::~CBlockImportPipeline()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fStop = true;
+    }
+    condReader.notify_all();
+    condWorker.notify_all();
+    threads.join_all();
+}
+
+void CBlockImportPipeline::ThreadRead()
+{
+    RenameThread("papara-reindex-read");
+    const unsigned char* pbegin = (const unsigned char*)file->begin();
+    const uint64_t nFileSize = file->size();
+    while (true) {
+        uint64_t nPos;
+        int nGen;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (!fStop && (fScanDone || queue.size() >= REINDEX_QUEUE_SIZE))
+                condReader.wait(lock);
+            if (fStop)
+                return;
+            nPos = nScanPos;
+            nGen = nGeneration;
+        }
+
+        // locate the next block the way the serial scanner in LoadExternalBlockFile does
+        int64_t nTimeStart = GetTimeMicros();
+        CImportedBlockRef item;
+        uint64_t nNext = nFileSize;
+        while (nPos < nFileSize) {
+            const unsigned char* p = (const unsigned char*)memchr(pbegin + nPos, pchMessageStart[0], nFileSize - nPos);
+            if (!p || (uint64_t)(p - pbegin) + 8 > nFileSize)
+                break;
+            uint64_t nHeaderPos = p - pbegin;
+            unsigned int nSize = ReadLE32(p + 4);
+            if (memcmp(p, pchMessageStart, sizeof(pchMessageStart)) || nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT) {
+                nPos = nHeaderPos + 1;
+                continue;
+            }
+            item.reset(new CImportedBlock());
+            item->nHeaderPos = nHeaderPos;
+            item->nPos = nHeaderPos + 8;
+            item->nSize = nSize;
+            nNext = item->nPos + nSize;
+            break;
+        }
+        if (item) {
+            // page the block in here, so the decoding threads do not wait for the disk
+            uint64_t nEnd = std::min(nNext, nFileSize);
+            file->NoteRead(item->nPos, nEnd - item->nPos);
+            volatile unsigned char chTouch;
+            for (uint64_t n = item->nPos; n < nEnd; n += 4096)
+                chTouch = pbegin[n];
+            (void)chTouch;
+        }
+        int64_t nTime = GetTimeMicros() - nTimeStart;
+
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            stats.nTimeRead += nTime;
+            if (nGen != nGeneration)
+                continue; // restarted meanwhile
+            if (!item) {
+                fScanDone = true;
+                condConsumer.notify_all();
+                continue;
+            }
+            queue.push_back(item);
+            work.push_back(item);
+            nScanPos = nNext;
+        }
+        condWorker.notify_one();
+    }
+}
+
+void CBlockImportPipeline::ThreadDecode()
+{
+    RenameThread("papara-reindex-dec");
+    while (true) {
+        CImportedBlockRef item;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (!fStop && work.empty())
+                condWorker.wait(lock);
+            if (fStop)
+                return;
+            item = work.front();
+            work.pop_front();
+        }
+        Decode(*item);
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            item->fDone = true;
+        }
+        condConsumer.notify_all();
+    }
+}
+
+void CBlockImportPipeline::Decode(CImportedBlock& item)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    try {
+        CMemoryReader blkdat(file->begin(), file->size(), SER_DISK, CLIENT_VERSION);
+        blkdat.SetPos(item.nPos);
+        blkdat.SetLimit(item.nPos + item.nSize);
+        blkdat >> item.block;
+        item.nEnd = blkdat.GetPos();
+        item.fDecoded = true;
+        item.block.GetHash();
+    } catch (const std::exception& e) {
+        item.strError = e.what();
+    }
+    int64_t nTimeDecoded = GetTimeMicros();
+
+    // the context-free checks that do not need the chain; anything
+    // that fails here is left for the full CheckBlock to report
+    if (item.fDecoded) {
+        bool fMutated = false;
+        item.fPrechecked = item.block.BuildMerkleTree(&fMutated) == item.block.hashMerkleRoot && !fMutated &&
+                           item.block.CheckBlockSignature();
+    }
+    int64_t nTimeChecked = GetTimeMicros();
+
+    boost::unique_lock<boost::mutex> lock(cs);
+    stats.nTimeDecode += nTimeDecoded - nTimeStart;
+    stats.nTimeCheck += nTimeChecked - nTimeDecoded;
+}
+
+bool CBlockImportPipeline::Next(CImportedBlockRef& item)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    boost::unique_lock<boost::mutex> lock(cs);
+    while ((queue.empty() && !fScanDone) || (!queue.empty() && !queue.front()->fDone))
+        condConsumer.wait(lock);
+    stats.nTimeWait += GetTimeMicros() - nTimeStart;
+    if (queue.empty())
+        return false;
+
+    stats.nBlocks++;
+    stats.nDepthSum += queue.size();
+    stats.nDepthMax = std::max(stats.nDepthMax, (unsigned int)queue.size());
+    item = queue.front();
+    queue.pop_front();
+    condReader.notify_one();
+    return true;
+}
+
+void CBlockImportPipeline::Restart(uint64_t nPos)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        nGeneration++;
+        queue.clear();
+        work.clear();
+        nScanPos = nPos;
+        fScanDone = false;
+    }
+    condReader.notify_all();
+}
+
+CBlockImportStats CBlockImportPipeline::GetStats()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return stats;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKIMPORT_H
+#define BITCOIN_BLOCKIMPORT_H
+
+#include "blockfilemap.h"
+#include "primitives/block.h"
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/** Default for -reindexthreads, 0 = one per core besides the import thread */
+static const int DEFAULT_REINDEX_THREADS = 0;
+/** Maximum number of block decoding threads during -reindex */
+static const int MAX_REINDEX_THREADS = 8;
+/** Maximum number of blocks read ahead of the one being connected */
+static const unsigned int REINDEX_QUEUE_SIZE = 256;
+
+/** A block found in a block file, decoded and prechecked by the pipeline */
+struct CImportedBlock {
+    uint64_t nHeaderPos; // position of the message start in front of the block
+    uint64_t nPos;       // position of the block
+    unsigned int nSize;  // size from the block's header
+
+    CBlock block;
+    bool fDecoded;     // block was deserialized, from nPos up to nEnd
+    uint64_t nEnd;
+    std::string strError;
+    bool fPrechecked;  // merkle root and block signature are valid
+
+    bool fDone;
+
+    CImportedBlock() : nHeaderPos(0), nPos(0), nSize(0), fDecoded(false), nEnd(0), fPrechecked(false), fDone(false) {}
+};
+
+typedef boost::shared_ptr<CImportedBlock> CImportedBlockRef;
+
+struct CBlockImportStats {
+    uint64_t nBlocks;
+    int64_t nTimeRead;    // reader: locating blocks and paging them in (us)
+    int64_t nTimeDecode;  // workers: deserializing and hashing (us)
+    int64_t nTimeCheck;   // workers: merkle roots and block signatures (us)
+    int64_t nTimeWait;    // consumer: waiting for the next block (us)
+    uint64_t nDepthSum;   // blocks queued ahead of the consumer, summed over all blocks
+    unsigned int nDepthMax;
+
+    CBlockImportStats() : nBlocks(0), nTimeRead(0), nTimeDecode(0), nTimeCheck(0), nTimeWait(0), nDepthSum(0), nDepthMax(0) {}
+};
+
+/**
+ * Staged pipeline over a mapped block file, used by -reindex.
+ *
+ * A reader thread locates the blocks and pages them in, worker threads
+ * deserialize them, compute their hashes and run the context-free checks that
+ * dominate on a single thread (merkle root, proof-of-stake block signature),
+ * and Next() hands the blocks out in file order to the caller, which connects
+ * them one at a time.
+ *
+ * The reader assumes every block decodes to its declared size. When one does
+ * not, the caller rescans from the right position with Restart(), as the
+ * serial scanner would have.
+ */
+class CBlockImportPipeline
+{
+private:
+    // Disallow copies
+    CBlockImportPipeline(const CBlockImportPipeline&);
+    CBlockImportPipeline& operator=(const CBlockImportPipeline&);
+
+    CMappedBlockFileRef file;
+    unsigned char pchMessageStart[4];
+
+    boost::mutex cs;
+    boost::condition_variable condReader;
+    boost::condition_variable condWorker;
+    boost::condition_variable condConsumer;
+    std::deque<CImportedBlockRef> queue; // blocks in file order
+    std::deque<CImportedBlockRef> work;  // blocks not picked up by a worker yet
+    uint64_t nScanPos;
+    bool fScanDone;
+    int nGeneration;
+    bool fStop;
+    CBlockImportStats stats;
+
+    boost::thread_group threads;
+
+    void ThreadRead();
+    void ThreadDecode();
+    void Decode(CImportedBlock& item);
+
+public:
+    CBlockImportPipeline(const CMappedBlockFileRef& fileIn, const unsigned char* pchMessageStartIn, int nThreads);
+    ~CBlockImportPipeline();
+
+    /**
+     * Wait for the next block in file order.
+     * @return false once the end of the file was reached
+     */
+    bool Next(CImportedBlockRef& item);
+
+    //! drop the blocks read ahead and continue scanning at nPos
+    void Restart(uint64_t nPos);
+
+    CBlockImportStats GetStats();
+};
+
+#endif // BITCOIN_BLOCKIMPORT_H
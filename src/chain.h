@@ -286,6 +286,8 @@ public:
         block.nBits = nBits;
         block.nNonce = nNonce;
         block.nAccumulatorCheckpoint = nAccumulatorCheckpoint;
+        if (phashBlock != NULL)
+            block.SetCachedHash(*phashBlock);
         return block;
     }
 
@@ -487,6 +489,10 @@ public:
 
     uint256 GetBlockHash() const
     {
+        // copied from an in-memory index entry, which knows its hash
+        if (phashBlock != NULL)
+            return *phashBlock;
+
         CBlockHeader block;
         block.nVersion = nVersion;
         block.hashPrevBlock = hashPrev;
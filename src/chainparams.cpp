@@ -406,6 +406,13 @@ const CChainParams& Params()
     return *pCurrentParams;
 }
 
+CModifiableParams* ModifiableParams()
+{
+    assert(pCurrentParams);
+    assert(pCurrentParams == &unitTestParams);
+    return (CModifiableParams*)&unitTestParams;
+}
+
 CChainParams& Params(CBaseChainParams::Network network)
 {
     switch (network) {
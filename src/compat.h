@@ -88,6 +88,12 @@ typedef u_int SOCKET;
 #define THREAD_PRIORITY_ABOVE_NORMAL (-2)
 #endif
 
+// Linux can wait on sockets with epoll and poll, which have no FD_SETSIZE limit
+#ifdef __linux__
+#define USE_EPOLL
+#define USE_POLL
+#endif
+
 size_t strnlen_int(const char* start, size_t max_len);
 
 bool static inline IsSelectableSocket(SOCKET s)
@@ -0,0 +1,46 @@
+/*
+ * Runtime CPU feature detection for the AES-NI paths of the AES based
+ * sph hash functions. See sph_aesni.h.
+ */
+
+#include "sph_aesni.h"
+
+#if SPH_AESNI
+#include <cpuid.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+int sph_aesni_active = 0;
+
+int
+sph_aesni_supported(void)
+{
+#if SPH_AESNI
+	static int supported = -1;
+
+	if (supported < 0) {
+		unsigned eax, ebx, ecx, edx;
+
+		supported = 0;
+		if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			supported = (ecx & bit_AES) != 0 && (ecx & bit_SSSE3) != 0;
+	}
+	return supported;
+#else
+	return 0;
+#endif
+}
+
+int
+sph_aesni_enable(int enable)
+{
+	sph_aesni_active = enable && sph_aesni_supported();
+	return sph_aesni_active;
+}
+
+#ifdef __cplusplus
+}
+#endif
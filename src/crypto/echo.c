@@ -35,6 +35,11 @@
 #include <limits.h>
 
 #include "sph_echo.h"
+#include "sph_aesni.h"
+
+#if SPH_AESNI
+#include <wmmintrin.h>
+#endif
 
 #ifdef __cplusplus
 extern "C"{
@@ -139,7 +144,7 @@ aes_2rounds_all(sph_u64 W[16][2],
 	*pK3 = K3;
 }
 
-#define BIG_SUB_WORDS   do { \
+#define BIG_SUB_WORDS_PORTABLE   do { \
 		aes_2rounds_all(W, &K0, &K1, &K2, &K3); \
 	} while (0)
 
@@ -162,7 +167,7 @@ aes_2rounds_all(sph_u64 W[16][2],
 		} \
 	} while (0)
 
-#define BIG_SUB_WORDS   do { \
+#define BIG_SUB_WORDS_PORTABLE   do { \
 		AES_2ROUNDS(W[ 0]); \
 		AES_2ROUNDS(W[ 1]); \
 		AES_2ROUNDS(W[ 2]); \
@@ -183,6 +188,56 @@ aes_2rounds_all(sph_u64 W[16][2],
 
 #endif
 
+#if SPH_AESNI
+
+/*
+ * Same as aes_2rounds_all(), with the AES-NI instructions: the
+ * little-endian 32-bit words X0..X3 of a state word are the AES state
+ * bytes in memory order, and AES_ROUND_LE() is exactly one AESENC.
+ */
+static void __attribute__((target("aes")))
+aes_2rounds_all_aesni(sph_u64 W[16][2],
+	sph_u32 *pK0, sph_u32 *pK1, sph_u32 *pK2, sph_u32 *pK3)
+{
+	int n;
+	sph_u32 K0 = *pK0;
+	sph_u32 K1 = *pK1;
+	sph_u32 K2 = *pK2;
+	sph_u32 K3 = *pK3;
+	__m128i zero = _mm_setzero_si128();
+
+	for (n = 0; n < 16; n ++) {
+		__m128i X = _mm_loadu_si128((const __m128i *)W[n]);
+		__m128i K = _mm_set_epi32((int)K3, (int)K2, (int)K1, (int)K0);
+
+		X = _mm_aesenc_si128(X, K);
+		X = _mm_aesenc_si128(X, zero);
+		_mm_storeu_si128((__m128i *)W[n], X);
+		if ((K0 = T32(K0 + 1)) == 0) {
+			if ((K1 = T32(K1 + 1)) == 0)
+				if ((K2 = T32(K2 + 1)) == 0)
+					K3 = T32(K3 + 1);
+		}
+	}
+	*pK0 = K0;
+	*pK1 = K1;
+	*pK2 = K2;
+	*pK3 = K3;
+}
+
+#define BIG_SUB_WORDS   do { \
+		if (sph_aesni_active) \
+			aes_2rounds_all_aesni(W, &K0, &K1, &K2, &K3); \
+		else \
+			BIG_SUB_WORDS_PORTABLE; \
+	} while (0)
+
+#else
+
+#define BIG_SUB_WORDS   BIG_SUB_WORDS_PORTABLE
+
+#endif
+
 #define SHIFT_ROW1(a, b, c, d)   do { \
 		sph_u64 tmp; \
 		tmp = W[a][0]; \
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -25,4 +26,16 @@ public:
     CSHA256& Reset();
 };
 
+/** Pick the fastest SHA-256 transformation this CPU supports and passes the
+ *  self-test, and return a description of it. Without fUseHardware, or
+ *  before the first call, the portable one is used.
+ */
+std::string SHA256AutoDetect(bool fUseHardware = true);
+
+/** Compute the double-SHA256 of each of a number of 64-byte inputs, several
+ *  at a time where the CPU allows it. This is what a merkle tree level is.
+ *  output: blocks * 32 bytes, input: blocks * 64 bytes.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -34,6 +34,12 @@
 #include <string.h>
 
 #include "sph_shavite.h"
+#include "sph_aesni.h"
+
+#if SPH_AESNI
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#endif
 
 #ifdef __cplusplus
 extern "C"{
@@ -1475,6 +1481,109 @@ c512(sph_shavite_big_context *sc, const void *msg)
 
 #endif
 
+#if SPH_AESNI
+
+/*
+ * Same as c512(), with the AES-NI instructions. The state and the round
+ * keys are kept as four 32-bit little-endian words per 128-bit register,
+ * which is the AES state in memory order; AES_ROUND_NOKEY() is one AESENC
+ * with a zero key, and the round key XOR that follows it is folded into
+ * the next AESENC.
+ */
+static void __attribute__((target("aes,ssse3")))
+c512_aesni(sph_shavite_big_context *sc, const void *msg)
+{
+	__m128i p0, p1, p2, p3, x, t;
+	__m128i rk[112];
+	__m128i zero = _mm_setzero_si128();
+	size_t u;
+	int r, s;
+
+	for (u = 0; u < 8; u ++)
+		rk[u] = _mm_loadu_si128((const __m128i *)msg + u);
+	u = 8;
+	for (;;) {
+		for (s = 0; s < 8; s ++) {
+			x = _mm_shuffle_epi32(rk[u - 8], _MM_SHUFFLE(0, 3, 2, 1));
+			rk[u] = _mm_aesenc_si128(x, zero);
+			rk[u] = _mm_xor_si128(rk[u], rk[u - 1]);
+			if (u == 8) {
+				rk[u] = _mm_xor_si128(rk[u], _mm_set_epi32(
+					(int)SPH_T32(~sc->count3), (int)sc->count2,
+					(int)sc->count1, (int)sc->count0));
+			} else if (u == 41) {
+				rk[u] = _mm_xor_si128(rk[u], _mm_set_epi32(
+					(int)SPH_T32(~sc->count0), (int)sc->count1,
+					(int)sc->count2, (int)sc->count3));
+			} else if (u == 79) {
+				rk[u] = _mm_xor_si128(rk[u], _mm_set_epi32(
+					(int)SPH_T32(~sc->count1), (int)sc->count0,
+					(int)sc->count3, (int)sc->count2));
+			} else if (u == 110) {
+				rk[u] = _mm_xor_si128(rk[u], _mm_set_epi32(
+					(int)SPH_T32(~sc->count2), (int)sc->count3,
+					(int)sc->count0, (int)sc->count1));
+			}
+			u ++;
+		}
+		if (u == 112)
+			break;
+		for (s = 0; s < 8; s ++) {
+			rk[u] = _mm_xor_si128(rk[u - 8],
+				_mm_alignr_epi8(rk[u - 1], rk[u - 2], 4));
+			u ++;
+		}
+	}
+
+	p0 = _mm_loadu_si128((const __m128i *)sc->h + 0);
+	p1 = _mm_loadu_si128((const __m128i *)sc->h + 1);
+	p2 = _mm_loadu_si128((const __m128i *)sc->h + 2);
+	p3 = _mm_loadu_si128((const __m128i *)sc->h + 3);
+	u = 0;
+	for (r = 0; r < 14; r ++) {
+		x = _mm_xor_si128(p1, rk[u ++]);
+		x = _mm_aesenc_si128(x, rk[u ++]);
+		x = _mm_aesenc_si128(x, rk[u ++]);
+		x = _mm_aesenc_si128(x, rk[u ++]);
+		x = _mm_aesenc_si128(x, zero);
+		p0 = _mm_xor_si128(p0, x);
+
+		x = _mm_xor_si128(p3, rk[u ++]);
+		x = _mm_aesenc_si128(x, rk[u ++]);
+		x = _mm_aesenc_si128(x, rk[u ++]);
+		x = _mm_aesenc_si128(x, rk[u ++]);
+		x = _mm_aesenc_si128(x, zero);
+		p2 = _mm_xor_si128(p2, x);
+
+		t = p3;
+		p3 = p2;
+		p2 = p1;
+		p1 = p0;
+		p0 = t;
+	}
+	_mm_storeu_si128((__m128i *)sc->h + 0,
+		_mm_xor_si128(_mm_loadu_si128((const __m128i *)sc->h + 0), p0));
+	_mm_storeu_si128((__m128i *)sc->h + 1,
+		_mm_xor_si128(_mm_loadu_si128((const __m128i *)sc->h + 1), p1));
+	_mm_storeu_si128((__m128i *)sc->h + 2,
+		_mm_xor_si128(_mm_loadu_si128((const __m128i *)sc->h + 2), p2));
+	_mm_storeu_si128((__m128i *)sc->h + 3,
+		_mm_xor_si128(_mm_loadu_si128((const __m128i *)sc->h + 3), p3));
+}
+
+#define C512(sc, msg)   do { \
+		if (sph_aesni_active) \
+			c512_aesni(sc, msg); \
+		else \
+			c512(sc, msg); \
+	} while (0)
+
+#else
+
+#define C512(sc, msg)   c512(sc, msg)
+
+#endif
+
 static void
 shavite_small_init(sph_shavite_small_context *sc, const sph_u32 *iv)
 {
@@ -1590,7 +1699,7 @@ shavite_big_core(sph_shavite_big_context *sc, const void *data, size_t len)
 					}
 				}
 			}
-			c512(sc, buf);
+			C512(sc, buf);
 			ptr = 0;
 		}
 	}
@@ -1624,7 +1733,7 @@ shavite_big_close(sph_shavite_big_context *sc,
 	} else {
 		buf[ptr ++] = z;
 		memset(buf + ptr, 0, 128 - ptr);
-		c512(sc, buf);
+		C512(sc, buf);
 		memset(buf, 0, 110);
 		sc->count0 = sc->count1 = sc->count2 = sc->count3 = 0;
 	}
@@ -1634,7 +1743,7 @@ shavite_big_close(sph_shavite_big_context *sc,
 	sph_enc32le(buf + 122, count3);
 	buf[126] = out_size_w32 << 5;
 	buf[127] = out_size_w32 >> 3;
-	c512(sc, buf);
+	C512(sc, buf);
 	for (u = 0; u < out_size_w32; u ++)
 		sph_enc32le((unsigned char *)dst + (u << 2), sc->h[u]);
 }
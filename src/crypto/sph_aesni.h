@@ -0,0 +1,51 @@
+/**
+ * Runtime selection of AES-NI code paths for the AES based sph hash
+ * functions (ECHO and SHAvite-3).
+ *
+ * The portable table based implementations stay the reference and are
+ * used whenever the compiler cannot target AES-NI or the CPU running the
+ * code does not support it. Both paths produce identical output.
+ *
+ * @file     sph_aesni.h
+ */
+
+#ifndef SPH_AESNI_H__
+#define SPH_AESNI_H__
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#if !defined SPH_AESNI && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define SPH_AESNI   1
+#endif
+
+/**
+ * 1 when the AES-NI code paths are selected, 0 (the default) when the
+ * portable ones are. Read by the compression functions on every block,
+ * only set by <code>sph_aesni_enable()</code>.
+ */
+extern int sph_aesni_active;
+
+/**
+ * Return non-zero when the AES-NI code paths are compiled in and the CPU
+ * supports the AES and SSSE3 instruction sets.
+ */
+int sph_aesni_supported(void);
+
+/**
+ * Select (<code>enable</code> non-zero) or deselect the AES-NI code
+ * paths. Selection only succeeds when <code>sph_aesni_supported()</code>;
+ * the resulting state is returned. Not thread safe: call it at startup,
+ * before any thread hashes.
+ *
+ * @param enable   non-zero to use AES-NI when possible
+ * @return  non-zero if AES-NI is now in use
+ */
+int sph_aesni_enable(int enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
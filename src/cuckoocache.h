@@ -0,0 +1,251 @@
+// Copyright (c) 2016 Jeremy Rubin
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CUCKOOCACHE_H
+#define BITCOIN_CUCKOOCACHE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * High performance cache primitives.
+ *
+ * bit_packed_atomic_flags holds one atomic "may be erased" flag per cache
+ * slot. cache is a fixed size set of elements that is cheap in memory and
+ * lookups: elements are found at one of eight hashed slots, lookups do not
+ * allocate, and erasing only sets an atomic flag so it can be done by many
+ * readers at once. Erased slots are reused lazily by the next insert.
+ */
+namespace CuckooCache
+{
+/**
+ * Bit-packed atomic flags, one per cache slot. All flags start set. Setting
+ * and unsetting flags is safe from concurrent threads; setup() is not.
+ */
+class bit_packed_atomic_flags
+{
+    std::unique_ptr<std::atomic<uint8_t>[]> mem;
+
+public:
+    bit_packed_atomic_flags() = delete;
+
+    explicit bit_packed_atomic_flags(uint32_t size)
+    {
+        // pad out the size if needed
+        size = (size + 7) / 8;
+        mem.reset(new std::atomic<uint8_t>[size]);
+        for (uint32_t i = 0; i < size; ++i)
+            mem[i].store(0xFF);
+    }
+
+    //! reset to b flags, all set
+    inline void setup(uint32_t b)
+    {
+        bit_packed_atomic_flags d(b);
+        std::swap(mem, d.mem);
+    }
+
+    inline void bit_set(uint32_t s)
+    {
+        mem[s >> 3].fetch_or(1 << (s & 7), std::memory_order_relaxed);
+    }
+
+    inline void bit_unset(uint32_t s)
+    {
+        mem[s >> 3].fetch_and(~(1 << (s & 7)), std::memory_order_relaxed);
+    }
+
+    inline bool bit_is_set(uint32_t s) const
+    {
+        return (1 << (s & 7)) & mem[s >> 3].load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * A fixed size cache of elements with eight hash functions (cuckoo hashing).
+ *
+ * Hash must provide template <uint8_t n> uint32_t operator()(const Element&)
+ * for n = 0..7, returning well distributed, independent values; the elements
+ * are expected to be salted hashes already, so slicing them is enough.
+ *
+ * Inserting an element into a full set of eight slots displaces one of the
+ * occupants to another of its slots, up to log2(size) times, after which the
+ * last displaced element is dropped. Elements older than the last "epoch"
+ * (about 45% of the table of inserts) are made erasable so that old entries
+ * make room for new ones.
+ *
+ * contains() may be called concurrently with other contains() calls, also
+ * with erase = true. insert() and setup() need exclusive access. Until setup()
+ * sizes it the cache holds nothing: inserts are dropped and lookups miss.
+ */
+template <typename Element, typename Hash>
+class cache
+{
+private:
+    std::vector<Element> table;
+    uint32_t size;
+    //! slot may be overwritten; set by contains(.., true) from any reader
+    mutable bit_packed_atomic_flags collection_flags;
+    //! slot was inserted in the current epoch
+    mutable std::vector<bool> epoch_flags;
+    //! inserts left before the epoch is checked again
+    uint32_t epoch_heuristic_counter;
+    //! number of live elements that make up an epoch
+    uint32_t epoch_size;
+    //! maximum number of displacements per insert
+    uint8_t depth_limit;
+    const Hash hash_function;
+
+    //! map the eight hashes of e onto [0, size) without a modulo
+    inline std::array<uint32_t, 8> compute_hashes(const Element& e) const
+    {
+        return {{(uint32_t)(((uint64_t)hash_function.template operator()<0>(e) * (uint64_t)size) >> 32),
+                 (uint32_t)(((uint64_t)hash_function.template operator()<1>(e) * (uint64_t)size) >> 32),
+                 (uint32_t)(((uint64_t)hash_function.template operator()<2>(e) * (uint64_t)size) >> 32),
+                 (uint32_t)(((uint64_t)hash_function.template operator()<3>(e) * (uint64_t)size) >> 32),
+                 (uint32_t)(((uint64_t)hash_function.template operator()<4>(e) * (uint64_t)size) >> 32),
+                 (uint32_t)(((uint64_t)hash_function.template operator()<5>(e) * (uint64_t)size) >> 32),
+                 (uint32_t)(((uint64_t)hash_function.template operator()<6>(e) * (uint64_t)size) >> 32),
+                 (uint32_t)(((uint64_t)hash_function.template operator()<7>(e) * (uint64_t)size) >> 32)}};
+    }
+
+    static uint32_t invalid() { return ~(uint32_t)0; }
+
+    inline void allow_erase(uint32_t n) const { collection_flags.bit_set(n); }
+    inline void please_keep(uint32_t n) const { collection_flags.bit_unset(n); }
+
+    /**
+     * Once the live elements of the current epoch reach epoch_size, make the
+     * previous epoch erasable and start a new one. The scan is only repeated
+     * when enough inserts have happened for the epoch to possibly be full.
+     */
+    void epoch_check()
+    {
+        if (epoch_heuristic_counter != 0) {
+            --epoch_heuristic_counter;
+            return;
+        }
+
+        uint32_t epoch_unused_count = 0;
+        for (uint32_t i = 0; i < size; ++i)
+            epoch_unused_count += epoch_flags[i] && !collection_flags.bit_is_set(i);
+
+        if (epoch_unused_count >= epoch_size) {
+            for (uint32_t i = 0; i < size; ++i) {
+                if (epoch_flags[i])
+                    epoch_flags[i] = false;
+                else
+                    allow_erase(i);
+            }
+            epoch_heuristic_counter = epoch_size;
+        } else {
+            epoch_heuristic_counter = std::max(1u, std::max(epoch_size / 16, epoch_size - epoch_unused_count));
+        }
+    }
+
+public:
+    cache() : table(), size(0), collection_flags(0), epoch_flags(), epoch_heuristic_counter(0), epoch_size(0), depth_limit(0), hash_function()
+    {
+    }
+
+    /**
+     * Size the cache for new_size elements (at least 2), dropping all
+     * current elements.
+     * @return the number of elements the cache holds
+     */
+    uint32_t setup(uint32_t new_size)
+    {
+        depth_limit = static_cast<uint8_t>(std::log2(static_cast<float>(std::max((uint32_t)2, new_size))));
+        size = std::max<uint32_t>(2, new_size);
+        table.assign(size, Element());
+        collection_flags.setup(size);
+        epoch_flags.assign(size, false);
+        epoch_size = std::max((uint32_t)1, (45 * size) / 100);
+        epoch_heuristic_counter = epoch_size;
+        return size;
+    }
+
+    /**
+     * Size the cache to use about bytes of memory for its elements.
+     * @return the number of elements the cache holds
+     */
+    uint32_t setup_bytes(size_t bytes)
+    {
+        return setup(std::min(bytes / sizeof(Element), (size_t)invalid() - 1));
+    }
+
+    //! number of elements the cache holds
+    uint32_t capacity() const { return size; }
+
+    void insert(Element e)
+    {
+        if (size == 0)
+            return;
+        epoch_check();
+        uint32_t last_loc = invalid();
+        bool last_epoch = true;
+        std::array<uint32_t, 8> locs = compute_hashes(e);
+
+        // already cached: only refresh it
+        for (uint32_t loc : locs) {
+            if (table[loc] == e) {
+                please_keep(loc);
+                epoch_flags[loc] = last_epoch;
+                return;
+            }
+        }
+
+        for (uint8_t depth = 0; depth < depth_limit; ++depth) {
+            // take a free slot if there is one
+            for (uint32_t loc : locs) {
+                if (!collection_flags.bit_is_set(loc))
+                    continue;
+                table[loc] = std::move(e);
+                please_keep(loc);
+                epoch_flags[loc] = last_epoch;
+                return;
+            }
+
+            // otherwise displace the occupant of the slot after the one we
+            // came from, so the element just placed is not moved again
+            last_loc = locs[(1 + (std::find(locs.begin(), locs.end(), last_loc) - locs.begin())) & 7];
+            std::swap(table[last_loc], e);
+            bool epoch = last_epoch;
+            last_epoch = epoch_flags[last_loc];
+            epoch_flags[last_loc] = epoch;
+
+            locs = compute_hashes(e);
+        }
+    }
+
+    /**
+     * @param e     the element to look for
+     * @param erase mark the element erasable if it is found
+     * @return whether e is in the cache
+     */
+    bool contains(const Element& e, const bool erase) const
+    {
+        if (size == 0)
+            return false;
+        std::array<uint32_t, 8> locs = compute_hashes(e);
+        for (uint32_t loc : locs) {
+            if (table[loc] == e) {
+                if (erase)
+                    allow_erase(loc);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+} // namespace CuckooCache
+
+#endif // BITCOIN_CUCKOOCACHE_H
@@ -12,6 +12,7 @@
 #include "guiinterface.h"
 
 #include <boost/algorithm/string.hpp> // boost::trim
+#include <boost/foreach.hpp>
 
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wellet.
@@ -50,6 +51,9 @@ private:
 };
 
 
+/** Longest request body the event thread parses to pick a work queue */
+static const size_t MAX_RPC_SELECT_BODY_SIZE = 4096;
+
 /* Pre-base64-encoded authentication token */
 static std::string strRPCUserColonPass;
 /* Stored RPC timer interface (for unregistration) */
@@ -145,6 +149,50 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     return true;
 }
 
+static HTTPWorkQueueID HTTPWorkQueueForClass(RPCExecClass execClass)
+{
+    switch (execClass) {
+    case RPC_EXEC_READ:
+        return HTTP_QUEUE_READ;
+    case RPC_EXEC_WALLET:
+        return HTTP_QUEUE_WALLET;
+    default:
+        return HTTP_QUEUE_CHAINSTATE;
+    }
+}
+
+/** Pick the work queue by the methods called: a batch goes to the queue of its heaviest call */
+static HTTPWorkQueueID HTTPSelect_JSONRPC(HTTPRequest* req, const std::string&)
+{
+    // Requests turned away before a call is made, or too large to look into here
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    if (req->GetRequestMethod() != HTTPRequest::POST || !authHeader.first || !RPCAuthorized(authHeader.second))
+        return HTTP_QUEUE_CHAINSTATE;
+    std::string strBody;
+    if (!req->PeekBody(MAX_RPC_SELECT_BODY_SIZE, strBody))
+        return HTTP_QUEUE_CHAINSTATE;
+
+    // Malformed requests only get an error back, which is quick
+    UniValue valRequest;
+    if (!valRequest.read(strBody))
+        return HTTP_QUEUE_READ;
+    std::vector<UniValue> vCalls;
+    if (valRequest.isObject())
+        vCalls.push_back(valRequest);
+    else if (valRequest.isArray())
+        vCalls = valRequest.getValues();
+
+    RPCExecClass execClass = RPC_EXEC_READ;
+    BOOST_FOREACH (const UniValue& call, vCalls) {
+        if (!call.isObject())
+            continue;
+        const UniValue& valMethod = find_value(call.get_obj(), "method");
+        if (valMethod.isStr())
+            execClass = std::max(execClass, tableRPC.GetExecClass(valMethod.get_str()));
+    }
+    return HTTPWorkQueueForClass(execClass);
+}
+
 static bool InitRPCAuthentication()
 {
     if (mapArgs["-rpcpassword"] == "")
@@ -168,7 +216,7 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTPSelect_JSONRPC);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
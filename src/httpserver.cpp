@@ -61,8 +61,9 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+/** Work queues for distributing work over multiple threads.
+ * Work items are simply callable objects. Each queue has threads of its own,
+ * and threads whose queue is empty help out with HTTP_QUEUE_READ.
  */
 template <typename WorkItem>
 class WorkQueue
@@ -72,9 +73,9 @@ private:
     CWaitableCriticalSection cs;
     CConditionVariable cond;
     /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
-    std::deque<WorkItem*> queue;
+    std::deque<WorkItem*> queue[HTTP_QUEUE_COUNT];
+    HTTPWorkQueueStats stats[HTTP_QUEUE_COUNT];
     bool running;
-    size_t maxDepth;
     int numThreads;
 
     /** RAII object to keep track of number of running worker threads */
@@ -82,60 +83,85 @@ private:
     {
     public:
         WorkQueue &wq;
-        ThreadCounter(WorkQueue &w): wq(w)
+        int id;
+        ThreadCounter(WorkQueue &w, int id): wq(w), id(id)
         {
             boost::lock_guard<boost::mutex> lock(wq.cs);
             wq.numThreads += 1;
+            wq.stats[id].nThreads += 1;
         }
         ~ThreadCounter()
         {
             boost::lock_guard<boost::mutex> lock(wq.cs);
             wq.numThreads -= 1;
+            wq.stats[id].nThreads -= 1;
             wq.cond.notify_all();
         }
     };
 
+    /** Queue a worker of queue id takes its next item from, or -1. Call with cs held. */
+    int NextQueue(int id)
+    {
+        if (!queue[id].empty())
+            return id;
+        if (!queue[HTTP_QUEUE_READ].empty())
+            return HTTP_QUEUE_READ;
+        return -1;
+    }
+
 public:
-    WorkQueue(size_t maxDepth) : running(true),
-                                 maxDepth(maxDepth),
-                                 numThreads(0)
+    WorkQueue(const std::string name[HTTP_QUEUE_COUNT], const size_t maxDepth[HTTP_QUEUE_COUNT]) : running(true),
+                                                                                                   numThreads(0)
     {
+        for (int id = 0; id < HTTP_QUEUE_COUNT; id++) {
+            stats[id].name = name[id];
+            stats[id].nMaxDepth = maxDepth[id];
+        }
     }
     /*( Precondition: worker threads have all stopped
      * (call WaitExit)
      */
     ~WorkQueue()
     {
-        while (!queue.empty()) {
-            delete queue.front();
-            queue.pop_front();
+        for (int id = 0; id < HTTP_QUEUE_COUNT; id++) {
+            while (!queue[id].empty()) {
+                delete queue[id].front();
+                queue[id].pop_front();
+            }
         }
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, int id)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        if (queue[id].size() >= stats[id].nMaxDepth) {
+            stats[id].nRejected++;
             return false;
         }
-        queue.push_back(item);
-        cond.notify_one();
+        queue[id].push_back(item);
+        stats[id].nPeakDepth = std::max(stats[id].nPeakDepth, queue[id].size());
+        // the workers of all queues wait on cond, wake them all so the right ones see it
+        cond.notify_all();
         return true;
     }
     /** Thread function */
-    void Run()
+    void Run(int id)
     {
-        ThreadCounter count(*this);
+        ThreadCounter count(*this, id);
         while (running) {
             WorkItem* i = 0;
             {
                 boost::unique_lock<boost::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && NextQueue(id) < 0)
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = queue.front();
-                queue.pop_front();
+                int from = NextQueue(id);
+                i = queue[from].front();
+                queue[from].pop_front();
+                stats[from].nProcessed++;
+                if (from != id)
+                    stats[from].nStolen++;
             }
             (*i)();
             delete i;
@@ -156,24 +182,28 @@ public:
             cond.wait(lock);
     }
 
-    /** Return current depth of queue */
-    size_t Depth()
+    /** Return current state of the queues */
+    std::vector<HTTPWorkQueueStats> GetStats()
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        return queue.size();
+        std::vector<HTTPWorkQueueStats> vStats(stats, stats + HTTP_QUEUE_COUNT);
+        for (int id = 0; id < HTTP_QUEUE_COUNT; id++)
+            vStats[id].nDepth = queue[id].size();
+        return vStats;
     }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler):
-        prefix(prefix), exactMatch(exactMatch), handler(handler)
+    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler, HTTPWorkQueueSelector selector):
+        prefix(prefix), exactMatch(exactMatch), handler(handler), selector(selector)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkQueueSelector selector;
 };
 
 /** HTTP module state */
@@ -184,7 +214,7 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
+//! Work queues for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
@@ -287,9 +317,10 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkQueueID id = i->selector ? i->selector(hreq.get(), path) : HTTP_QUEUE_CHAINSTATE;
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (workQueue->Enqueue(item.get(), id))
             item.release(); /* if true, queue took ownership */
         else
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
@@ -354,10 +385,10 @@ static bool HTTPBindAddresses(struct evhttp* http)
 }
 
 /** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue)
+static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int id)
 {
     RenameThread("bitcoin-httpworker");
-    queue->Run();
+    queue->Run(id);
 }
 
 /** libevent event log callback */
@@ -431,10 +462,15 @@ bool InitHTTPServer()
     }
 
     LogPrint("http", "Initialized HTTP server\n");
-    int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
-
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    const std::string workQueueName[HTTP_QUEUE_COUNT] = {"read", "wallet", "chainstate"};
+    size_t workQueueDepth[HTTP_QUEUE_COUNT];
+    workQueueDepth[HTTP_QUEUE_READ] = std::max((long)GetArg("-rpcreadworkqueue", DEFAULT_HTTP_READ_WORKQUEUE), 1L);
+    workQueueDepth[HTTP_QUEUE_WALLET] = std::max((long)GetArg("-rpcwalletworkqueue", DEFAULT_HTTP_WALLET_WORKQUEUE), 1L);
+    workQueueDepth[HTTP_QUEUE_CHAINSTATE] = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
+    LogPrintf("HTTP: creating work queues of depth %d (read), %d (wallet), %d (chainstate)\n",
+        workQueueDepth[HTTP_QUEUE_READ], workQueueDepth[HTTP_QUEUE_WALLET], workQueueDepth[HTTP_QUEUE_CHAINSTATE]);
+
+    workQueue = new WorkQueue<HTTPClosure>(workQueueName, workQueueDepth);
     eventBase = base;
     eventHTTP = http;
     return true;
@@ -445,12 +481,18 @@ boost::thread threadHTTP;
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
-    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
+    int rpcThreads[HTTP_QUEUE_COUNT];
+    rpcThreads[HTTP_QUEUE_READ] = std::max((long)GetArg("-rpcreadthreads", DEFAULT_HTTP_READ_THREADS), 1L);
+    rpcThreads[HTTP_QUEUE_WALLET] = std::max((long)GetArg("-rpcwalletthreads", DEFAULT_HTTP_WALLET_THREADS), 1L);
+    rpcThreads[HTTP_QUEUE_CHAINSTATE] = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    LogPrintf("HTTP: starting %d (read), %d (wallet), %d (chainstate) worker threads\n",
+        rpcThreads[HTTP_QUEUE_READ], rpcThreads[HTTP_QUEUE_WALLET], rpcThreads[HTTP_QUEUE_CHAINSTATE]);
     threadHTTP = boost::thread(boost::bind(&ThreadHTTP, eventBase, eventHTTP));
 
-    for (int i = 0; i < rpcThreads; i++)
-        boost::thread(boost::bind(&HTTPWorkQueueRun, workQueue));
+    for (int id = 0; id < HTTP_QUEUE_COUNT; id++) {
+        for (int i = 0; i < rpcThreads[id]; i++)
+            boost::thread(boost::bind(&HTTPWorkQueueRun, workQueue, id));
+    }
     return true;
 }
 
@@ -474,6 +516,7 @@ void StopHTTPServer()
         LogPrint("http", "Waiting for HTTP worker threads to exit\n");
         workQueue->WaitExit();
         delete workQueue;
+        workQueue = 0;
     }
     MilliSleep(500); // Avoid race condition while the last HTTP-thread is exiting
     if (eventBase) {
@@ -505,6 +548,13 @@ void StopHTTPServer()
     LogPrint("http", "Stopped HTTP server\n");
 }
 
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    if (!workQueue)
+        return std::vector<HTTPWorkQueueStats>();
+    return workQueue->GetStats();
+}
+
 struct event_base* EventBase()
 {
     return eventBase;
@@ -581,6 +631,21 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+bool HTTPRequest::PeekBody(size_t nMaxSize, std::string& strBody)
+{
+    strBody.clear();
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return true;
+    size_t size = evbuffer_get_length(buf);
+    if (size > nMaxSize)
+        return false;
+    strBody.resize(size);
+    if (size && evbuffer_copyout(buf, &strBody[0], size) != (ev_ssize_t)size)
+        return false;
+    return true;
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -647,10 +712,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkQueueSelector &selector)
 {
     LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, selector));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -7,12 +7,17 @@
 
 #include <string>
 #include <stdint.h>
+#include <vector>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/function.hpp>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
+static const int DEFAULT_HTTP_WALLET_THREADS=2;
+static const int DEFAULT_HTTP_WALLET_WORKQUEUE=16;
+static const int DEFAULT_HTTP_READ_THREADS=2;
+static const int DEFAULT_HTTP_READ_WORKQUEUE=64;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
 struct evhttp_request;
@@ -34,13 +39,42 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Work queues, each with worker threads of its own. When their own queue is
+ * empty, the workers of the other queues take requests from the read queue.
+ */
+enum HTTPWorkQueueID {
+    HTTP_QUEUE_READ,       //!< quick requests that take no global locks (-rpcreadthreads)
+    HTTP_QUEUE_WALLET,     //!< requests that lock the wallet (-rpcwalletthreads)
+    HTTP_QUEUE_CHAINSTATE, //!< all others (-rpcthreads)
+    HTTP_QUEUE_COUNT
+};
+
+struct HTTPWorkQueueStats
+{
+    std::string name;
+    int nThreads;
+    size_t nDepth;
+    size_t nMaxDepth;
+    size_t nPeakDepth;
+    uint64_t nProcessed;
+    uint64_t nStolen;   //!< of nProcessed, by the workers of other queues
+    uint64_t nRejected; //!< as the queue was full
+
+    HTTPWorkQueueStats() : nThreads(0), nDepth(0), nMaxDepth(0), nPeakDepth(0), nProcessed(0), nStolen(0), nRejected(0) {}
+};
+
+/** Get the state of the work queues, empty if the HTTP server is not running */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** Handler for requests to a certain HTTP path */
 typedef boost::function<void(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the work queue for a request. Called on the event thread, so it must be quick. */
+typedef boost::function<HTTPWorkQueueID(HTTPRequest* req, const std::string &)> HTTPWorkQueueSelector;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Without a selector, requests go to HTTP_QUEUE_CHAINSTATE.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkQueueSelector &selector = HTTPWorkQueueSelector());
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -96,6 +130,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Copy the request body without consuming it, if it is no longer than nMaxSize.
+     * @return false if the body is longer
+     */
+    bool PeekBody(size_t nMaxSize, std::string& strBody);
+
     /**
      * Write output header.
      *
@@ -6,9 +6,13 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 
 #include "wallet/db.h"
+#include "checkqueue.h"
+#include "crypto/common.h"
 #include "kernel.h"
 #include "script/interpreter.h"
 #include "timedata.h"
@@ -247,16 +251,14 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
 
 // The stake modifier used to hash for a stake kernel is chosen as the stake
 // modifier about a selection interval later than the coin generating the kernel
-bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake)
+static bool GetKernelStakeModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, const CBlockIndex*& pindexModifier)
 {
     nStakeModifier = 0;
+    pindexModifier = NULL;
     // modifier 0 on RegTest
     if (Params().NetworkID() == CBaseChainParams::REGTEST) {
         return true;
     }
-    if (!mapBlockIndex.count(hashBlockFrom))
-        return error("GetKernelStakeModifier() : block not indexed");
-    const CBlockIndex* pindexFrom = mapBlockIndex[hashBlockFrom];
     nStakeModifierHeight = pindexFrom->nHeight;
     nStakeModifierTime = pindexFrom->GetBlockTime();
     int64_t nStakeModifierSelectionInterval = GetStakeModifierSelectionInterval();
@@ -278,6 +280,7 @@ bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int
         }
     }
     nStakeModifier = pindex->nStakeModifier;
+    pindexModifier = pindex;
     return true;
 }
 
@@ -299,11 +302,11 @@ bool stakeTargetHit(uint256 hashProofOfStake, int64_t nValueIn, uint256 bnTarget
 }
 
 //instead of looping outside and reinitializing variables many times, we will give a nTimeTx and also search interval so that we can do all the hashing here
-bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTransaction txPrev, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake)
+bool CheckStakeKernelHash(unsigned int nBits, const CBlockIndex* pindexFrom, const CTxOut& txoutPrev, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake)
 {
     //assign new variables to make it easier to read
-    int64_t nValueIn = txPrev.vout[prevout.n].nValue;
-    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
+    int64_t nValueIn = txoutPrev.nValue;
+    unsigned int nTimeBlockFrom = pindexFrom->GetBlockTime();
 
     if (nTimeTx < nTimeBlockFrom) // Transaction timestamp violation
         return error("CheckStakeKernelHash() : nTime violation");
@@ -319,7 +322,8 @@ bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTra
     uint64_t nStakeModifier = 0;
     int nStakeModifierHeight = 0;
     int64_t nStakeModifierTime = 0;
-    if (!GetKernelStakeModifier(blockFrom.GetHash(), nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake)) {
+    const CBlockIndex* pindexModifier = NULL;
+    if (!GetKernelStakeModifier(pindexFrom, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, pindexModifier)) {
         LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier \n");
         return false;
     }
@@ -359,8 +363,8 @@ bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTra
             LogPrintf("CheckStakeKernelHash() : using modifier %s at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                 boost::lexical_cast<std::string>(nStakeModifier).c_str(), nStakeModifierHeight,
                 DateTimeStrFormat("%Y-%m-%d %H:%M:%S", nStakeModifierTime).c_str(),
-                mapBlockIndex[blockFrom.GetHash()]->nHeight,
-                DateTimeStrFormat("%Y-%m-%d %H:%M:%S", blockFrom.GetBlockTime()).c_str());
+                pindexFrom->nHeight,
+                DateTimeStrFormat("%Y-%m-%d %H:%M:%S", pindexFrom->GetBlockTime()).c_str());
             LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=%s nTimeBlockFrom=%u prevoutHash=%s nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
                 "0.3",
                 boost::lexical_cast<std::string>(nStakeModifier).c_str(),
@@ -375,41 +379,240 @@ bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTra
     return fSuccess;
 }
 
+CStakeKernel::CStakeKernel(uint64_t nStakeModifier, unsigned int nTimeBlockFrom, const COutPoint& prevout)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << nStakeModifier << nTimeBlockFrom << prevout.n << prevout.hash;
+    hasher.Write((const unsigned char*)&ss[0], ss.size());
+}
+
+uint256 CStakeKernel::GetHash(unsigned int nTimeTx) const
+{
+    unsigned char vchTime[4];
+    WriteLE32(vchTime, nTimeTx);
+
+    uint256 hash;
+    CHash256(hasher).Write(vchTime, sizeof(vchTime)).Finalize((unsigned char*)&hash);
+    return hash;
+}
+
+const CStakeKernel* CStakeKernelSearch::GetKernel(const CStakeKernelCandidate& candidate)
+{
+    AssertLockHeld(cs_main);
+
+    std::map<COutPoint, CachedKernel>::iterator it = mapKernels.find(candidate.prevout);
+    if (it != mapKernels.end()) {
+        const CachedKernel& cached = it->second;
+        // the modifier stays valid as long as the chain from the coin's block to the modifier block does
+        if (cached.pindexFrom == candidate.pindexFrom && chainActive.Contains(cached.pindexFrom) &&
+            (cached.pindexModifier == NULL || chainActive.Contains(cached.pindexModifier))) {
+            it->second.nRound = nRound;
+            return &it->second.kernel;
+        }
+        mapKernels.erase(it);
+    }
+
+    uint64_t nStakeModifier = 0;
+    int nStakeModifierHeight = 0;
+    int64_t nStakeModifierTime = 0;
+    const CBlockIndex* pindexModifier = NULL;
+    if (!GetKernelStakeModifier(candidate.pindexFrom, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, pindexModifier))
+        return NULL;
+
+    CachedKernel& cached = mapKernels[candidate.prevout];
+    cached.pindexFrom = candidate.pindexFrom;
+    cached.pindexModifier = pindexModifier;
+    cached.kernel = CStakeKernel(nStakeModifier, candidate.pindexFrom->GetBlockTime(), candidate.prevout);
+    cached.nRound = nRound;
+    return &cached.kernel;
+}
+
+namespace
+{
+struct StakeKernelWork {
+    const CStakeKernel* kernel;
+    uint256 bnTarget;
+    unsigned int nTimeTx;
+    bool fHit;
+    uint256 hashProofOfStake;
+};
+
+void StakeKernelSearchThread(std::vector<StakeKernelWork>& vWork, size_t nStart, size_t nStep, unsigned int nHashDrift, int nHeightStart, uint64_t& nHashes)
+{
+    for (size_t n = nStart; n < vWork.size(); n += nStep) {
+        //new block came in, move on
+        if (chainActive.Height() != nHeightStart)
+            break;
+
+        StakeKernelWork& work = vWork[n];
+        unsigned int nTimeStart = work.nTimeTx;
+        for (unsigned int i = 0; i < nHashDrift; i++) {
+            unsigned int nTryTime = nTimeStart + nHashDrift - i;
+            uint256 hashProofOfStake = work.kernel->GetHash(nTryTime);
+            nHashes++;
+            if (hashProofOfStake < work.bnTarget) {
+                work.fHit = true;
+                work.nTimeTx = nTryTime;
+                work.hashProofOfStake = hashProofOfStake;
+                break;
+            }
+        }
+    }
+}
+}
+
+bool CStakeKernelSearch::Search(const std::vector<CStakeKernelCandidate>& vCandidates, unsigned int nBits, unsigned int nTimeTx, unsigned int nHashDrift, std::vector<CStakeKernelHit>& vHits)
+{
+    LOCK(cs);
+    vHits.clear();
+    nRound++;
+
+    uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+
+    std::vector<StakeKernelWork> vWork;
+    std::vector<unsigned int> vWorkCandidate;
+    int nHeightStart;
+    {
+        LOCK(cs_main);
+        nHeightStart = chainActive.Height();
+        for (unsigned int n = 0; n < vCandidates.size(); n++) {
+            const CStakeKernelCandidate& candidate = vCandidates[n];
+            unsigned int nTimeBlockFrom = candidate.pindexFrom->GetBlockTime();
+            if (nTimeTx < nTimeBlockFrom || nTimeBlockFrom + nStakeMinAge > nTimeTx)
+                continue;
+
+            const CStakeKernel* kernel = GetKernel(candidate);
+            if (kernel == NULL) {
+                LogPrintf("CStakeKernelSearch::Search() : failed to get kernel stake modifier for %s\n", candidate.prevout.ToString());
+                continue;
+            }
+
+            StakeKernelWork work;
+            work.kernel = kernel;
+            // same weight as stakeTargetHit, computed once per output instead of once per hash
+            work.bnTarget = uint256(candidate.nValue) / 100 * bnTargetPerCoinDay;
+            work.nTimeTx = nTimeTx;
+            work.fHit = false;
+            vWork.push_back(work);
+            vWorkCandidate.push_back(n);
+        }
+
+        // forget outputs that are no longer staked
+        std::map<COutPoint, CachedKernel>::iterator it = mapKernels.begin();
+        while (it != mapKernels.end()) {
+            if (it->second.nRound != nRound)
+                mapKernels.erase(it++);
+            else
+                ++it;
+        }
+    }
+
+    int nThreads = GetArg("-stakesearchthreads", DEFAULT_STAKESEARCH_THREADS);
+    nThreads = std::max(1, std::min(std::min(nThreads, MAX_STAKESEARCH_THREADS), (int)vWork.size()));
+
+    int64_t nStart = GetTimeMicros();
+    std::vector<uint64_t> vHashes(nThreads, 0);
+    if (nThreads == 1) {
+        StakeKernelSearchThread(vWork, 0, 1, nHashDrift, nHeightStart, vHashes[0]);
+    } else {
+        boost::thread_group threadGroup;
+        for (int i = 0; i < nThreads; i++)
+            threadGroup.create_thread(boost::bind(&StakeKernelSearchThread, boost::ref(vWork), i, nThreads, nHashDrift, nHeightStart, boost::ref(vHashes[i])));
+        threadGroup.join_all();
+    }
+    nHashTimeMicros += GetTimeMicros() - nStart;
+    for (int i = 0; i < nThreads; i++)
+        nHashes += vHashes[i];
+
+    for (unsigned int n = 0; n < vWork.size(); n++) {
+        if (!vWork[n].fHit)
+            continue;
+        CStakeKernelHit hit;
+        hit.nCandidate = vWorkCandidate[n];
+        hit.nTimeTx = vWork[n].nTimeTx;
+        hit.hashProofOfStake = vWork[n].hashProofOfStake;
+        vHits.push_back(hit);
+    }
+
+    mapHashedBlocks.clear();
+    mapHashedBlocks[nHeightStart] = GetTime(); //store a time stamp of when we last hashed on this block
+    return !vHits.empty();
+}
+
+double CStakeKernelSearch::GetHashRate() const
+{
+    LOCK(cs);
+    if (nHashTimeMicros <= 0)
+        return 0;
+    return nHashes * 1000000.0 / nHashTimeMicros;
+}
+
+size_t CStakeKernelSearch::CacheSize() const
+{
+    LOCK(cs);
+    return mapKernels.size();
+}
+
 // Check kernel hash target and coinstake signature
-bool CheckProofOfStake(const CBlock block, uint256& hashProofOfStake)
+// Find the output a coinstake spends and the block it was confirmed in. The UTXO set has both
+// when the stake is unspent on the active chain, which is where new blocks usually build on;
+// stakes on other branches and already spent ones are read from disk.
+static bool GetStakeInput(const COutPoint& prevout, const CBlockIndex* pindexPrev, CTxOut& txoutPrev, const CBlockIndex*& pindexFrom)
+{
+    AssertLockHeld(cs_main);
+
+    if (pindexPrev && chainActive.Contains(pindexPrev)) {
+        const CCoins* coins = pcoinsTip->AccessCoins(prevout.hash);
+        if (coins && coins->IsAvailable(prevout.n) && coins->nHeight <= pindexPrev->nHeight) {
+            txoutPrev = coins->vout[prevout.n];
+            pindexFrom = chainActive[coins->nHeight];
+            return true;
+        }
+    }
+
+    uint256 hashBlock;
+    CTransaction txPrev;
+    if (!GetTransaction(prevout.hash, txPrev, hashBlock, true) || prevout.n >= txPrev.vout.size())
+        return error("%s : INFO: read txPrev failed", __func__);
+
+    BlockMap::iterator it = mapBlockIndex.find(hashBlock);
+    if (it == mapBlockIndex.end())
+        return error("%s : read block failed", __func__);
+
+    txoutPrev = txPrev.vout[prevout.n];
+    pindexFrom = it->second;
+    return true;
+}
+
+bool CheckProofOfStake(const CBlock& block, const CBlockIndex* pindexPrev, uint256& hashProofOfStake, CCheckQueueControl<CScriptCheck>* pcontrol)
 {
-    const CTransaction tx = block.vtx[1];
+    const CTransaction& tx = block.vtx[1];
     if (!tx.IsCoinStake())
         return error("CheckProofOfStake() : called on non-coinstake %s", tx.GetHash().ToString().c_str());
 
     // Kernel (input 0) must match the stake hash target per coin age (nBits)
     const CTxIn& txin = tx.vin[0];
 
-    // First try finding the previous transaction in database
-    uint256 hashBlock;
-    CTransaction txPrev;
-    if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
-        return error("CheckProofOfStake() : INFO: read txPrev failed");
-
-    //verify signature and script
-    if (!VerifyScript(txin.scriptSig, txPrev.vout[txin.prevout.n].scriptPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
+    CTxOut txoutPrev;
+    const CBlockIndex* pindex = NULL;
+    if (!GetStakeInput(txin.prevout, pindexPrev, txoutPrev, pindex))
+        return error("CheckProofOfStake() : stake input %s not found", txin.prevout.ToString());
+
+    //verify signature and script, the signature cache spares ConnectBlock doing it again
+    CScriptCheck check(txoutPrev.scriptPubKey, tx, 0, STANDARD_SCRIPT_VERIFY_FLAGS, true);
+    if (pcontrol) {
+        std::vector<CScriptCheck> vChecks(1);
+        check.swap(vChecks[0]);
+        pcontrol->Add(vChecks);
+    } else if (!check()) {
         return error("CheckProofOfStake() : VerifySignature failed on coinstake %s", tx.GetHash().ToString().c_str());
+    }
 
-    CBlockIndex* pindex = NULL;
-    BlockMap::iterator it = mapBlockIndex.find(hashBlock);
-    if (it != mapBlockIndex.end())
-        pindex = it->second;
-    else
-        return error("CheckProofOfStake() : read block failed");
-
-    // Read block header
-    CBlock blockprev;
-    if (!ReadBlockFromDisk(blockprev, pindex->GetBlockPos()))
-        return error("CheckProofOfStake(): INFO: failed to find block");
-
+    // the index has everything the kernel needs from the block, no need to read and rehash it
     unsigned int nInterval = 0;
     unsigned int nTime = block.nTime;
-    if (!CheckStakeKernelHash(block.nBits, blockprev, txPrev, txin.prevout, nTime, nInterval, true, hashProofOfStake, fDebug))
+    if (!CheckStakeKernelHash(block.nBits, pindex, txoutPrev, txin.prevout, nTime, nInterval, true, hashProofOfStake, fDebug))
         return error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s \n", tx.GetHash().ToString().c_str(), hashProofOfStake.ToString().c_str()); // may occur during initial download or if behind on block chain sync
 
     return true;
@@ -5,8 +5,12 @@
 #ifndef BITCOIN_KERNEL_H
 #define BITCOIN_KERNEL_H
 
+#include "hash.h"
 #include "main.h"
 
+template <typename T>
+class CCheckQueueControl;
+
 
 // MODIFIER_INTERVAL: time to elapse before new modifier is computed
 static const unsigned int MODIFIER_INTERVAL = 60;
@@ -25,11 +29,79 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
 // Sets hashProofOfStake on success return
 uint256 stakeHash(unsigned int nTimeTx, CDataStream ss, unsigned int prevoutIndex, uint256 prevoutHash, unsigned int nTimeBlockFrom);
 bool stakeTargetHit(uint256 hashProofOfStake, int64_t nValueIn, uint256 bnTargetPerCoinDay);
-bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTransaction txPrev, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake = false);
+bool CheckStakeKernelHash(unsigned int nBits, const CBlockIndex* pindexFrom, const CTxOut& txoutPrev, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake = false);
+
+/** Default for -stakesearchthreads, number of threads hashing stake kernels */
+static const int DEFAULT_STAKESEARCH_THREADS = 1;
+/** Maximum number of stake kernel search threads */
+static const int MAX_STAKESEARCH_THREADS = 16;
+
+// Kernel preimage with the stake modifier, nTimeBlockFrom and prevout already fed to the hasher,
+// so each try only hashes the 4 byte nTimeTx instead of reserializing the whole stream
+class CStakeKernel
+{
+private:
+    CHash256 hasher;
+
+public:
+    CStakeKernel() {}
+    CStakeKernel(uint64_t nStakeModifier, unsigned int nTimeBlockFrom, const COutPoint& prevout);
+
+    // Same result as stakeHash(nTimeTx, ss << nStakeModifier, prevout.n, prevout.hash, nTimeBlockFrom)
+    uint256 GetHash(unsigned int nTimeTx) const;
+};
+
+struct CStakeKernelCandidate {
+    COutPoint prevout;
+    CAmount nValue;
+    const CBlockIndex* pindexFrom;
+
+    CStakeKernelCandidate(const COutPoint& prevoutIn, CAmount nValueIn, const CBlockIndex* pindexFromIn) : prevout(prevoutIn), nValue(nValueIn), pindexFrom(pindexFromIn) {}
+};
+
+struct CStakeKernelHit {
+    unsigned int nCandidate; // index into the candidate vector
+    unsigned int nTimeTx;
+    uint256 hashProofOfStake;
+};
+
+// Searches the kernels of all stakeable outputs in one pass. Stake modifiers and kernel prefixes are
+// cached per output across rounds (until the block they were taken from leaves the active chain) and
+// the hashing is spread over -stakesearchthreads worker threads.
+class CStakeKernelSearch
+{
+private:
+    struct CachedKernel {
+        const CBlockIndex* pindexFrom;
+        const CBlockIndex* pindexModifier; // NULL when the network uses a fixed modifier
+        CStakeKernel kernel;
+        unsigned int nRound;
+    };
+
+    mutable CCriticalSection cs;
+    std::map<COutPoint, CachedKernel> mapKernels;
+    unsigned int nRound;
+    uint64_t nHashes;
+    int64_t nHashTimeMicros;
+
+    const CStakeKernel* GetKernel(const CStakeKernelCandidate& candidate);
+
+public:
+    CStakeKernelSearch() : nRound(0), nHashes(0), nHashTimeMicros(0) {}
+
+    // Try nTimeTx + nHashDrift down to nTimeTx + 1 for every candidate, like CheckStakeKernelHash.
+    // vHits receives the newest passing time of each candidate with a kernel, in candidate order.
+    bool Search(const std::vector<CStakeKernelCandidate>& vCandidates, unsigned int nBits, unsigned int nTimeTx, unsigned int nHashDrift, std::vector<CStakeKernelHit>& vHits);
+
+    // Kernels hashed per second over all searches so far
+    double GetHashRate() const;
+    size_t CacheSize() const;
+};
 
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
-bool CheckProofOfStake(const CBlock block, uint256& hashProofOfStake);
+// With pcontrol the coinstake signature is handed to the script check threads, the caller waits for it
+bool CheckProofOfStake(const CBlock& block, const CBlockIndex* pindexPrev, uint256& hashProofOfStake, CCheckQueueControl<CScriptCheck>* pcontrol = NULL);
 
 // Check whether the coinstake timestamp meets protocol
 bool CheckCoinStakeTimestamp(int64_t nTimeBlock, int64_t nTimeTx);
@@ -61,6 +61,61 @@ public:
     }
 };
 
+/** Iterator over the records of a CLevelDBWrapper in key order */
+class CLevelDBIterator
+{
+private:
+    leveldb::Iterator* piter;
+
+    CLevelDBIterator(const CLevelDBIterator&);
+    void operator=(const CLevelDBIterator&);
+
+public:
+    CLevelDBIterator(leveldb::Iterator* piterIn) : piter(piterIn) {}
+    ~CLevelDBIterator() { delete piter; }
+
+    bool Valid() const { return piter->Valid(); }
+    void SeekToFirst() { piter->SeekToFirst(); }
+    void Next() { piter->Next(); }
+
+    //! position at the first record with a key at or past key
+    template <typename K>
+    void Seek(const K& key)
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(ssKey.GetSerializeSize(key));
+        ssKey << key;
+        leveldb::Slice slKey(&ssKey[0], ssKey.size());
+        piter->Seek(slKey);
+    }
+
+    template <typename K>
+    bool GetKey(K& key) const
+    {
+        leveldb::Slice slKey = piter->key();
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> key;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    template <typename V>
+    bool GetValue(V& value) const
+    {
+        leveldb::Slice slValue = piter->value();
+        try {
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+};
+
 class CLevelDBWrapper
 {
 private:
@@ -168,6 +223,12 @@ public:
     {
         return pdb->NewIterator(iteroptions);
     }
+
+    //! iterator for range scans: Seek() to the first key of the range and stop at the first key past it
+    CLevelDBIterator* NewRangeIterator()
+    {
+        return new CLevelDBIterator(pdb->NewIterator(iteroptions));
+    }
 };
 
 #endif // BITCOIN_LEVELDBWRAPPER_H
@@ -11,6 +11,7 @@
  **/
 // Copyright (c) 2017 The PIVX developers
 #include "AccumulatorProofOfKnowledge.h"
+#include "FixedBaseExp.h"
 #include "hash.h"
 
 namespace libzerocoin {
@@ -116,14 +117,20 @@ bool AccumulatorProofOfKnowledge:: Verify(const Accumulator& a, const CBigNum& v
 
 	CBigNum c = CBigNum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-	CBigNum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin * sg.inverse(params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) * sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * (sg * valueOfCommitmentToCoin).pow_mod(s_sigma, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
+	// powers of the generators come from the fixed-base tables, (g^-1)^x being g^-x
+	boost::shared_ptr<const GroupExpTables> pokTables = params->accumulatorPoKCommitmentGroup.getExpTables();
+	boost::shared_ptr<const GroupExpTables> qrnTables = params->getQRNExpTables();
+	const CBigNum& sModulus = params->accumulatorPoKCommitmentGroup.modulus;
+	const CBigNum& nModulus = params->accumulatorModulus;
 
-	CBigNum t_1_prime = (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) * g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_2_prime = (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) * g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) * C_u.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
-	CBigNum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) * ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
+	CBigNum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, sModulus) * pokTables->pow_mod_gh(s_alpha, s_phi)) % sModulus;
+	CBigNum st_2_prime = (pokTables->pow_mod_gh(c, s_psi) * ((valueOfCommitmentToCoin * sg.inverse(sModulus)).pow_mod(s_gamma, sModulus))) % sModulus;
+	CBigNum st_3_prime = (pokTables->pow_mod_gh(c, s_xi) * (sg * valueOfCommitmentToCoin).pow_mod(s_sigma, sModulus)) % sModulus;
+
+	CBigNum t_1_prime = (C_r.pow_mod(c, nModulus) * qrnTables->pow_mod_gh(s_epsilon, s_zeta)) % nModulus;
+	CBigNum t_2_prime = (C_e.pow_mod(c, nModulus) * qrnTables->pow_mod_gh(s_alpha, s_eta)) % nModulus;
+	CBigNum t_3_prime = ((a.getValue()).pow_mod(c, nModulus) * C_u.pow_mod(s_alpha, nModulus) * qrnTables->h.pow_mod(s_beta * -1)) % nModulus;
+	CBigNum t_4_prime = (C_r.pow_mod(s_alpha, nModulus) * qrnTables->pow_mod_gh(s_beta * -1, s_delta * -1)) % nModulus;
 
 	bool result = false;
 
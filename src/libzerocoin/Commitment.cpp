@@ -13,6 +13,7 @@
 
 #include <stdlib.h>
 #include "Commitment.h"
+#include "FixedBaseExp.h"
 #include "hash.h"
 
 namespace libzerocoin {
@@ -120,12 +121,12 @@ bool CommitmentProofOfKnowledge::Verify(const CBigNum& A, const CBigNum& B) cons
 
 	// Compute T1 = g1^S1 * h1^S2 * inverse(A^{challenge}) mod p1
 	CBigNum T1 = A.pow_mod(this->challenge, ap->modulus).inverse(ap->modulus).mul_mod(
-	                (ap->g.pow_mod(S1, ap->modulus).mul_mod(ap->h.pow_mod(S2, ap->modulus), ap->modulus)),
+	                ap->getExpTables()->pow_mod_gh(S1, S2),
 	                ap->modulus);
 
 	// Compute T2 = g2^S1 * h2^S3 * inverse(B^{challenge}) mod p2
 	CBigNum T2 = B.pow_mod(this->challenge, bp->modulus).inverse(bp->modulus).mul_mod(
-	                (bp->g.pow_mod(S1, bp->modulus).mul_mod(bp->h.pow_mod(S3, bp->modulus), bp->modulus)),
+	                bp->getExpTables()->pow_mod_gh(S1, S3),
 	                bp->modulus);
 
 	// Hash T1 and T2 along with all of the public parameters
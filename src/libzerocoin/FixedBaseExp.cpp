@@ -0,0 +1,189 @@
+/**
+ * @file       FixedBaseExp.cpp
+ *
+ * @brief      Fixed-base modular exponentiation for the Zerocoin library.
+ *
+ * @license    This project is released under the MIT license.
+ **/
+// Copyright (c) 2019 The papara developers
+
+#include "FixedBaseExp.h"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace libzerocoin {
+
+static bool fTablesEnabled = true;
+
+// Window width minimizing the cost of Yao's method for an exponent length
+static unsigned int WindowBits(unsigned int bits)
+{
+	unsigned int best = 1;
+	unsigned int bestCost = bits + 1;
+	for (unsigned int w = 2; w <= 8; w++) {
+		unsigned int cost = (bits + w - 1) / w + (1U << w) - 1;
+		if (cost < bestCost) {
+			best = w;
+			bestCost = cost;
+		}
+	}
+	return best;
+}
+
+FixedBaseExp::FixedBaseExp(const CBigNum& baseIn, const CBigNum& modulusIn, unsigned int maxExpBits) : base(baseIn), modulus(modulusIn), mont(NULL)
+{
+	// Montgomery multiplication needs an odd modulus; otherwise every call falls back
+	if (!BN_is_odd(&modulus))
+		return;
+
+	CAutoBN_CTX pctx;
+	if (!BN_nnmod(&base, &baseIn, &modulus, pctx))
+		throw bignum_error("FixedBaseExp : BN_nnmod failed");
+
+	mont = BN_MONT_CTX_new();
+	if (mont == NULL || !BN_MONT_CTX_set(mont, &modulus, pctx))
+		throw bignum_error("FixedBaseExp : BN_MONT_CTX_set failed");
+
+	powers.resize(maxExpBits);
+	if (!BN_to_montgomery(&powers[0], &this->base, mont, pctx))
+		throw bignum_error("FixedBaseExp : BN_to_montgomery failed");
+	for (unsigned int i = 1; i < maxExpBits; i++) {
+		if (!BN_mod_mul_montgomery(&powers[i], &powers[i - 1], &powers[i - 1], mont, pctx))
+			throw bignum_error("FixedBaseExp : BN_mod_mul_montgomery failed");
+	}
+}
+
+FixedBaseExp::~FixedBaseExp()
+{
+	if (mont != NULL)
+		BN_MONT_CTX_free(mont);
+}
+
+void FixedBaseExp::setEnabled(bool enabled)
+{
+	fTablesEnabled = enabled;
+}
+
+bool FixedBaseExp::isEnabled()
+{
+	return fTablesEnabled;
+}
+
+bool FixedBaseExp::covers(const CBigNum& e) const
+{
+	return fTablesEnabled && mont != NULL && (unsigned int)BN_num_bits(&e) <= powers.size();
+}
+
+CBigNum FixedBaseExp::pow_mod(const CBigNum& e) const
+{
+	if (!covers(e))
+		return base.pow_mod(e, modulus);
+
+	std::vector<const FixedBaseExp*> bases(1, this);
+	std::vector<CBigNum> exps(1, e < 0 ? e * -1 : e);
+	CBigNum ret = multiply(bases, exps);
+	return e < 0 ? ret.inverse(modulus) : ret;
+}
+
+CBigNum FixedBaseExp::multi_pow_mod(const std::vector<const FixedBaseExp*>& bases, const std::vector<CBigNum>& exps)
+{
+	assert(!bases.empty() && bases.size() == exps.size());
+	const CBigNum& m = bases[0]->modulus;
+
+	// split into positive and negative exponents, computing the ones the tables don't cover directly
+	std::vector<const FixedBaseExp*> vPos, vNeg;
+	std::vector<CBigNum> vPosExps, vNegExps;
+	CBigNum ret = 1;
+	for (unsigned int i = 0; i < bases.size(); i++) {
+		assert(bases[i]->modulus == m);
+		if (!bases[i]->covers(exps[i])) {
+			ret = ret.mul_mod(bases[i]->base.pow_mod(exps[i], m), m);
+		} else if (exps[i] < 0) {
+			vNeg.push_back(bases[i]);
+			vNegExps.push_back(exps[i] * -1);
+		} else {
+			vPos.push_back(bases[i]);
+			vPosExps.push_back(exps[i]);
+		}
+	}
+
+	if (!vPos.empty())
+		ret = ret.mul_mod(multiply(vPos, vPosExps), m);
+	if (!vNeg.empty())
+		ret = ret.mul_mod(multiply(vNeg, vNegExps).inverse(m), m);
+	return ret;
+}
+
+// Yao's method over all bases at once: with e_i the w-bit digits of the
+// exponents and G_i the matching table entries, B_d is the product of the
+// G_i with e_i >= d and the result is the product of B_d for d = 1..2^w-1.
+CBigNum FixedBaseExp::multiply(const std::vector<const FixedBaseExp*>& bases, const std::vector<CBigNum>& exps)
+{
+	CAutoBN_CTX pctx;
+	BN_MONT_CTX* mont = bases[0]->mont;
+
+	unsigned int bits = 0;
+	for (unsigned int i = 0; i < exps.size(); i++)
+		bits = std::max(bits, (unsigned int)BN_num_bits(&exps[i]));
+	unsigned int w = WindowBits(bits);
+
+	// table entries grouped by the digit they are raised to
+	std::vector<std::vector<const CBigNum*> > digits(1U << w);
+	for (unsigned int i = 0; i < exps.size(); i++) {
+		unsigned int n = BN_num_bits(&exps[i]);
+		for (unsigned int j = 0; j < n; j += w) {
+			unsigned int d = 0;
+			for (unsigned int k = 0; k < w && j + k < n; k++)
+				d |= (BN_is_bit_set(&exps[i], j + k) ? 1U : 0U) << k;
+			if (d)
+				digits[d].push_back(&bases[i]->powers[j]);
+		}
+	}
+
+	CBigNum a, b;
+	bool fHaveA = false, fHaveB = false;
+	for (unsigned int d = (1U << w) - 1; d > 0; d--) {
+		for (unsigned int k = 0; k < digits[d].size(); k++) {
+			if (!fHaveB) {
+				b = *digits[d][k];
+				fHaveB = true;
+			} else if (!BN_mod_mul_montgomery(&b, &b, digits[d][k], mont, pctx))
+				throw bignum_error("FixedBaseExp::multiply : BN_mod_mul_montgomery failed");
+		}
+		if (!fHaveB)
+			continue;
+		if (!fHaveA) {
+			a = b;
+			fHaveA = true;
+		} else if (!BN_mod_mul_montgomery(&a, &a, &b, mont, pctx))
+			throw bignum_error("FixedBaseExp::multiply : BN_mod_mul_montgomery failed");
+	}
+
+	if (!fHaveA)
+		return CBigNum(1) % bases[0]->modulus;
+
+	CBigNum ret;
+	if (!BN_from_montgomery(&ret, &a, mont, pctx))
+		throw bignum_error("FixedBaseExp::multiply : BN_from_montgomery failed");
+	return ret;
+}
+
+// exponents in the proofs reach about twice the modulus length
+GroupExpTables::GroupExpTables(const CBigNum& gIn, const CBigNum& hIn, const CBigNum& modulus) : g(gIn, modulus, 2 * modulus.bitSize() + 512),
+                                                                                                 h(hIn, modulus, 2 * modulus.bitSize() + 512)
+{
+}
+
+CBigNum GroupExpTables::pow_mod_gh(const CBigNum& x, const CBigNum& y) const
+{
+	std::vector<const FixedBaseExp*> bases;
+	bases.push_back(&g);
+	bases.push_back(&h);
+	std::vector<CBigNum> exps;
+	exps.push_back(x);
+	exps.push_back(y);
+	return FixedBaseExp::multi_pow_mod(bases, exps);
+}
+
+} /* namespace libzerocoin */
@@ -0,0 +1,99 @@
+/**
+ * @file       FixedBaseExp.h
+ *
+ * @brief      Fixed-base modular exponentiation for the Zerocoin library.
+ *
+ * @license    This project is released under the MIT license.
+ **/
+// Copyright (c) 2019 The papara developers
+
+#ifndef FIXEDBASEEXP_H_
+#define FIXEDBASEEXP_H_
+
+#include <vector>
+#include <openssl/bn.h>
+#include "bignum.h"
+
+namespace libzerocoin {
+
+/**
+ * Precomputed powers of a fixed base for fast modular exponentiation.
+ *
+ * Keeps base^(2^i) mod m in Montgomery form for every exponent bit i up
+ * to a maximum length, and evaluates powers with Yao's windowed method:
+ * about bits/w + 2^w modular multiplications and no squarings, instead
+ * of one squaring per exponent bit. Several powers with the same modulus
+ * can be multiplied together in a single pass (simultaneous
+ * multi-exponentiation), sharing the 2^w combining steps.
+ *
+ * The modulus must be odd. Exponents longer than the table fall back to
+ * CBigNum::pow_mod; negative exponents are handled like CBigNum::pow_mod,
+ * by inverting the result.
+ */
+class FixedBaseExp {
+public:
+	/**
+	 * @param baseIn      the fixed base
+	 * @param modulusIn   the (odd) modulus
+	 * @param maxExpBits  the longest exponent served from the table
+	 */
+	FixedBaseExp(const CBigNum& baseIn, const CBigNum& modulusIn, unsigned int maxExpBits);
+	~FixedBaseExp();
+
+	/**
+	 * @param e the exponent
+	 * @return base^e mod modulus
+	 */
+	CBigNum pow_mod(const CBigNum& e) const;
+
+	/**
+	 * Product of several fixed-base powers with a common modulus.
+	 * @param bases the bases, all with the same modulus
+	 * @param exps  one exponent per base
+	 * @return the product of bases[i]^exps[i] mod modulus
+	 */
+	static CBigNum multi_pow_mod(const std::vector<const FixedBaseExp*>& bases, const std::vector<CBigNum>& exps);
+
+	const CBigNum& getBase() const { return base; }
+	const CBigNum& getModulus() const { return modulus; }
+
+	/**
+	 * Turn the tables off (or back on) for all instances, e.g. to
+	 * benchmark them against plain CBigNum::pow_mod.
+	 */
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+
+private:
+	FixedBaseExp(const FixedBaseExp&);
+	FixedBaseExp& operator=(const FixedBaseExp&);
+
+	bool covers(const CBigNum& e) const;
+	static CBigNum multiply(const std::vector<const FixedBaseExp*>& bases, const std::vector<CBigNum>& exps);
+
+	CBigNum base;
+	CBigNum modulus;
+	BN_MONT_CTX* mont;
+	// base^(2^i) mod modulus in Montgomery form
+	std::vector<CBigNum> powers;
+};
+
+/**
+ * Fixed-base tables for the two generators g and h of a group.
+ */
+class GroupExpTables {
+public:
+	GroupExpTables(const CBigNum& gIn, const CBigNum& hIn, const CBigNum& modulus);
+
+	FixedBaseExp g;
+	FixedBaseExp h;
+
+	/**
+	 * g^x * h^y mod modulus
+	 */
+	CBigNum pow_mod_gh(const CBigNum& x, const CBigNum& y) const;
+};
+
+} /* namespace libzerocoin */
+
+#endif /* FIXEDBASEEXP_H_ */
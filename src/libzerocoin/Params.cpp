@@ -11,10 +11,15 @@
 **/
 // Copyright (c) 2017 The PIVX developers
 #include "Params.h"
+#include "FixedBaseExp.h"
 #include "ParamGeneration.h"
+#include <boost/thread/mutex.hpp>
 
 namespace libzerocoin {
 
+// guards the lazy construction of the fixed-base exponentiation tables
+static boost::mutex csExpTables;
+
 ZerocoinParams::ZerocoinParams(CBigNum N, uint32_t securityLevel) {
 	this->zkp_hash_len = securityLevel;
 	this->zkp_iterations = securityLevel;
@@ -37,6 +42,20 @@ IntegerGroupParams::IntegerGroupParams() {
 	this->initialized = false;
 }
 
+boost::shared_ptr<const GroupExpTables> IntegerGroupParams::getExpTables() const {
+	boost::mutex::scoped_lock lock(csExpTables);
+	if (!expTables)
+		expTables.reset(new GroupExpTables(g, h, modulus));
+	return expTables;
+}
+
+boost::shared_ptr<const GroupExpTables> AccumulatorAndProofParams::getQRNExpTables() const {
+	boost::mutex::scoped_lock lock(csExpTables);
+	if (!qrnExpTables)
+		qrnExpTables.reset(new GroupExpTables(accumulatorQRNCommitmentGroup.g, accumulatorQRNCommitmentGroup.h, accumulatorModulus));
+	return qrnExpTables;
+}
+
 CBigNum IntegerGroupParams::randomElement() const {
 	// The generator of the group raised
 	// to a random number less than the order of the group
@@ -13,11 +13,14 @@
 #ifndef PARAMS_H_
 #define PARAMS_H_
 
+#include <boost/shared_ptr.hpp>
 #include "bignum.h"
 #include "ZerocoinDefines.h"
 
 namespace libzerocoin {
 
+class GroupExpTables;
+
 class IntegerGroupParams {
 public:
 	/** @brief Integer group class, default constructor
@@ -26,6 +29,13 @@ public:
 	**/
 	IntegerGroupParams();
 
+	/**
+	 * Fixed-base exponentiation tables for g and h, built on first use
+	 * and shared with copies of these parameters.
+	 * @return the tables
+	 */
+	boost::shared_ptr<const GroupExpTables> getExpTables() const;
+
 	/**
 	 * Generates a random group element
 	 * @return a random element in the group.
@@ -63,6 +73,9 @@ public:
 		    READWRITE(modulus);
 		    READWRITE(groupOrder);
 	}	
+
+private:
+	mutable boost::shared_ptr<const GroupExpTables> expTables;
 };
 
 class AccumulatorAndProofParams {
@@ -138,6 +151,15 @@ public:
 	 * The statistical zero-knowledgeness of the accumulator proof.
 	 */
 	uint32_t k_dprime;
+
+	/**
+	 * Fixed-base exponentiation tables for the generators of the
+	 * accumulator QRN group, modulo the accumulator modulus. Built on
+	 * first use and shared with copies of these parameters.
+	 * @return the tables
+	 */
+	boost::shared_ptr<const GroupExpTables> getQRNExpTables() const;
+
 	ADD_SERIALIZE_METHODS;
   template <typename Stream, typename Operation>  inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
 	    READWRITE(initialized);
@@ -150,6 +172,9 @@ public:
 	    READWRITE(k_prime);
 	    READWRITE(k_dprime);
   }
+
+private:
+	mutable boost::shared_ptr<const GroupExpTables> qrnExpTables;
 };
 
 class ZerocoinParams {
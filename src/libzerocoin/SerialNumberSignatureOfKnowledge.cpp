@@ -77,9 +77,11 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
         }
 	}
 
+	// a^x is the same in every iteration
+	CBigNum a_pow = coinGroupPow(a, params->coinCommitmentGroup.getExpTables()->g, coin.getSerialNumber());
 	for(uint32_t i=0; i < params->zkp_iterations; i++) {
 		// compute g^{ {a^x b^r} h^v} mod p2
-		c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v_expanded[i]);
+		c[i] = challengeCalculation(a_pow, r[i], v_expanded[i]);
 	}
 
 	// We can't hash data in parallel either
@@ -107,42 +109,48 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
 	}
 }
 
-inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const CBigNum& a_exp,const CBigNum& b_exp,
+// base^exp mod the SoK group order, from the coin group tables when their modulus is that order
+inline CBigNum SerialNumberSignatureOfKnowledge::coinGroupPow(const CBigNum& base, const FixedBaseExp& table,
+        const CBigNum& exp) const {
+	if (params->coinCommitmentGroup.modulus == params->serialNumberSoKCommitmentGroup.groupOrder)
+		return table.pow_mod(exp);
+	return base.pow_mod(exp, params->serialNumberSoKCommitmentGroup.groupOrder);
+}
+
+inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const CBigNum& a_pow,const CBigNum& b_exp,
         const CBigNum& h_exp) const {
 
-	CBigNum a = params->coinCommitmentGroup.g;
 	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
 
-	CBigNum exponent = (a.pow_mod(a_exp, params->serialNumberSoKCommitmentGroup.groupOrder)
-	                   * b.pow_mod(b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
+	CBigNum exponent = (a_pow * coinGroupPow(b, params->coinCommitmentGroup.getExpTables()->h, b_exp))
+	                   % params->serialNumberSoKCommitmentGroup.groupOrder;
 
-	return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
+	return params->serialNumberSoKCommitmentGroup.getExpTables()->pow_mod_gh(exponent, h_exp);
 }
 
 bool SerialNumberSignatureOfKnowledge::Verify(const CBigNum& coinSerialNumber, const CBigNum& valueOfCommitmentToCoin,
         const uint256 msghash) const {
 	CBigNum a = params->coinCommitmentGroup.g;
 	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
+	boost::shared_ptr<const GroupExpTables> coinTables = params->coinCommitmentGroup.getExpTables();
+	boost::shared_ptr<const GroupExpTables> sokTables = params->serialNumberSoKCommitmentGroup.getExpTables();
 	CHashWriter hasher(0,0);
 	hasher << *params << valueOfCommitmentToCoin << coinSerialNumber << msghash;
 
 	vector<CBigNum> tprime(params->zkp_iterations);
 	unsigned char *hashbytes = (unsigned char*) &this->hash;
+	CBigNum a_pow = coinGroupPow(a, coinTables->g, coinSerialNumber);
 
 	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
 		int bit = i % 8;
 		int byte = i / 8;
 		bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
 		if(challenge_bit) {
-			tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], SeedTo1024(sprime[i].getuint256()));
+			tprime[i] = challengeCalculation(a_pow, s_notprime[i], SeedTo1024(sprime[i].getuint256()));
 		} else {
-			CBigNum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
+			CBigNum exp = coinGroupPow(b, coinTables->h, s_notprime[i]);
 			tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
-			             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
+			             sokTables->h.pow_mod(sprime[i])) %
 			            params->serialNumberSoKCommitmentGroup.modulus;
 		}
 	}
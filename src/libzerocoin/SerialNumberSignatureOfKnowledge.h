@@ -20,6 +20,7 @@
 #include "Params.h"
 #include "Coin.h"
 #include "Commitment.h"
+#include "FixedBaseExp.h"
 #include "bignum.h"
 #include "serialize.h"
 #include "Accumulator.h"
@@ -67,8 +68,9 @@ private:
 	// define something named s and it conflicts
 	vector<CBigNum> s_notprime;
 	vector<CBigNum> sprime;
-	inline CBigNum challengeCalculation(const CBigNum& a_exp, const CBigNum& b_exp,
+	inline CBigNum challengeCalculation(const CBigNum& a_pow, const CBigNum& b_exp,
 	                                   const CBigNum& h_exp) const;
+	inline CBigNum coinGroupPow(const CBigNum& base, const FixedBaseExp& table, const CBigNum& exp) const;
 };
 
 } /* namespace libzerocoin */
@@ -11,13 +11,17 @@
 #include "zpara/accumulators.h"
 #include "addrman.h"
 #include "alert.h"
+#include "blockfilemap.h"
+#include "blockimport.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "crypto/common.h"
 #include "init.h"
 #include "kernel.h"
 #include "masternode-budget.h"
 #include "masternode-payments.h"
+#include "masternode-sigqueue.h"
 #include "masternode-tiers.h"
 #include "masternodeman.h"
 #include "merkleblock.h"
@@ -86,7 +90,8 @@ bool fTxIndex = true;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
 bool fVerifyingBlocks = false;
-unsigned int nCoinCacheSize = 5000;
+size_t nCoinCacheUsage = 5000 * 300;
+int nReindexThreads = 0;
 bool fAlerts = DEFAULT_ALERTS;
 
 unsigned int nStakeMinAge = 1 * 60 * 60;
@@ -1212,6 +1217,71 @@ bool BlockToPubcoinList(const CBlock& block, list<PublicCoin>& listPubcoins)
     return true;
 }
 
+/**
+ * Pubcoins minted in the blocks [nHeightStart, nHeightEnd) of the active chain, by height, from the pubcoin index of
+ * the zerocoin db. Blocks that are not indexed yet are read from disk and indexed; for a single denomination, only the
+ * ones whose block index lists mints of it. ZQ_ERROR collects all denominations.
+ */
+bool GetBlockRangePubcoins(int nHeightStart, int nHeightEnd, CoinDenomination denom, map<int, list<PublicCoin> >& mapPubcoins)
+{
+    nHeightEnd = std::min(nHeightEnd, chainActive.Height() + 1);
+    if (nHeightStart >= nHeightEnd)
+        return true;
+
+    map<int, uint256> mapIndexed;
+    if (!zerocoinDB->ReadIndexedBlocks(nHeightStart, nHeightEnd, mapIndexed))
+        return false;
+
+    vector<CoinDenomination> vDenoms;
+    if (denom == ZQ_ERROR)
+        vDenoms = zerocoinDenomList;
+    else
+        vDenoms.push_back(denom);
+
+    for (CoinDenomination d : vDenoms) {
+        map<int, CBlockPubcoins> mapEntries;
+        if (!zerocoinDB->ReadPubcoinRange(d, nHeightStart, nHeightEnd, mapEntries))
+            return false;
+
+        for (const auto& entry : mapEntries) {
+            // skip what a block that is no longer on the active chain left behind
+            map<int, uint256>::const_iterator it = mapIndexed.find(entry.first);
+            if (it == mapIndexed.end() || it->second != entry.second.hashBlock || it->second != chainActive[entry.first]->GetBlockHash())
+                continue;
+
+            for (const CBigNum& bnValue : entry.second.vPubcoins)
+                mapPubcoins[entry.first].emplace_back(PublicCoin(Params().Zerocoin_Params(), bnValue, d));
+        }
+    }
+
+    for (int nHeight = nHeightStart; nHeight < nHeightEnd; nHeight++) {
+        CBlockIndex* pindex = chainActive[nHeight];
+        map<int, uint256>::const_iterator it = mapIndexed.find(nHeight);
+        if (it != mapIndexed.end() && it->second == pindex->GetBlockHash())
+            continue;
+        if (denom != ZQ_ERROR && !pindex->MintedDenomination(denom))
+            continue;
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex))
+            return error("%s : failed to read block %d from disk", __func__, nHeight);
+
+        list<PublicCoin> listPubcoins;
+        if (!BlockToPubcoinList(block, listPubcoins))
+            return error("%s : failed to get zerocoin mintlist from block %d", __func__, nHeight);
+
+        if (!zerocoinDB->WriteBlockPubcoins(nHeight, pindex->GetBlockHash(), listPubcoins))
+            LogPrintf("%s : failed to index pubcoins of block %d\n", __func__, nHeight);
+
+        for (const PublicCoin& pubcoin : listPubcoins) {
+            if (denom == ZQ_ERROR || pubcoin.getDenomination() == denom)
+                mapPubcoins[nHeight].push_back(pubcoin);
+        }
+    }
+
+    return true;
+}
+
 //return a list of zerocoin mints contained in a specific block
 bool BlockToZerocoinMintList(const CBlock& block, std::list<CZerocoinMint>& vMints)
 {
@@ -1396,13 +1466,11 @@ bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidatio
 
     // Send signal to wallet if this is ours
     if (pwalletMain) {
-        CWalletDB walletdb(pwalletMain->strWalletFile);
-        list <CBigNum> listMySerials = walletdb.ListMintedCoinsSerial();
         for (const auto& newSpend : vSpends) {
-            list<CBigNum>::iterator it = find(listMySerials.begin(), listMySerials.end(), newSpend.getCoinSerialNumber());
-            if (it != listMySerials.end()) {
-                LogPrintf("%s: %s detected spent zerocoin mint in transaction %s \n", __func__, it->GetHex(), tx.GetHash().GetHex());
-                pwalletMain->NotifyZerocoinChanged(pwalletMain, it->GetHex(), "Used", CT_UPDATED);
+            const CBigNum& bnSerial = newSpend.getCoinSerialNumber();
+            if (pwalletMain->zparaTracker->HasUnusedSerial(bnSerial)) {
+                LogPrintf("%s: %s detected spent zerocoin mint in transaction %s \n", __func__, bnSerial.GetHex(), tx.GetHash().GetHex());
+                pwalletMain->NotifyZerocoinChanged(pwalletMain, bnSerial.GetHex(), "Used", CT_UPDATED);
             }
         }
     }
@@ -1554,6 +1622,14 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
     return nMinFee;
 }
 
+static void LimitMempoolSize(CTxMemPool& pool, size_t limit, int64_t age)
+{
+    int expired = pool.Expire(GetTime() - age);
+    if (expired != 0)
+        LogPrint("mempool", "Expired %i transactions from the memory pool\n", expired);
+
+    pool.TrimToSize(limit);
+}
 
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool fRejectInsaneFee, bool ignoreFees)
 {
@@ -1719,6 +1795,13 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
                                         hash.ToString(), nFees, txMinFee),
                     REJECT_INSUFFICIENTFEE, "insufficient fee");
 
+            // Once the pool has been full, require at least the fee rate of what it evicted
+            CAmount mempoolRejectFee = pool.GetMinFee(GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize);
+            if (mempoolRejectFee > 0 && nFees < mempoolRejectFee && !tx.IsZerocoinSpend())
+                return state.DoS(0, error("AcceptToMemoryPool : mempool min fee not met %s, %d < %d",
+                                        hash.ToString(), nFees, mempoolRejectFee),
+                    REJECT_INSUFFICIENTFEE, "mempool min fee not met");
+
             // Require that free transactions have sufficient priority to be mined in the next block.
             if (tx.IsZerocoinMint()) {
                 if(nFees < Params().Zerocoin_MintFee() * tx.GetZerocoinMintCount())
@@ -1777,6 +1860,11 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry);
+
+        // trim the pool; the new transaction may itself be what goes
+        LimitMempoolSize(pool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+        if (!pool.exists(hash))
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
     }
 
     SyncWithWallets(tx, NULL);
@@ -2017,7 +2105,16 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
                 } catch (const std::exception& e) {
                     return error("%s : Deserialize or I/O error - %s", __func__, e.what());
                 }
-                hashBlock = header.GetHash();
+                // a block on the active chain has its hash in the index, no need to hash the header
+                hashBlock = 0;
+                BlockMap::iterator mi = mapBlockIndex.find(header.hashPrevBlock);
+                if (mi != mapBlockIndex.end()) {
+                    CBlockIndex* pindexNext = chainActive.Next(mi->second);
+                    if (pindexNext && pindexNext->nFile == postx.nFile && pindexNext->nDataPos == postx.nPos)
+                        hashBlock = pindexNext->GetBlockHash();
+                }
+                if (hashBlock == 0)
+                    hashBlock = header.GetHash();
                 if (txOut.GetHash() != hash)
                     return error("%s : txid mismatch", __func__);
                 return true;
@@ -2083,18 +2180,48 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos)
     return true;
 }
 
+/**
+ * Deserialize a block straight from the mapped block file.
+ * Returns false without touching block if the file cannot be mapped, so the
+ * caller can read it through stdio instead.
+ */
+static bool ReadBlockFromMappedFile(CBlock& block, const CDiskBlockPos& pos)
+{
+    // blocks are preceded by the message start and their size
+    if (pos.IsNull() || pos.nPos < 8)
+        return false;
+    boost::filesystem::path path = GetBlockPosFilename(pos, "blk");
+    CMappedBlockFileRef file = blockFileMap.Get(pos.nFile, path, pos.nPos);
+    if (!file)
+        return false;
+    unsigned int nSize = ReadLE32((const unsigned char*)file->begin() + pos.nPos - 4);
+    if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+        return false;
+    if (pos.nPos + nSize > file->size()) {
+        file = blockFileMap.Get(pos.nFile, path, pos.nPos + nSize);
+        if (!file)
+            return false;
+    }
+
+    CMemoryReader blockin(file->begin() + pos.nPos, nSize, SER_DISK, CLIENT_VERSION);
+    blockin >> block;
+    file->NoteRead(pos.nPos, nSize);
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk : OpenBlockFile failed");
-
     // Read block
     try {
-        filein >> block;
+        if (!ReadBlockFromMappedFile(block, pos)) {
+            // Open history file to read
+            CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("ReadBlockFromDisk : OpenBlockFile failed");
+            filein >> block;
+        }
     } catch (std::exception& e) {
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -2432,6 +2559,21 @@ bool CScriptCheck::operator()()
     return true;
 }
 
+bool CBlockCheck::operator()()
+{
+    switch (type) {
+    case MERKLE_ROOT: {
+        bool fMutated = false;
+        return pblock->BuildMerkleTree(&fMutated) == pblock->hashMerkleRoot && !fMutated;
+    }
+    case BLOCK_SIGNATURE:
+        return pblock->CheckBlockSignature();
+    case NONE:
+        break;
+    }
+    return true;
+}
+
 bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, std::vector<CScriptCheck>* pvChecks)
 {
     if (!tx.IsCoinBase() && !tx.IsZerocoinSpend()) {
@@ -2551,6 +2693,10 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
         return error("DisconnectBlock() : block and undo data inconsistent");
 
+    // the startup check disconnects blocks in memory only, the index stays as it is on disk
+    if (!fVerifyingBlocks && !zerocoinDB->EraseBlockPubcoins(pindex->nHeight))
+        return error("DisconnectBlock(): failed to erase pubcoin index");
+
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction& tx = block.vtx[i];
@@ -2675,8 +2821,11 @@ void static FlushBlockFile(bool fFinalize = false)
 
     FILE* fileOld = OpenBlockFile(posOld);
     if (fileOld) {
-        if (fFinalize)
+        if (fFinalize) {
             TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
+            // a mapping of the old length would reach past the end of the file
+            blockFileMap.Erase(nLastBlockFile);
+        }
         FileCommit(fileOld);
         fclose(fileOld);
     }
@@ -2693,6 +2842,10 @@ void static FlushBlockFile(bool fFinalize = false)
 bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos, unsigned int nAddSize);
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+// a block hands out two checks, one to each thread
+static CCheckQueue<CBlockCheck> blockcheckqueue(1);
+// ProcessNewBlock runs on several threads, but only one of them can use blockcheckqueue at a time
+static CCriticalSection cs_blockcheckqueue;
 
 void ThreadScriptCheck()
 {
@@ -2700,25 +2853,42 @@ void ThreadScriptCheck()
     scriptcheckqueue.Thread();
 }
 
+void ThreadBlockCheck()
+{
+    RenameThread("papara-blockch");
+    blockcheckqueue.Thread();
+}
+
 void RecalculateZpaparaMinted()
 {
     CBlockIndex *pindex = chainActive[Params().Zerocoin_AccumulatorStartHeight()];
     int nHeightEnd = chainActive.Height();
+    map<int, list<PublicCoin> > mapPubcoins;
+    bool fIndexed = false;
     while (true) {
         if (pindex->nHeight % 1000 == 0)
             LogPrintf("%s : block %d...\n", __func__, pindex->nHeight);
 
-        //overwrite possibly wrong vMintsInBlock data
-        CBlock block;
-        assert(ReadBlockFromDisk(block, pindex));
-
-        std::list<CZerocoinMint> listMints;
-        BlockToZerocoinMintList(block, listMints);
+        //take the pubcoins of the next thousand blocks from the pubcoin index
+        if (pindex->nHeight % 1000 == 0 || pindex->nHeight == Params().Zerocoin_AccumulatorStartHeight()) {
+            mapPubcoins.clear();
+            fIndexed = GetBlockRangePubcoins(pindex->nHeight, pindex->nHeight + 1000 - pindex->nHeight % 1000, ZQ_ERROR, mapPubcoins);
+        }
 
-        vector<libzerocoin::CoinDenomination> vDenomsBefore = pindex->vMintDenominationsInBlock;
+        //overwrite possibly wrong vMintsInBlock data
         pindex->vMintDenominationsInBlock.clear();
-        for (auto mint : listMints)
-            pindex->vMintDenominationsInBlock.emplace_back(mint.GetDenomination());
+        if (fIndexed) {
+            for (const PublicCoin& pubcoin : mapPubcoins[pindex->nHeight])
+                pindex->vMintDenominationsInBlock.emplace_back(pubcoin.getDenomination());
+        } else {
+            CBlock block;
+            assert(ReadBlockFromDisk(block, pindex));
+
+            std::list<CZerocoinMint> listMints;
+            BlockToZerocoinMintList(block, listMints);
+            for (auto mint : listMints)
+                pindex->vMintDenominationsInBlock.emplace_back(mint.GetDenomination());
+        }
 
         //Record mints to disk
         assert(pblocktree->WriteBlockIndex(CDiskBlockIndex(pindex)));
@@ -2899,6 +3069,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     CBlockUndo blockundo;
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
+    // Checks for a template keep the mempool's signatures in the cache, a real connect uses them up
+    bool fCacheResults = fJustCheck;
 
     int64_t nTimeStart = GetTimeMicros();
     CAmount nFees = 0;
@@ -2985,7 +3157,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             nValueIn += view.GetValueIn(tx);
 
             std::vector<CScriptCheck> vChecks;
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, false, nScriptCheckThreads ? &vChecks : NULL))
+            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, nScriptCheckThreads ? &vChecks : NULL))
                 return false;
             control.Add(vChecks);
         }
@@ -3117,6 +3289,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return state.Abort("Failed to write transaction index");
 
+    // index the pubcoins of the block by denomination and height
+    std::list<PublicCoin> listPubcoins;
+    if (!BlockToPubcoinList(block, listPubcoins) || !zerocoinDB->WriteBlockPubcoins(pindex->nHeight, pindex->GetBlockHash(), listPubcoins))
+        LogPrintf("%s : failed to index pubcoins of block %d\n", __func__, pindex->nHeight);
+
 	    {
 	        LOCK(cs_mapstake);
 	
@@ -3165,16 +3342,18 @@ enum FlushStateMode {
 
 /**
  * Update the on-disk chain state.
- * The caches and indexes are flushed if either they're too large, forceWrite is set, or
- * fast is not set and it's been a while since the last write.
+ * The caches and indexes are written if either the coins cache exceeds its memory budget,
+ * mode is FLUSH_STATE_ALWAYS, or mode is FLUSH_STATE_PERIODIC and it's been a while since
+ * the last write. Writing keeps the coins cache warm: only its modified entries go to disk,
+ * and when it was over budget, unmodified entries are evicted until it is well below.
  */
 bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
 {
     LOCK(cs_main);
     static int64_t nLastWrite = 0;
     try {
-        if ((mode == FLUSH_STATE_ALWAYS) ||
-            ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->GetCacheSize() > nCoinCacheSize) ||
+        bool fCacheFull = (mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->DynamicMemoryUsage() > nCoinCacheUsage;
+        if ((mode == FLUSH_STATE_ALWAYS) || fCacheFull ||
             (mode == FLUSH_STATE_PERIODIC && GetTimeMicros() > nLastWrite + DATABASE_WRITE_INTERVAL * 1000000)) {
             // Typical CCoins structures on disk are around 100 bytes in size.
             // Pushing a new one to the database can cause it to be written
@@ -3205,8 +3384,10 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             }
             pblocktree->Sync();
             // Finally flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            if (!pcoinsTip->Sync())
                 return state.Abort("Failed to write to coin database");
+            if (fCacheFull)
+                pcoinsTip->Trim(nCoinCacheUsage / 100 * COINS_CACHE_KEEP_PERCENT);
             // Update best block in wallet (so we can detect restored wallets).
             if (mode != FLUSH_STATE_IF_NEEDED) {
                 g_signals.SetBestChain(chainActive.GetLocator());
@@ -3238,10 +3419,10 @@ void static UpdateTip(CBlockIndex* pindexNew)
     nTimeBestReceived = GetTime();
     mempool.AddTransactionsUpdated(1);
 
-    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%u\n",
+    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%.1fMiB(%utx)\n",
         chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(), log(chainActive.Tip()->nChainWork.getdouble()) / log(2.0), (unsigned long)chainActive.Tip()->nChainTx,
         DateTimeStrFormat("%Y-%m-%d %H:%M:%S", chainActive.Tip()->GetBlockTime()),
-        Checkpoints::GuessVerificationProgress(chainActive.Tip()), (unsigned int)pcoinsTip->GetCacheSize());
+        Checkpoints::GuessVerificationProgress(chainActive.Tip()), pcoinsTip->DynamicMemoryUsage() * (1.0 / (1 << 20)), pcoinsTip->GetCacheSize());
 
     cvBlockChange.notify_all();
 
@@ -4128,7 +4309,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     return true;
 }
 
-bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev)
+bool CheckWork(const CBlock& block, CBlockIndex* const pindexPrev)
 {
     if (pindexPrev == NULL)
         return error("%s : null pindexPrev for block %s", __func__, block.GetHash().ToString().c_str());
@@ -4152,7 +4333,9 @@ bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev)
         uint256 hashProofOfStake;
         uint256 hash = block.GetHash();
 
-        if(!CheckProofOfStake(block, hashProofOfStake)) {
+        // the coinstake's kernel input is verified on the script check threads meanwhile
+        CCheckQueueControl<CScriptCheck> control(nScriptCheckThreads ? &scriptcheckqueue : NULL);
+        if (!CheckProofOfStake(block, pindexPrev, hashProofOfStake, nScriptCheckThreads ? &control : NULL) || !control.Wait()) {
             LogPrintf("WARNING: ProcessBlock(): check proof-of-stake failed for block %s\n", hash.ToString().c_str());
             return false;
         }
@@ -4458,11 +4641,34 @@ void CBlockIndex::BuildSkip()
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
 }
 
-bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDiskBlockPos* dbp)
+bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDiskBlockPos* dbp, bool fPrechecked)
 {
     // Preliminary checks
     int64_t nStartTime = GetTimeMillis();
-    bool checked = CheckBlock(*pblock, state);
+    uint64_t nStartHashes = CBlockHeader::GetHashCount();
+
+    // The merkle root and the block signature are checked on the block check
+    // threads while the rest of CheckBlock runs here
+    bool checked;
+    {
+        TRY_LOCK(cs_blockcheckqueue, lockBlockCheck);
+        bool fParallel = !fPrechecked && nScriptCheckThreads && lockBlockCheck;
+        CCheckQueueControl<CBlockCheck> control(fParallel ? &blockcheckqueue : NULL);
+        if (fParallel) {
+            pblock->GetHash(); // cache the hash before the checks share the block
+            std::vector<CBlockCheck> vChecks;
+            vChecks.push_back(CBlockCheck(*pblock, CBlockCheck::MERKLE_ROOT));
+            vChecks.push_back(CBlockCheck(*pblock, CBlockCheck::BLOCK_SIGNATURE));
+            control.Add(vChecks);
+        }
+        checked = CheckBlock(*pblock, state, true, !fPrechecked && !fParallel);
+        if (fParallel) {
+            if (control.Wait())
+                fPrechecked = true;
+            else if (checked)
+                checked = CheckBlock(*pblock, state); // to find out which check failed
+        }
+    }
 
     int nMints = 0;
     int nSpends = 0;
@@ -4488,7 +4694,7 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDis
     //    return error("ProcessNewBlock() : duplicate proof-of-stake (%s, %d) for block %s", pblock->GetProofOfStake().first.ToString().c_str(), pblock->GetProofOfStake().second, pblock->GetHash().ToString().c_str());
 
     // NovaCoin: check proof-of-stake block signature
-    if (!pblock->CheckBlockSignature())
+    if (!fPrechecked && !pblock->CheckBlockSignature())
         return error("ProcessNewBlock() : bad proof-of-stake block signature");
 
     if (pblock->GetHash() != Params().HashGenesisBlock() && pfrom != NULL) {
@@ -4542,6 +4748,7 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDis
 
     LogPrintf("%s : ACCEPTED in %ld milliseconds with size=%d\n", __func__, GetTimeMillis() - nStartTime,
               pblock->GetSerializeSize(SER_DISK, CLIENT_VERSION));
+    LogPrint("bench", "%s : %u header hashes computed while processing the block\n", __func__, CBlockHeader::GetHashCount() - nStartHashes);
 
     return true;
 }
@@ -4892,7 +5099,7 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
             }
         }
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.GetCacheSize() + pcoinsTip->GetCacheSize()) <= nCoinCacheSize) {
+        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             bool fClean = true;
             if (!DisconnectBlock(block, state, pindex, coins, &fClean))
                 return error("VerifyDB() : *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
@@ -4986,97 +5193,175 @@ bool InitBlockIndex()
 }
 
 
+// Map of disk positions for blocks with unknown parent (only used for reindex)
+static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+
+/**
+ * Process a block found in a block file, and the blocks found earlier that were
+ * waiting for it as their parent.
+ * @return false if processing hit an error that should stop the import
+ */
+static bool ProcessImportedBlock(CBlock& block, CDiskBlockPos* dbp, bool fPrechecked, int& nLoaded)
+{
+    // detect out of order blocks, and store them for later
+    uint256 hash = block.GetHash();
+    if (hash != Params().HashGenesisBlock() && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+        LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+            block.hashPrevBlock.ToString());
+        if (dbp)
+            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+        return true;
+    }
+
+    // process in case the block isn't known yet
+    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+        CValidationState state;
+        if (ProcessNewBlock(state, NULL, &block, dbp, fPrechecked))
+            nLoaded++;
+        if (state.IsError())
+            return false;
+    } else if (hash != Params().HashGenesisBlock() && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+        LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+    }
+
+    // Recursively process earlier encountered successors of this block
+    deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+            if (ReadBlockFromDisk(block, it->second)) {
+                LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                    head.ToString());
+                CValidationState dummy;
+                if (ProcessNewBlock(dummy, NULL, &block, &it->second)) {
+                    nLoaded++;
+                    queue.push_back(block.GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+        }
+    }
+    return true;
+}
+
+/**
+ * Find and process the blocks in blkdat, a CBufferedFile or a CMemoryReader.
+ * pfile is the mapped block file blkdat reads from, if any.
+ */
+template <typename Stream>
+static void LoadExternalBlocks(Stream& blkdat, CDiskBlockPos* dbp, const CMappedBlockFile* pfile, int& nLoaded)
+{
+    uint64_t nRewind = blkdat.GetPos();
+    while (!blkdat.eof()) {
+        boost::this_thread::interruption_point();
+
+        blkdat.SetPos(nRewind);
+        nRewind++;         // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[MESSAGE_START_SIZE];
+            blkdat.FindByte(Params().MessageStart()[0]);
+            nRewind = blkdat.GetPos() + 1;
+            blkdat >> FLATDATA(buf);
+            if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            break;
+        }
+        try {
+            // read block
+            uint64_t nBlockPos = blkdat.GetPos();
+            if (dbp)
+                dbp->nPos = nBlockPos;
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            CBlock block;
+            blkdat >> block;
+            nRewind = blkdat.GetPos();
+            if (pfile)
+                pfile->NoteRead(nBlockPos, nSize);
+
+            if (!ProcessImportedBlock(block, dbp, false, nLoaded))
+                return;
+        } catch (std::exception& e) {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+}
+
+/**
+ * Find and process the blocks in a mapped block file of our own, with the
+ * decoding and the context-free checks spread over the -reindexthreads.
+ */
+static void LoadExternalBlocksPipelined(const CMappedBlockFileRef& file, CDiskBlockPos* dbp, int& nLoaded)
+{
+    CBlockImportPipeline pipeline(file, Params().MessageStart(), nReindexThreads);
+    int64_t nTimeConnect = 0;
+    CImportedBlockRef item;
+    while (pipeline.Next(item)) {
+        boost::this_thread::interruption_point();
+
+        if (!item->fDecoded) {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, item->strError);
+            // start one byte further, like the serial scanner
+            pipeline.Restart(item->nHeaderPos + 1);
+            continue;
+        }
+        if (item->nEnd != item->nPos + item->nSize) {
+            // the next block starts somewhere else than the reader assumed
+            pipeline.Restart(item->nEnd);
+        }
+
+        int64_t nTimeStart = GetTimeMicros();
+        dbp->nPos = item->nPos;
+        bool fContinue = ProcessImportedBlock(item->block, dbp, item->fPrechecked, nLoaded);
+        nTimeConnect += GetTimeMicros() - nTimeStart;
+        if (!fContinue)
+            break;
+    }
+
+    CBlockImportStats stats = pipeline.GetStats();
+    if (stats.nBlocks > 0)
+        LogPrintf("Reindex %s: %u blocks, %d threads: read %.2fms, decode %.2fms, check %.2fms, wait %.2fms, connect %.2fms, queue depth %.1f avg %u max\n",
+            GetBlockPosFilename(*dbp, "blk").filename().string(), stats.nBlocks, nReindexThreads,
+            stats.nTimeRead * 0.001, stats.nTimeDecode * 0.001, stats.nTimeCheck * 0.001, stats.nTimeWait * 0.001, nTimeConnect * 0.001,
+            (double)stats.nDepthSum / stats.nBlocks, stats.nDepthMax);
+}
+
 bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != Params().HashGenesisBlock() && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                        block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
-
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    CValidationState state;
-                    if (ProcessNewBlock(state, NULL, &block, dbp))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != Params().HashGenesisBlock() && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
-
-                // Recursively process earlier encountered successors of this block
-                deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
-                                head.ToString());
-                            CValidationState dummy;
-                            if (ProcessNewBlock(dummy, NULL, &block, &it->second)) {
-                                nLoaded++;
-                                queue.push_back(block.GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                    }
-                }
-            } catch (std::exception& e) {
-                LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+        // Block files of our own (during reindex) are scanned through their mapping
+        CMappedBlockFileRef file;
+        if (dbp)
+            file = blockFileMap.Get(dbp->nFile, GetBlockPosFilename(*dbp, "blk"), 0);
+        if (file) {
+            fclose(fileIn);
+            if (nReindexThreads > 0) {
+                LoadExternalBlocksPipelined(file, dbp, nLoaded);
+            } else {
+                CMemoryReader blkdat(file->begin(), file->size(), SER_DISK, CLIENT_VERSION);
+                LoadExternalBlocks(blkdat, dbp, file.get(), nLoaded);
             }
+        } else {
+            // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+            CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
+            LoadExternalBlocks(blkdat, dbp, NULL, nLoaded);
         }
     } catch (std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
@@ -6465,6 +6750,10 @@ bool ProcessMessages(CNode* pfrom)
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return fOk;
 
+    // get the masternode signatures waiting in the queue checked while the messages before them are processed
+    if (!fLiteMode && masternodeSync.IsBlockchainSynced())
+        QueueMasternodeSignatures(pfrom->vRecvMsg);
+
     std::deque<CNetMessage>::iterator it = pfrom->vRecvMsg.begin();
     while (!pfrom->fDisconnect && it != pfrom->vRecvMsg.end()) {
         // Don't bother if send buffer is too full to respond anyway
@@ -128,6 +128,7 @@ CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments&
 
         // de-serialize data into CMasternodePayments object
         ssObj >> objToLoad;
+        objToLoad.RebuildLastPaidIndex();
     } catch (std::exception& e) {
         objToLoad.Clear();
         error("%s : Deserialize or I/O error - %s", __func__, e.what());
@@ -448,14 +449,19 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
     }
 }
 
+std::string CMasternodePaymentWinner::GetStrMessage() const
+{
+    return vinMasternode.prevout.ToStringShort() +
+           boost::lexical_cast<std::string>(nBlockHeight) +
+           payee.ToString();
+}
+
 bool CMasternodePaymentWinner::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 {
     std::string errorMessage;
     std::string strMasterNodeSignMessage;
 
-    std::string strMessage = vinMasternode.prevout.ToStringShort() +
-                             boost::lexical_cast<std::string>(nBlockHeight) +
-                             payee.ToString();
+    std::string strMessage = GetStrMessage();
 
     if (!obfuScationSigner.SignMessage(strMessage, errorMessage, vchSig, keyMasternode)) {
         LogPrint("masternode","CMasternodePing::Sign() - Error: %s\n", errorMessage.c_str());
@@ -530,13 +536,74 @@ bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerI
             CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
             mapMasternodeBlocks[winnerIn.nBlockHeight] = blockPayees;
         }
-    }
 
-    mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+        CMasternodeBlockPayees& blockPayees = mapMasternodeBlocks[winnerIn.nBlockHeight];
+        blockPayees.AddPayee(winnerIn.payee, 1);
+        if (blockPayees.HasPayeeWithVotes(winnerIn.payee, MNPAYMENTS_LASTPAID_MIN_VOTES)) {
+            AddLastPaid(winnerIn.payee, winnerIn.nBlockHeight);
+        }
+    }
 
     return true;
 }
 
+void CMasternodePayments::AddLastPaid(const CScript& payee, int nBlockHeight)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    mapPayeeLastPaid[payee].insert(nBlockHeight);
+}
+
+void CMasternodePayments::EraseLastPaid(int nBlockHeight)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    std::map<int, CMasternodeBlockPayees>::iterator itBlock = mapMasternodeBlocks.find(nBlockHeight);
+    if (itBlock == mapMasternodeBlocks.end()) return;
+
+    LOCK(cs_vecPayments);
+    BOOST_FOREACH (CMasternodePayee& p, itBlock->second.vecPayments) {
+        std::map<CScript, std::set<int> >::iterator it = mapPayeeLastPaid.find(p.scriptPubKey);
+        if (it == mapPayeeLastPaid.end()) continue;
+
+        it->second.erase(nBlockHeight);
+        if (it->second.empty()) mapPayeeLastPaid.erase(it);
+    }
+}
+
+// Most recent height in (nTipHeight - nDepth, nTipHeight] at which payee won with enough votes, 0 if none
+int CMasternodePayments::GetLastPaidHeight(const CScript& payee, int nTipHeight, int nDepth)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    std::map<CScript, std::set<int> >::const_iterator it = mapPayeeLastPaid.find(payee);
+    if (it == mapPayeeLastPaid.end()) return 0;
+
+    // votes for future blocks are ignored, as are heights left behind by a reorg to a shorter chain
+    std::set<int>::const_iterator itHeight = it->second.upper_bound(nTipHeight);
+    if (itHeight == it->second.begin()) return 0;
+    --itHeight;
+
+    if (*itHeight <= 0 || *itHeight <= nTipHeight - nDepth) return 0;
+    return *itHeight;
+}
+
+void CMasternodePayments::RebuildLastPaidIndex()
+{
+    LOCK2(cs_mapMasternodeBlocks, cs_vecPayments);
+
+    mapPayeeLastPaid.clear();
+    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.begin();
+    while (it != mapMasternodeBlocks.end()) {
+        BOOST_FOREACH (CMasternodePayee& p, it->second.vecPayments) {
+            if (p.nVotes >= MNPAYMENTS_LASTPAID_MIN_VOTES) {
+                AddLastPaid(p.scriptPubKey, it->first);
+            }
+        }
+        ++it;
+    }
+}
+
 bool CMasternodeBlockPayees::IsTransactionValid(const CTransaction& txNew)
 {
     LOCK(cs_vecPayments);
@@ -689,6 +756,7 @@ void CMasternodePayments::CleanPaymentList()
             LogPrint("mnpayments", "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.nBlockHeight);
             masternodeSync.mapSeenSyncMNW.erase((*it).first);
             mapMasternodePayeeVotes.erase(it++);
+            EraseLastPaid(winner.nBlockHeight);
             mapMasternodeBlocks.erase(winner.nBlockHeight);
         } else {
             ++it;
@@ -870,9 +938,7 @@ bool CMasternodePaymentWinner::SignatureValid()
     CMasternode* pmn = mnodeman.Find(vinMasternode);
 
     if (pmn != NULL) {
-        std::string strMessage = vinMasternode.prevout.ToStringShort() +
-                                 boost::lexical_cast<std::string>(nBlockHeight) +
-                                 payee.ToString();
+        std::string strMessage = GetStrMessage();
 
         std::string errorMessage = "";
         if (!obfuScationSigner.VerifyMessage(pmn->pubKeyMasternode, vchSig, strMessage, errorMessage)) {
@@ -26,6 +26,7 @@ extern CMasternodePayments masternodePayments;
 #define MNPAYMENTS_SIGNATURES_REQUIRED 6
 #define MNPAYMENTS_SIGNATURES_TOTAL 10
 #define MNPAYMENTS_FIX_WINNER_CHECK 1295500 // 1127100 can be used for testing
+#define MNPAYMENTS_LASTPAID_MIN_VOTES 2
 
 void ProcessMessageMasternodePayments(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 bool IsBlockPayeeValid(const CBlock& block, int nBlockHeight);
@@ -193,6 +194,7 @@ public:
         return ss.GetHash();
     }
 
+    std::string GetStrMessage() const;
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool IsValid(CNode* pnode, std::string& strError);
     bool SignatureValid();
@@ -237,6 +239,13 @@ private:
     int nSyncedFromPeer;
     int nLastBlockHeight;
 
+    // payee -> block heights where it is a winner with at least MNPAYMENTS_LASTPAID_MIN_VOTES votes,
+    // kept in step with mapMasternodeBlocks so last paid lookups don't walk the chain per masternode
+    std::map<CScript, std::set<int> > mapPayeeLastPaid;
+
+    void AddLastPaid(const CScript& payee, int nBlockHeight);
+    void EraseLastPaid(int nBlockHeight);
+
 public:
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
@@ -253,6 +262,7 @@ public:
         LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
         mapMasternodeBlocks.clear();
         mapMasternodePayeeVotes.clear();
+        mapPayeeLastPaid.clear();
     }
 
     bool AddWinningMasternode(CMasternodePaymentWinner& winner);
@@ -264,6 +274,8 @@ public:
     void Sync(CNode* node, int nCountNeeded);
     void CleanPaymentList();
     int LastPayment(CMasternode& mn);
+    int GetLastPaidHeight(const CScript& payee, int nTipHeight, int nDepth);
+    void RebuildLastPaidIndex();
 
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight);
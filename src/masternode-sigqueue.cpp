@@ -0,0 +1,215 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-sigqueue.h"
+
+#include "hash.h"
+#include "masternode-budget.h"
+#include "masternode-payments.h"
+#include "masternode.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "obfuscation.h"
+#include "util.h"
+
+CMasternodeSigQueue masternodeSigQueue;
+
+uint256 CMasternodeSigQueue::GetEntryHash(const uint256& hashMessage, const std::vector<unsigned char>& vchSig)
+{
+    return Hash(hashMessage.begin(), hashMessage.end(), vchSig.begin(), vchSig.end());
+}
+
+void CMasternodeSigQueue::Thread()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    nWorkers++;
+    try {
+        while (true) {
+            while (queueWork.empty())
+                condWorker.wait(lock);
+            uint256 hash = queueWork.front();
+            queueWork.pop_front();
+            std::map<uint256, CEntry>::iterator it = mapEntries.find(hash);
+            if (it == mapEntries.end() || it->second.state != QUEUED)
+                continue; // recovered by Recover() meanwhile
+            it->second.state = RUNNING;
+            uint256 hashMessage = it->second.hashMessage;
+            std::vector<unsigned char> vchSig = it->second.vchSig;
+
+            lock.unlock();
+            CPubKey pubkey;
+            bool fRecovered = pubkey.RecoverCompact(hashMessage, vchSig);
+            lock.lock();
+
+            // running entries are neither evicted nor picked up, so it is still valid
+            it->second.state = DONE;
+            it->second.fRecovered = fRecovered;
+            it->second.pubkey = pubkey;
+            condDone.notify_all();
+        }
+    } catch (...) {
+        nWorkers--;
+        throw;
+    }
+}
+
+void CMasternodeSigQueue::Add(const uint256& hashMessage, const std::vector<unsigned char>& vchSig)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (!nWorkers)
+            return;
+
+        // forget the entries picked up already, the ones nobody asked for in time,
+        // and the oldest ones if there are too many
+        int64_t nNow = GetTime();
+        while (!queueOrder.empty()) {
+            std::map<uint256, CEntry>::iterator it = mapEntries.find(queueOrder.front());
+            if (it != mapEntries.end()) {
+                if (it->second.state == RUNNING)
+                    break;
+                if (mapEntries.size() < MAX_MASTERNODE_SIGS_QUEUED && it->second.nTimeAdded > nNow - MASTERNODE_SIGS_QUEUE_TIMEOUT)
+                    break;
+                mapEntries.erase(it);
+            }
+            queueOrder.pop_front();
+        }
+        if (mapEntries.size() >= MAX_MASTERNODE_SIGS_QUEUED)
+            return;
+
+        uint256 hash = GetEntryHash(hashMessage, vchSig);
+        if (mapEntries.count(hash))
+            return;
+
+        CEntry& entry = mapEntries[hash];
+        entry.hashMessage = hashMessage;
+        entry.vchSig = vchSig;
+        entry.state = QUEUED;
+        entry.fRecovered = false;
+        entry.nTimeAdded = nNow;
+        queueOrder.push_back(hash);
+        queueWork.push_back(hash);
+    }
+    condWorker.notify_one();
+}
+
+bool CMasternodeSigQueue::Recover(const uint256& hashMessage, const std::vector<unsigned char>& vchSig, CPubKey& pubkey)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (!mapEntries.empty()) {
+            std::map<uint256, CEntry>::iterator it = mapEntries.find(GetEntryHash(hashMessage, vchSig));
+            if (it != mapEntries.end()) {
+                while (it->second.state == RUNNING)
+                    condDone.wait(lock);
+                if (it->second.state == DONE) {
+                    bool fRecovered = it->second.fRecovered;
+                    pubkey = it->second.pubkey;
+                    mapEntries.erase(it);
+                    return fRecovered;
+                }
+                // still queued, quicker to recover it here than to wait for a worker
+                mapEntries.erase(it);
+            }
+        }
+    }
+    return pubkey.RecoverCompact(hashMessage, vchSig);
+}
+
+unsigned int CMasternodeSigQueue::size()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return mapEntries.size();
+}
+
+bool CMasternodeSigQueue::HasWorkers()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return nWorkers > 0;
+}
+
+void ThreadMasternodeSigCheck()
+{
+    RenameThread("papara-mnsigch");
+    masternodeSigQueue.Thread();
+}
+
+void QueueMasternodeSignatures(std::deque<CNetMessage>& vRecvMsg)
+{
+    if (!masternodeSigQueue.HasWorkers())
+        return;
+
+    // messages are appended as they arrive, so the ones not looked at yet are at the end
+    std::deque<CNetMessage>::iterator it = vRecvMsg.end();
+    while (it != vRecvMsg.begin()) {
+        std::deque<CNetMessage>::iterator itPrev = it;
+        if ((--itPrev)->fSigsQueued)
+            break;
+        it = itPrev;
+    }
+
+    for (; it != vRecvMsg.end() && it->complete(); ++it) {
+        it->fSigsQueued = true;
+        std::string strCommand = it->hdr.GetCommand();
+        try {
+            CDataStream vRecv(it->vRecv.begin(), it->vRecv.end(), it->vRecv.GetType(), it->vRecv.GetVersion());
+            // skip what the handlers drop before they check the signature: messages
+            // seen before, and messages of masternodes not in the list
+            if (strCommand == "mnb") {
+                CMasternodeBroadcast mnb;
+                vRecv >> mnb;
+                if (mnodeman.mapSeenMasternodeBroadcast.count(mnb.GetHash()))
+                    continue;
+                masternodeSigQueue.Add(obfuScationSigner.GetMessageHash(mnb.GetStrMessage()), mnb.sig);
+                if (!mnb.lastPing.vchSig.empty())
+                    masternodeSigQueue.Add(obfuScationSigner.GetMessageHash(mnb.lastPing.GetStrMessage()), mnb.lastPing.vchSig);
+            } else if (strCommand == "mnp") {
+                CMasternodePing mnp;
+                vRecv >> mnp;
+                if (mnodeman.mapSeenMasternodePing.count(mnp.GetHash()))
+                    continue;
+                // a ping too soon after the last one is not checked either
+                CMasternode* pmn = mnodeman.Find(mnp.vin);
+                if (pmn == NULL || pmn->IsPingedWithin(MASTERNODE_MIN_MNP_SECONDS - 60, mnp.sigTime))
+                    continue;
+                masternodeSigQueue.Add(obfuScationSigner.GetMessageHash(mnp.GetStrMessage()), mnp.vchSig);
+            } else if (strCommand == "mnw") {
+                CMasternodePaymentWinner winner;
+                vRecv >> winner;
+                {
+                    LOCK(cs_mapMasternodePayeeVotes);
+                    if (masternodePayments.mapMasternodePayeeVotes.count(winner.GetHash()))
+                        continue;
+                }
+                if (mnodeman.Find(winner.vinMasternode) == NULL)
+                    continue;
+                masternodeSigQueue.Add(obfuScationSigner.GetMessageHash(winner.GetStrMessage()), winner.vchSig);
+            } else if (strCommand == "mvote") {
+                CBudgetVote vote;
+                vRecv >> vote;
+                {
+                    LOCK(cs_budget);
+                    if (budget.mapSeenMasternodeBudgetVotes.count(vote.GetHash()))
+                        continue;
+                }
+                if (mnodeman.Find(vote.vin) == NULL)
+                    continue;
+                masternodeSigQueue.Add(obfuScationSigner.GetMessageHash(vote.GetStrMessage()), vote.vchSig);
+            } else if (strCommand == "fbvote") {
+                CFinalizedBudgetVote vote;
+                vRecv >> vote;
+                {
+                    LOCK(cs_budget);
+                    if (budget.mapSeenFinalizedBudgetVotes.count(vote.GetHash()))
+                        continue;
+                }
+                if (mnodeman.Find(vote.vin) == NULL)
+                    continue;
+                masternodeSigQueue.Add(obfuScationSigner.GetMessageHash(vote.GetStrMessage()), vote.vchSig);
+            }
+        } catch (const std::exception& e) {
+            // malformed, ProcessMessage reports it
+        }
+    }
+}
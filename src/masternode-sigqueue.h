@@ -0,0 +1,95 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_SIGQUEUE_H
+#define MASTERNODE_SIGQUEUE_H
+
+#include "pubkey.h"
+#include "uint256.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CNetMessage;
+class CMasternodeSigQueue;
+
+/** Maximum number of signatures recovered ahead of their messages */
+static const unsigned int MAX_MASTERNODE_SIGS_QUEUED = 20000;
+/** Seconds after which a signature whose message never asked for it is forgotten */
+static const int64_t MASTERNODE_SIGS_QUEUE_TIMEOUT = 60;
+
+extern CMasternodeSigQueue masternodeSigQueue;
+
+/**
+ * Recovers the keys of masternode message signatures on worker threads.
+ *
+ * After startup or a dseg reply, thousands of mnb and mnp messages wait in a
+ * peer's receive queue, and the message handler used to recover the key of
+ * each signature in turn. Recovering a key needs nothing but the signed
+ * message and the signature, so QueueMasternodeSignatures() hands them to the
+ * workers as soon as the messages are received. The messages are still
+ * processed one at a time and in order, and Recover() picks up the key a
+ * worker found, or recovers it right away if no worker got to it yet; the
+ * checks against the masternode list and all state changes stay where they
+ * were. Messages the handlers drop before looking at the signature are not
+ * queued, and the keys of the ones dropped later are forgotten after
+ * MASTERNODE_SIGS_QUEUE_TIMEOUT seconds.
+ */
+class CMasternodeSigQueue
+{
+private:
+    enum State {
+        QUEUED,
+        RUNNING,
+        DONE
+    };
+
+    struct CEntry {
+        uint256 hashMessage;
+        std::vector<unsigned char> vchSig;
+        State state;
+        bool fRecovered;
+        CPubKey pubkey;
+        int64_t nTimeAdded;
+    };
+
+    boost::mutex cs;
+    boost::condition_variable condWorker;
+    boost::condition_variable condDone;
+    std::map<uint256, CEntry> mapEntries; // by hash of message hash and signature
+    std::deque<uint256> queueWork;        // entries not picked up by a worker yet
+    std::deque<uint256> queueOrder;       // entries in the order they were added, for eviction
+    int nWorkers;
+
+    static uint256 GetEntryHash(const uint256& hashMessage, const std::vector<unsigned char>& vchSig);
+
+public:
+    CMasternodeSigQueue() : nWorkers(0) {}
+
+    //! Worker thread, runs until interrupted
+    void Thread();
+
+    //! Recover the key of a signature on a worker, if there are any
+    void Add(const uint256& hashMessage, const std::vector<unsigned char>& vchSig);
+
+    //! Key of the signature, from a worker if it was added before
+    bool Recover(const uint256& hashMessage, const std::vector<unsigned char>& vchSig, CPubKey& pubkey);
+
+    //! Number of signatures added and not picked up by Recover() yet
+    unsigned int size();
+
+    bool HasWorkers();
+};
+
+/** Add the signatures of the masternode messages received since the last call */
+void QueueMasternodeSignatures(std::deque<CNetMessage>& vRecvMsg);
+
+void ThreadMasternodeSigCheck();
+
+#endif
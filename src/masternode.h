@@ -61,6 +61,7 @@ public:
     }
 
     bool CheckAndUpdate(int& nDos, bool fRequireEnabled = true);
+    std::string GetStrMessage() const;
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     void Relay();
 
@@ -224,6 +225,7 @@ public:
     }
 
     int64_t SecondsSincePayment();
+    int64_t SecondsSincePayment(int nLastPaidDepth);
 
     bool UpdateFromNewBroadcast(CMasternodeBroadcast& mnb);
 
@@ -288,6 +290,7 @@ public:
     }
 
     int64_t GetLastPaid();
+    int64_t GetLastPaid(int nLastPaidDepth);
     bool IsValidNetAddr();
 };
 
@@ -305,6 +308,7 @@ public:
 
     bool CheckAndUpdate(int& nDoS);
     bool CheckInputsAndAdd(int& nDos);
+    std::string GetStrMessage() const;
     bool Sign(CKey& keyCollateralAddress);
     void Relay();
 
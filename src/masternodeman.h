@@ -14,8 +14,16 @@
 #include "sync.h"
 #include "util.h"
 
+#include <list>
+#include <tuple>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
 #define MASTERNODES_DUMP_SECONDS (15 * 60)
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
+// number of (block height, protocol) rankings kept, votes come in for a handful of heights at a time
+#define MASTERNODE_RANKINGS_CACHED 16
 
 using namespace std;
 
@@ -48,6 +56,33 @@ public:
     ReadResult Read(CMasternodeMan& mnodemanToLoad, bool fDryRun = false);
 };
 
+struct OutPointHasher {
+    size_t operator()(const COutPoint& out) const { return out.hash.GetLow64() ^ out.n; }
+};
+
+struct ScriptHasher {
+    size_t operator()(const CScript& script) const { return boost::hash_range(script.begin(), script.end()); }
+};
+
+struct PubKeyHasher {
+    size_t operator()(const CPubKey& pubkey) const { return boost::hash_range(pubkey.begin(), pubkey.end()); }
+};
+
+/**
+ * The masternodes ranked by score for one block. Rank n is vRanked[n - 1], the
+ * pointers stay valid until the masternode list changes.
+ */
+class CMasternodeRanking
+{
+public:
+    uint256 blockHash;
+    int64_t nTimeCreated;
+    std::vector<CMasternode*> vRanked;
+    boost::unordered_map<COutPoint, int, OutPointHasher> mapRank;
+
+    CMasternodeRanking() : blockHash(0), nTimeCreated(0) {}
+};
+
 class CMasternodeMan
 {
 private:
@@ -57,8 +92,12 @@ private:
     // critical section to protect the inner data structures specifically on messaging
     mutable CCriticalSection cs_process_message;
 
-    // map to hold all MNs
-    std::vector<CMasternode> vMasternodes;
+    // list to hold all MNs, entries stay in place while others are added and removed
+    std::list<CMasternode> listMasternodes;
+    // indexes into listMasternodes for Find, on duplicate keys the entry that came first wins
+    boost::unordered_map<COutPoint, std::list<CMasternode>::iterator, OutPointHasher> mapByOutPoint;
+    boost::unordered_map<CScript, std::list<CMasternode>::iterator, ScriptHasher> mapByPayee;
+    boost::unordered_map<CPubKey, std::list<CMasternode>::iterator, PubKeyHasher> mapByPubKey;
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -66,6 +105,16 @@ private:
     // which Masternodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
 
+    // rankings by block height, minimum protocol, active only and minimum age. Masternodes change
+    // state at most once per MASTERNODE_CHECK_SECONDS, so a ranking is kept for as long or until
+    // the list changes
+    typedef std::tuple<int64_t, int, bool, bool> RankingKey;
+    std::map<RankingKey, CMasternodeRanking> mapRankings;
+
+    const CMasternodeRanking* GetRanking(int64_t nBlockHeight, int minProtocol, bool fOnlyActive, bool fMinAge);
+
+    void IndexMasternode(std::list<CMasternode>::iterator it);
+
 public:
     // Keep track of all broadcasts I've seen
     map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
@@ -81,7 +130,16 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
     {
         LOCK(cs);
+        // stored as a vector, like it used to be kept in memory
+        std::vector<CMasternode> vMasternodes;
+        if (!ser_action.ForRead())
+            vMasternodes.assign(listMasternodes.begin(), listMasternodes.end());
         READWRITE(vMasternodes);
+        if (ser_action.ForRead()) {
+            listMasternodes.assign(vMasternodes.begin(), vMasternodes.end());
+            mapRankings.clear();
+            ReindexMasternodes();
+        }
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -133,19 +191,26 @@ public:
     std::vector<CMasternode> GetFullMasternodeVector()
     {
         Check();
-        return vMasternodes;
+        LOCK(cs);
+        return std::vector<CMasternode>(listMasternodes.begin(), listMasternodes.end());
     }
 
     std::vector<pair<int, CMasternode> > GetMasternodeRanks(int64_t nBlockHeight, int minProtocol = 0);
     int GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
     CMasternode* GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
 
+    /// Drop the cached rankings, for changes to the list or to a masternode's protocol and age
+    void InvalidateRankings();
+
+    /// Rebuild the indexes used by Find, after a masternode's keys changed
+    void ReindexMasternodes();
+
     void ProcessMasternodeConnections();
 
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
     /// Return the number of (unique) Masternodes
-    int size() { return vMasternodes.size(); }
+    int size() { return listMasternodes.size(); }
 
     /// Return the number of Masternodes older than (default) 8000 seconds
     int stable_size ();
@@ -93,6 +93,409 @@ void UpdateTime(CBlockHeader* pblock, const CBlockIndex* pindexPrev)
         pblock->nBits = GetNextWorkRequired(pindexPrev, pblock);
 }
 
+/**
+ * The mempool transactions picked for the next block, kept between calls to
+ * CreateNewBlock. While the tip stays the same, transactions entering the
+ * pool are appended to it; it is only rebuilt when the tip moves, one of its
+ * transactions leaves the pool or the block size settings change.
+ */
+class CBlockTxSelection
+{
+public:
+    uint256 hashPrevBlock;
+    unsigned int nTransactionsUpdated;
+    unsigned int nBlockMaxSize;
+    unsigned int nBlockPrioritySize;
+    unsigned int nBlockMinSize;
+
+    vector<CTransaction> vtx;
+    vector<CAmount> vTxFees;
+    vector<int64_t> vTxSigOps;
+    set<uint256> setTxHashes;
+    vector<CBigNum> vBlockSerials;
+    uint64_t nBlockSize;
+    int nBlockSigOps;
+    CAmount nFees;
+    //! the chain state with the selected transactions applied, on top of pcoinsBase
+    unique_ptr<CCoinsViewCache> pview;
+    CCoinsViewCache* pcoinsBase;
+    //! a block with the transactions as built from scratch passed TestBlockValidity
+    bool fValidated;
+
+    CBlockTxSelection()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        hashPrevBlock = 0;
+        nTransactionsUpdated = 0;
+        nBlockMaxSize = nBlockPrioritySize = nBlockMinSize = 0;
+        vtx.clear();
+        vTxFees.clear();
+        vTxSigOps.clear();
+        setTxHashes.clear();
+        vBlockSerials.clear();
+        nBlockSize = 1000;
+        nBlockSigOps = 100;
+        nFees = 0;
+        pview.reset();
+        pcoinsBase = NULL;
+        fValidated = false;
+    }
+
+    //! whether tx fits the size and sigop limits, and pays enough once past the minimum size
+    bool Fits(const CTransaction& tx, unsigned int nTxSize, const CFeeRate& feeRate, bool fSortedByFee) const
+    {
+        if (nBlockSize + nTxSize >= nBlockMaxSize)
+            return false;
+
+        // Legacy limits on sigOps:
+        if (nBlockSigOps + GetLegacySigOpCount(tx) >= MAX_BLOCK_SIGOPS_CURRENT)
+            return false;
+
+        // Skip free transactions if we're past the minimum block size:
+        double dPriorityDelta = 0;
+        CAmount nFeeDelta = 0;
+        mempool.ApplyDeltas(tx.GetHash(), dPriorityDelta, nFeeDelta);
+        if (!tx.IsZerocoinSpend() && fSortedByFee && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
+            return false;
+
+        return true;
+    }
+
+    //! validate tx against the selection and add it; its inputs must be available
+    bool Add(const CTransaction& tx, unsigned int nTxSize, int nHeight)
+    {
+        CCoinsViewCache& view = *pview;
+
+        // double check that there are no double spent zpara spends in this block or tx
+        vector<CBigNum> vTxSerials;
+        if (tx.IsZerocoinSpend()) {
+            int nHeightTx = 0;
+            if (IsTransactionInChain(tx.GetHash(), nHeightTx))
+                return false;
+
+            for (const CTxIn txIn : tx.vin) {
+                if (txIn.scriptSig.IsZerocoinSpend()) {
+                    libzerocoin::CoinSpend spend = TxInToZerocoinSpend(txIn);
+                    if (!spend.HasValidSerial(Params().Zerocoin_Params()))
+                        return false;
+                    if (count(vBlockSerials.begin(), vBlockSerials.end(), spend.getCoinSerialNumber()))
+                        return false;
+                    if (count(vTxSerials.begin(), vTxSerials.end(), spend.getCoinSerialNumber()))
+                        return false;
+                    vTxSerials.emplace_back(spend.getCoinSerialNumber());
+                }
+            }
+        }
+
+        CAmount nTxFees = view.GetValueIn(tx) - tx.GetValueOut();
+
+        unsigned int nTxSigOps = GetLegacySigOpCount(tx) + GetP2SHSigOpCount(tx, view);
+        if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS_CURRENT)
+            return false;
+
+        // Note that flags: we don't want to set mempool/IsStandard()
+        // policy here, but we still have to ensure that the block we
+        // create only contains transactions that are valid in new blocks.
+        CValidationState state;
+        if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
+            return false;
+
+        CTxUndo txundo;
+        UpdateCoins(tx, state, view, txundo, nHeight);
+
+        // Added
+        vtx.push_back(tx);
+        vTxFees.push_back(nTxFees);
+        vTxSigOps.push_back(nTxSigOps);
+        setTxHashes.insert(tx.GetHash());
+        nBlockSize += nTxSize;
+        nBlockSigOps += nTxSigOps;
+        nFees += nTxFees;
+        vBlockSerials.insert(vBlockSerials.end(), vTxSerials.begin(), vTxSerials.end());
+        return true;
+    }
+};
+
+// guarded by cs_main and mempool.cs
+static CBlockTxSelection txSelection;
+
+static bool IsBlockCandidate(const CTransaction& tx, int nHeight)
+{
+    if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, nHeight))
+        return false;
+
+    if (GetAdjustedTime() > GetSporkValue(SPORK_16_ZEROCOIN_MAINTENANCE_MODE) && tx.ContainsZerocoins())
+        return false;
+
+    return true;
+}
+
+// Fill the selection from scratch, by priority first and then by fee rate
+static void BuildBlockTxSelection(int nHeight)
+{
+    CCoinsViewCache& view = *txSelection.pview;
+
+    // Priority order to process transactions
+    list<COrphan> vOrphan; // list memory doesn't move
+    map<uint256, vector<COrphan*> > mapDependers;
+    bool fPrintPriority = GetBoolArg("-printpriority", false);
+
+    // This vector will be sorted into a priority queue:
+    vector<TxPriority> vecPriority;
+    vecPriority.reserve(mempool.mapTx.size());
+    for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
+         mi != mempool.mapTx.end(); ++mi) {
+        const CTransaction& tx = mi->GetTx();
+        if (!IsBlockCandidate(tx, nHeight))
+            continue;
+
+        COrphan* porphan = NULL;
+        double dPriority = 0;
+        CAmount nTotalIn = 0;
+        bool fMissingInputs = false;
+        for (const CTxIn& txin : tx.vin) {
+            //zerocoinspend has special vin
+            if (tx.IsZerocoinSpend()) {
+                nTotalIn = tx.GetZerocoinSpent();
+                break;
+            }
+
+            // Read prev transaction
+            if (!view.HaveCoins(txin.prevout.hash)) {
+                // This should never happen; all transactions in the memory
+                // pool should connect to either transactions in the chain
+                // or other transactions in the memory pool.
+                CTxMemPool::txiter itPrev = mempool.mapTx.find(txin.prevout.hash);
+                if (itPrev == mempool.mapTx.end()) {
+                    LogPrintf("ERROR: mempool transaction missing input\n");
+                    if (fDebug) assert("mempool transaction missing input" == 0);
+                    fMissingInputs = true;
+                    if (porphan)
+                        vOrphan.pop_back();
+                    break;
+                }
+
+                // Has to wait for dependencies
+                if (!porphan) {
+                    // Use list for automatic deletion
+                    vOrphan.push_back(COrphan(&tx));
+                    porphan = &vOrphan.back();
+                }
+                mapDependers[txin.prevout.hash].push_back(porphan);
+                porphan->setDependsOn.insert(txin.prevout.hash);
+                nTotalIn += itPrev->GetTx().vout[txin.prevout.n].nValue;
+                continue;
+            }
+
+            const CCoins* coins = view.AccessCoins(txin.prevout.hash);
+            assert(coins);
+
+            CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
+            nTotalIn += nValueIn;
+
+            int nConf = nHeight - coins->nHeight;
+
+            dPriority += (double)nValueIn * nConf;
+        }
+        if (fMissingInputs) continue;
+
+        // Priority is sum(valuein * age) / modified_txsize
+        unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+        dPriority = tx.ComputePriority(dPriority, nTxSize);
+
+        uint256 hash = tx.GetHash();
+        mempool.ApplyDeltas(hash, dPriority, nTotalIn);
+
+        CFeeRate feeRate(nTotalIn - tx.GetValueOut(), nTxSize);
+
+        if (porphan) {
+            porphan->dPriority = dPriority;
+            porphan->feeRate = feeRate;
+        } else
+            vecPriority.push_back(TxPriority(dPriority, feeRate, &mi->GetTx()));
+    }
+
+    // Collect transactions into block
+    bool fSortedByFee = (txSelection.nBlockPrioritySize <= 0);
+
+    TxPriorityCompare comparer(fSortedByFee);
+    std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+
+    while (!vecPriority.empty()) {
+        // Take highest priority transaction off the priority queue:
+        double dPriority = vecPriority.front().get<0>();
+        CFeeRate feeRate = vecPriority.front().get<1>();
+        const CTransaction& tx = *(vecPriority.front().get<2>());
+
+        std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        vecPriority.pop_back();
+
+        unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+        if (!txSelection.Fits(tx, nTxSize, feeRate, fSortedByFee))
+            continue;
+
+        // Prioritise by fee once past the priority size or we run out of high-priority
+        // transactions:
+        if (!fSortedByFee &&
+            ((txSelection.nBlockSize + nTxSize >= txSelection.nBlockPrioritySize) || !AllowFree(dPriority))) {
+            fSortedByFee = true;
+            comparer = TxPriorityCompare(fSortedByFee);
+            std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        }
+
+        if (!view.HaveInputs(tx))
+            continue;
+
+        if (!txSelection.Add(tx, nTxSize, nHeight))
+            continue;
+
+        const uint256& hash = tx.GetHash();
+        if (fPrintPriority) {
+            LogPrintf("priority %.1f fee %s txid %s\n",
+                dPriority, feeRate.ToString(), hash.ToString());
+        }
+
+        // Add transactions that depend on this one to the priority queue
+        if (mapDependers.count(hash)) {
+            BOOST_FOREACH (COrphan* porphan, mapDependers[hash]) {
+                if (!porphan->setDependsOn.empty()) {
+                    porphan->setDependsOn.erase(hash);
+                    if (porphan->setDependsOn.empty()) {
+                        vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
+                        std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Append the transactions that entered the pool since the selection was
+// made, best package fee rate first
+static void ExtendBlockTxSelection(int nHeight)
+{
+    CCoinsViewCache& view = *txSelection.pview;
+
+    list<const CTxMemPoolEntry*> listCandidates;
+    CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi;
+    for (mi = mempool.mapTx.get<ancestor_score>().begin(); mi != mempool.mapTx.get<ancestor_score>().end(); ++mi) {
+        if (!txSelection.setTxHashes.count(mi->GetTx().GetHash()) && IsBlockCandidate(mi->GetTx(), nHeight))
+            listCandidates.push_back(&(*mi));
+    }
+
+    // a child can sort before its parent; retry it once the parent is in
+    bool fProgress = true;
+    while (fProgress && !listCandidates.empty()) {
+        fProgress = false;
+        list<const CTxMemPoolEntry*>::iterator it = listCandidates.begin();
+        while (it != listCandidates.end()) {
+            const CTransaction& tx = (*it)->GetTx();
+            if (!view.HaveInputs(tx)) {
+                ++it;
+                continue;
+            }
+            CFeeRate feeRate((*it)->GetModifiedFee(), (*it)->GetTxSize());
+            if (txSelection.Fits(tx, (*it)->GetTxSize(), feeRate, true) && txSelection.Add(tx, (*it)->GetTxSize(), nHeight)) {
+                fProgress = true;
+            }
+            it = listCandidates.erase(it);
+        }
+    }
+}
+
+/**
+ * Check the parts of a template that are new on every call, for a selection
+ * whose transactions already passed TestBlockValidity or were checked by
+ * CBlockTxSelection::Add when they were appended: the header, the coinbase
+ * and coinstake with their payees, and what the block mints.
+ */
+static bool TestBlockTemplateRewards(CValidationState& state, const CBlock& block, CBlockIndex* pindexPrev, CAmount nFees)
+{
+    // the block checks applied to the header and the reward transactions alone,
+    // the merkle root is filled in by the miner
+    CBlock blockRewards(block.GetBlockHeader());
+    const unsigned int nRewardTxs = block.IsProofOfStake() ? 2 : 1;
+    blockRewards.vtx.assign(block.vtx.begin(), block.vtx.begin() + nRewardTxs);
+    if (!ContextualCheckBlockHeader(blockRewards, state, pindexPrev))
+        return false;
+    if (!CheckBlock(blockRewards, state, false, false))
+        return false;
+    if (!ContextualCheckBlock(blockRewards, state, pindexPrev))
+        return false;
+
+    // the stake must not be spent by a transaction of the selection
+    CAmount nMint = 0;
+    const CCoinsViewCache& view = *txSelection.pview;
+    BOOST_FOREACH (const CTransaction& tx, blockRewards.vtx) {
+        nMint += tx.GetValueOut();
+        if (tx.IsCoinBase())
+            continue;
+        if (!view.HaveInputs(tx))
+            return state.Invalid(error("%s : coinstake inputs missing or spent", __func__));
+        if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
+            return false;
+        nMint -= view.GetValueIn(tx);
+    }
+
+    //PoW phase redistributed fees to miner. PoS stage destroys fees.
+    CAmount nExpectedMint = GetBlockValue(pindexPrev->nHeight);
+    if (block.IsProofOfWork())
+        nExpectedMint += nFees;
+    if (!IsBlockValueValid(block, nExpectedMint, nMint))
+        return state.DoS(100, error("%s : reward pays too much (actual=%s vs limit=%s)", __func__, FormatMoney(nMint), FormatMoney(nExpectedMint)));
+
+    return true;
+}
+
+// Bring the selection up to date with the tip and the mempool
+static void UpdateBlockTxSelection(const CBlockIndex* pindexPrev, unsigned int nBlockMaxSize, unsigned int nBlockPrioritySize, unsigned int nBlockMinSize)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+    const int nHeight = pindexPrev->nHeight + 1;
+    unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+
+    bool fRebuild = !txSelection.pview ||
+                    txSelection.pcoinsBase != pcoinsTip ||
+                    txSelection.hashPrevBlock != pindexPrev->GetBlockHash() ||
+                    txSelection.nBlockMaxSize != nBlockMaxSize ||
+                    txSelection.nBlockPrioritySize != nBlockPrioritySize ||
+                    txSelection.nBlockMinSize != nBlockMinSize;
+    if (!fRebuild && txSelection.nTransactionsUpdated == nTransactionsUpdated)
+        return;
+
+    if (!fRebuild) {
+        BOOST_FOREACH (const CTransaction& tx, txSelection.vtx) {
+            if (!mempool.exists(tx.GetHash())) {
+                fRebuild = true;
+                break;
+            }
+        }
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+    if (fRebuild) {
+        txSelection.SetNull();
+        txSelection.hashPrevBlock = pindexPrev->GetBlockHash();
+        txSelection.nBlockMaxSize = nBlockMaxSize;
+        txSelection.nBlockPrioritySize = nBlockPrioritySize;
+        txSelection.nBlockMinSize = nBlockMinSize;
+        txSelection.pview.reset(new CCoinsViewCache(pcoinsTip));
+        txSelection.pcoinsBase = pcoinsTip;
+        BuildBlockTxSelection(nHeight);
+    } else {
+        ExtendBlockTxSelection(nHeight);
+    }
+    txSelection.nTransactionsUpdated = nTransactionsUpdated;
+
+    LogPrint("bench", "    - %s block transaction selection: %.2fms (%u txs)\n", fRebuild ? "Build" : "Extend",
+        0.001 * (GetTimeMicros() - nTimeStart), txSelection.vtx.size());
+}
+
 std::pair<int, uint256> nCheckpointLast;
 CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool fProofOfStake)
 {
@@ -177,214 +580,14 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
 
         CBlockIndex* pindexPrev = chainActive.Tip();
         const int nHeight = pindexPrev->nHeight + 1;
-        CCoinsViewCache view(pcoinsTip);
-
-        // Priority order to process transactions
-        list<COrphan> vOrphan; // list memory doesn't move
-        map<uint256, vector<COrphan*> > mapDependers;
-        bool fPrintPriority = GetBoolArg("-printpriority", false);
-
-        // This vector will be sorted into a priority queue:
-        vector<TxPriority> vecPriority;
-        vecPriority.reserve(mempool.mapTx.size());
-        for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.mapTx.begin();
-             mi != mempool.mapTx.end(); ++mi) {
-            const CTransaction& tx = mi->second.GetTx();
-            if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, nHeight)){
-                continue;
-            }
-
-            if (GetAdjustedTime() > GetSporkValue(SPORK_16_ZEROCOIN_MAINTENANCE_MODE) && tx.ContainsZerocoins())
-                continue;
-
-            COrphan* porphan = NULL;
-            double dPriority = 0;
-            CAmount nTotalIn = 0;
-            bool fMissingInputs = false;
-            for (const CTxIn& txin : tx.vin) {
-                //zerocoinspend has special vin
-                if (tx.IsZerocoinSpend()) {
-                    nTotalIn = tx.GetZerocoinSpent();
-                    break;
-                }
-
-                // Read prev transaction
-                if (!view.HaveCoins(txin.prevout.hash)) {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    if (!mempool.mapTx.count(txin.prevout.hash)) {
-                        LogPrintf("ERROR: mempool transaction missing input\n");
-                        if (fDebug) assert("mempool transaction missing input" == 0);
-                        fMissingInputs = true;
-                        if (porphan)
-                            vOrphan.pop_back();
-                        break;
-                    }
-
-                    // Has to wait for dependencies
-                    if (!porphan) {
-                        // Use list for automatic deletion
-                        vOrphan.push_back(COrphan(&tx));
-                        porphan = &vOrphan.back();
-                    }
-                    mapDependers[txin.prevout.hash].push_back(porphan);
-                    porphan->setDependsOn.insert(txin.prevout.hash);
-                    nTotalIn += mempool.mapTx[txin.prevout.hash].GetTx().vout[txin.prevout.n].nValue;
-                    continue;
-                }
-
-                const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-                assert(coins);
-
-                CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
-                nTotalIn += nValueIn;
-
-                int nConf = nHeight - coins->nHeight;
-
-                dPriority += (double)nValueIn * nConf;
-            }
-            if (fMissingInputs) continue;
-
-            // Priority is sum(valuein * age) / modified_txsize
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            dPriority = tx.ComputePriority(dPriority, nTxSize);
 
-            uint256 hash = tx.GetHash();
-            mempool.ApplyDeltas(hash, dPriority, nTotalIn);
-
-            CFeeRate feeRate(nTotalIn - tx.GetValueOut(), nTxSize);
-
-            if (porphan) {
-                porphan->dPriority = dPriority;
-                porphan->feeRate = feeRate;
-            } else
-                vecPriority.push_back(TxPriority(dPriority, feeRate, &mi->second.GetTx()));
-        }
-
-        // Collect transactions into block
-        uint64_t nBlockSize = 1000;
-        uint64_t nBlockTx = 0;
-        int nBlockSigOps = 100;
-        bool fSortedByFee = (nBlockPrioritySize <= 0);
-
-        TxPriorityCompare comparer(fSortedByFee);
-        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-
-        vector<CBigNum> vBlockSerials;
-        vector<CBigNum> vTxSerials;
-        while (!vecPriority.empty()) {
-            // Take highest priority transaction off the priority queue:
-            double dPriority = vecPriority.front().get<0>();
-            CFeeRate feeRate = vecPriority.front().get<1>();
-            const CTransaction& tx = *(vecPriority.front().get<2>());
-
-            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            vecPriority.pop_back();
-
-            // Size limits
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            if (nBlockSize + nTxSize >= nBlockMaxSize)
-                continue;
-
-            // Legacy limits on sigOps:
-            unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
-            unsigned int nTxSigOps = GetLegacySigOpCount(tx);
-            if (nBlockSigOps + nTxSigOps >= nMaxBlockSigOps)
-                continue;
-
-            // Skip free transactions if we're past the minimum block size:
-            const uint256& hash = tx.GetHash();
-            double dPriorityDelta = 0;
-            CAmount nFeeDelta = 0;
-            mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
-            if (!tx.IsZerocoinSpend() && fSortedByFee && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
-                continue;
-
-            // Prioritise by fee once past the priority size or we run out of high-priority
-            // transactions:
-            if (!fSortedByFee &&
-                ((nBlockSize + nTxSize >= nBlockPrioritySize) || !AllowFree(dPriority))) {
-                fSortedByFee = true;
-                comparer = TxPriorityCompare(fSortedByFee);
-                std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            }
-
-            if (!view.HaveInputs(tx))
-                continue;
-
-            // double check that there are no double spent zpara spends in this block or tx
-            if (tx.IsZerocoinSpend()) {
-                int nHeightTx = 0;
-                if (IsTransactionInChain(tx.GetHash(), nHeightTx))
-                    continue;
-
-                bool fDoubleSerial = false;
-                for (const CTxIn txIn : tx.vin) {
-                    if (txIn.scriptSig.IsZerocoinSpend()) {
-                        libzerocoin::CoinSpend spend = TxInToZerocoinSpend(txIn);
-                        if (!spend.HasValidSerial(Params().Zerocoin_Params()))
-                            fDoubleSerial = true;
-                        if (count(vBlockSerials.begin(), vBlockSerials.end(), spend.getCoinSerialNumber()))
-                            fDoubleSerial = true;
-                        if (count(vTxSerials.begin(), vTxSerials.end(), spend.getCoinSerialNumber()))
-                            fDoubleSerial = true;
-                        if (fDoubleSerial)
-                            break;
-                        vTxSerials.emplace_back(spend.getCoinSerialNumber());
-                    }
-                }
-                //This zpara serial has already been included in the block, do not add this tx.
-                if (fDoubleSerial)
-                    continue;
-            }
-
-            CAmount nTxFees = view.GetValueIn(tx) - tx.GetValueOut();
-
-            nTxSigOps += GetP2SHSigOpCount(tx, view);
-            if (nBlockSigOps + nTxSigOps >= nMaxBlockSigOps)
-                continue;
-
-            // Note that flags: we don't want to set mempool/IsStandard()
-            // policy here, but we still have to ensure that the block we
-            // create only contains transactions that are valid in new blocks.
-            CValidationState state;
-            if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
-                continue;
-
-            CTxUndo txundo;
-            UpdateCoins(tx, state, view, txundo, nHeight);
-
-            // Added
-            pblock->vtx.push_back(tx);
-            pblocktemplate->vTxFees.push_back(nTxFees);
-            pblocktemplate->vTxSigOps.push_back(nTxSigOps);
-            nBlockSize += nTxSize;
-            ++nBlockTx;
-            nBlockSigOps += nTxSigOps;
-            nFees += nTxFees;
-
-            for (const CBigNum bnSerial : vTxSerials)
-                vBlockSerials.emplace_back(bnSerial);
-
-            if (fPrintPriority) {
-                LogPrintf("priority %.1f fee %s txid %s\n",
-                    dPriority, feeRate.ToString(), tx.GetHash().ToString());
-            }
-
-            // Add transactions that depend on this one to the priority queue
-            if (mapDependers.count(hash)) {
-                BOOST_FOREACH (COrphan* porphan, mapDependers[hash]) {
-                    if (!porphan->setDependsOn.empty()) {
-                        porphan->setDependsOn.erase(hash);
-                        if (porphan->setDependsOn.empty()) {
-                            vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                        }
-                    }
-                }
-            }
-        }
+        UpdateBlockTxSelection(pindexPrev, nBlockMaxSize, nBlockPrioritySize, nBlockMinSize);
+        pblock->vtx.insert(pblock->vtx.end(), txSelection.vtx.begin(), txSelection.vtx.end());
+        pblocktemplate->vTxFees.insert(pblocktemplate->vTxFees.end(), txSelection.vTxFees.begin(), txSelection.vTxFees.end());
+        pblocktemplate->vTxSigOps.insert(pblocktemplate->vTxSigOps.end(), txSelection.vTxSigOps.begin(), txSelection.vTxSigOps.end());
+        nFees = txSelection.nFees;
+        uint64_t nBlockSize = txSelection.nBlockSize;
+        uint64_t nBlockTx = txSelection.vtx.size();
 
         if (!fProofOfStake) {
             //Masternode and general budget payments
@@ -424,10 +627,21 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
         nCheckpointLast.second = nCheckpoint;
         pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
 
+        // A selection built from scratch is checked as a whole block once. Later
+        // calls only check what they built anew, the appended transactions were
+        // checked against the selection's view as they went in.
         CValidationState state;
-        if (!TestBlockValidity(state, *pblock, pindexPrev, false, false)) {
-            LogPrintf("CreateNewBlock() : TestBlockValidity failed\n");
-            mempool.clear();
+        if (!txSelection.fValidated) {
+            if (!TestBlockValidity(state, *pblock, pindexPrev, false, false)) {
+                LogPrintf("CreateNewBlock() : TestBlockValidity failed\n");
+                mempool.clear();
+                txSelection.SetNull();
+                return NULL;
+            }
+            txSelection.fValidated = true;
+        } else if (!TestBlockTemplateRewards(state, *pblock, pindexPrev, nFees)) {
+            LogPrintf("CreateNewBlock() : TestBlockTemplateRewards failed\n");
+            txSelection.SetNull();
             return NULL;
         }
     }
@@ -87,6 +87,11 @@ uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
 CAddrMan addrman;
 int nMaxConnections = 125;
+#ifdef USE_EPOLL
+SocketEventsMode socketEventsMode = SOCKETEVENTS_EPOLL;
+#else
+SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+#endif
 bool fAddressesInitialized = false;
 std::string strSubVersion;
 
@@ -417,7 +422,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest, bool obfuScationMa
     bool proxyConnectionFailed = false;
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed)) {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!CSocketEvents::IsTrackable(socketEventsMode, hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -838,10 +843,34 @@ void SocketSendData(CNode* pnode)
 
 static list<CNode*> vNodesDisconnected;
 
+static CCriticalSection cs_socketHandlerStats;
+static CSocketHandlerStats socketHandlerStats;
+
+void GetSocketHandlerStats(CSocketHandlerStats& stats)
+{
+    LOCK(cs_socketHandlerStats);
+    stats = socketHandlerStats;
+}
+
+static int GetReadyEvents(const map<SOCKET, int>& mapReady, SOCKET hSocket)
+{
+    map<SOCKET, int>::const_iterator it = mapReady.find(hSocket);
+    return it == mapReady.end() ? 0 : it->second;
+}
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    CSocketEvents socketEvents(socketEventsMode);
+    {
+        LOCK(cs_socketHandlerStats);
+        socketHandlerStats = CSocketHandlerStats();
+        socketHandlerStats.strMode = GetSocketEventsModeName(socketEvents.GetMode());
+    }
+    LogPrintf("ThreadSocketHandler : waiting for sockets with %s\n", GetSocketEventsModeName(socketEvents.GetMode()));
     while (true) {
+        int64_t nIterationStart = GetTimeMicros();
+
         //
         // Disconnect nodes
         //
@@ -906,33 +935,16 @@ void ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        const int64_t nTimeoutMillis = 50; // frequency to poll pnode->vSend
 
-        BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+        BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket)
+            socketEvents.Set(hListenSocket.socket, -1, SOCKET_EVENT_RECV);
 
         {
             LOCK(cs_vNodes);
             BOOST_FOREACH (CNode* pnode, vNodes) {
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
-                have_fds = true;
 
                 // Implement the following logic:
                 // * If there is data to send, select() for sending data. As this only
@@ -949,43 +961,44 @@ void ThreadSocketHandler()
                 // * We send some data.
                 // * We wait for data to be received (and disconnect after timeout).
                 // * We process a message in the buffer (message handler thread).
+                // Only changes to the wanted events reach the kernel in epoll mode.
+                int nEvents = 0;
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
-                    }
+                    if (lockSend && !pnode->vSendMsg.empty())
+                        nEvents = SOCKET_EVENT_SEND;
                 }
-                {
+                if (nEvents == 0) {
                     TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                     if (lockRecv && (pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
                                         pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
+                        nEvents = SOCKET_EVENT_RECV;
+                }
+                if (!socketEvents.Set(pnode->hSocket, pnode->id, nEvents)) {
+                    LogPrintf("socket of peer=%d cannot be waited on with %s, disconnecting\n", pnode->id, GetSocketEventsModeName(socketEvents.GetMode()));
+                    pnode->fDisconnect = true;
                 }
             }
         }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-            &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        socketEvents.RemoveStale();
+
+        int64_t nWaitStart = GetTimeMicros();
+        vector<pair<SOCKET, int> > vReady;
+        if (!socketEvents.Wait(nTimeoutMillis, vReady)) {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket %s error %s\n", GetSocketEventsModeName(socketEvents.GetMode()), NetworkErrorString(nErr));
+            MilliSleep(nTimeoutMillis);
+        }
+        int64_t nWaitTime = GetTimeMicros() - nWaitStart;
         boost::this_thread::interruption_point();
 
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec / 1000);
-        }
+        map<SOCKET, int> mapReady(vReady.begin(), vReady.end());
 
         //
         // Accept new connections
         //
         BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv)) {
+            if (hListenSocket.socket != INVALID_SOCKET && (GetReadyEvents(mapReady, hListenSocket.socket) & SOCKET_EVENT_RECV)) {
                 struct sockaddr_storage sockaddr;
                 socklen_t len = sizeof(sockaddr);
                 SOCKET hSocket = accept(hListenSocket.socket, (struct sockaddr*)&sockaddr, &len);
@@ -1008,7 +1021,7 @@ void ThreadSocketHandler()
                     int nErr = WSAGetLastError();
                     if (nErr != WSAEWOULDBLOCK)
                         LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
-                } else if (!IsSelectableSocket(hSocket)) {
+                } else if (!CSocketEvents::IsTrackable(socketEventsMode, hSocket)) {
                     LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
                     CloseSocket(hSocket);
                 } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
@@ -1048,7 +1061,8 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError)) {
+            int nReadyEvents = GetReadyEvents(mapReady, pnode->hSocket);
+            if (nReadyEvents & (SOCKET_EVENT_RECV | SOCKET_EVENT_ERR)) {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv) {
                     {
@@ -1084,7 +1098,7 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend)) {
+            if (nReadyEvents & SOCKET_EVENT_SEND) {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend)
                     SocketSendData(pnode);
@@ -1115,6 +1129,17 @@ void ThreadSocketHandler()
             BOOST_FOREACH (CNode* pnode, vNodesCopy)
                 pnode->Release();
         }
+
+        int64_t nWorkTime = GetTimeMicros() - nIterationStart - nWaitTime;
+        {
+            LOCK(cs_socketHandlerStats);
+            socketHandlerStats.nIterations++;
+            socketHandlerStats.nWaitMicros += nWaitTime;
+            socketHandlerStats.nWorkMicros += nWorkTime;
+            socketHandlerStats.nMaxWorkMicros = max(socketHandlerStats.nMaxWorkMicros, nWorkTime);
+            socketHandlerStats.nReadySockets += vReady.size();
+            socketHandlerStats.nTrackedSockets = socketEvents.size();
+        }
     }
 }
 
@@ -1595,7 +1620,7 @@ bool BindListenPort(const CService& addrBind, std::string& strError, bool fWhite
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket)) {
+    if (!CSocketEvents::IsTrackable(socketEventsMode, hListenSocket)) {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
         return false;
@@ -15,6 +15,7 @@
 #include "netbase.h"
 #include "protocol.h"
 #include "random.h"
+#include "socketevents.h"
 #include "streams.h"
 #include "sync.h"
 #include "uint256.h"
@@ -130,6 +131,7 @@ extern uint64_t nLocalServices;
 extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
 extern int nMaxConnections;
+extern SocketEventsMode socketEventsMode;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
@@ -147,6 +149,21 @@ extern CCriticalSection cs_nLastNodeId;
 /** Subversion as sent to the P2P network in `version` messages */
 extern std::string strSubVersion;
 
+/** Time spent by ThreadSocketHandler waiting for sockets and servicing them */
+struct CSocketHandlerStats {
+    std::string strMode;
+    uint64_t nIterations;
+    int64_t nWaitMicros;
+    int64_t nWorkMicros;
+    int64_t nMaxWorkMicros;
+    uint64_t nReadySockets;
+    uint64_t nTrackedSockets;
+
+    CSocketHandlerStats() : nIterations(0), nWaitMicros(0), nWorkMicros(0), nMaxWorkMicros(0), nReadySockets(0), nTrackedSockets(0) {}
+};
+
+void GetSocketHandlerStats(CSocketHandlerStats& stats);
+
 struct LocalServiceInfo {
     int nScore;
     int nPort;
@@ -192,6 +209,8 @@ public:
 
     int64_t nTime; // time (in microseconds) of message receipt.
 
+    bool fSigsQueued; // looked at by QueueMasternodeSignatures
+
     CNetMessage(int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), vRecv(nTypeIn, nVersionIn)
     {
         hdrbuf.resize(24);
@@ -199,6 +218,7 @@ public:
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
+        fSigsQueued = false;
     }
 
     bool complete() const
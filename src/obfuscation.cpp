@@ -8,6 +8,7 @@
 #include "init.h"
 #include "main.h"
 #include "masternodeman.h"
+#include "masternode-sigqueue.h"
 #include "masternode-tiers.h"
 #include "script/sign.h"
 #include "swifttx.h"
@@ -2166,13 +2167,17 @@ bool CObfuScationSigner::GetKeysFromSecret(std::string strSecret, CKey& keyRet,
     return true;
 }
 
-bool CObfuScationSigner::SignMessage(std::string strMessage, std::string& errorMessage, vector<unsigned char>& vchSig, CKey key)
+uint256 CObfuScationSigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
+    return ss.GetHash();
+}
 
-    if (!key.SignCompact(ss.GetHash(), vchSig)) {
+bool CObfuScationSigner::SignMessage(std::string strMessage, std::string& errorMessage, vector<unsigned char>& vchSig, CKey key)
+{
+    if (!key.SignCompact(GetMessageHash(strMessage), vchSig)) {
         errorMessage = _("Signing failed.");
         return false;
     }
@@ -2182,12 +2187,9 @@ bool CObfuScationSigner::SignMessage(std::string strMessage, std::string& errorM
 
 bool CObfuScationSigner::VerifyMessage(CPubKey pubkey, vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage)
 {
-    CHashWriter ss(SER_GETHASH, 0);
-    ss << strMessageMagic;
-    ss << strMessage;
-
+    // the key may have been recovered on a worker already
     CPubKey pubkey2;
-    if (!pubkey2.RecoverCompact(ss.GetHash(), vchSig)) {
+    if (!masternodeSigQueue.Recover(GetMessageHash(strMessage), vchSig, pubkey2)) {
         errorMessage = _("Error recovering public key.");
         return false;
     }
@@ -36,11 +36,24 @@ public:
     uint32_t nNonce;
     uint256 nAccumulatorCheckpoint;
 
+    // memory only: the header bytes last hashed by GetHash() and their hash,
+    // guarded by a lock so that threads can hash a shared header
+    mutable bool fHashCached;
+    mutable uint256 hashCached;
+    mutable unsigned char vchHashedHeader[112];
+
     CBlockHeader()
     {
         SetNull();
     }
 
+    CBlockHeader(const CBlockHeader& other)
+    {
+        *this = other;
+    }
+
+    CBlockHeader& operator=(const CBlockHeader& other);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -67,6 +80,7 @@ public:
         nBits = 0;
         nNonce = 0;
         nAccumulatorCheckpoint = 0;
+        fHashCached = false;
     }
 
     bool IsNull() const
@@ -74,12 +88,27 @@ public:
         return (nBits == 0);
     }
 
+    /**
+     * The block hash, XEVAN before version 4. It is remembered until a
+     * hashed field changes, so repeated calls on the same header are free.
+     * Threads may call it on a shared header as long as none changes the fields.
+     */
     uint256 GetHash() const;
 
+    /** Remember a hash known to belong to the current fields, e.g. from the block index */
+    void SetCachedHash(const uint256& hash) const;
+
+    /** Number of header hashes actually computed since startup */
+    static uint64_t GetHashCount();
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
     }
+
+private:
+    void CopyCachedHash(const CBlockHeader& other);
+    size_t GetHashedSize() const;
 };
 
 
@@ -128,15 +157,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        block.nAccumulatorCheckpoint = nAccumulatorCheckpoint;
-        return block;
+        // the header fields, and the hash remembered for them
+        return CBlockHeader(*this);
     }
 
     // ppcoin: two types of block: proof-of-work or proof-of-stake
@@ -238,7 +238,11 @@ void Bip38ToolDialog::on_importAddressButton_DEC_clicked()
 
         // whenever a key is imported, we need to scan the whole chain
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+        if (pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true) < 0) {
+            ui->statusLabel_DEC->setStyleSheet("QLabel { color: red; }");
+            ui->statusLabel_DEC->setText(tr("Error Writing Rescanned Transactions To Wallet"));
+            return;
+        }
     }
 
     ui->statusLabel_DEC->setStyleSheet("QLabel { color: green; }");
@@ -233,7 +233,11 @@ void MultisigDialog::on_importAddressButton_clicked(){
     addMultisig(stoi(vRedeem[0]), keys);
 
     // rescan to find txs associated with imported address
-    pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+    if (pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true) < 0) {
+        ui->addMultisigStatus->setStyleSheet("QLabel { color: red; }");
+        ui->addMultisigStatus->setText("Error writing the rescanned transactions to the wallet!");
+        return;
+    }
     pwalletMain->ReacceptWalletTransactions();
 }
 
@@ -507,18 +507,18 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     }
 
     // Update block
+    // CreateNewBlock only extends its transaction selection while the tip
+    // stays the same, so a template can follow every change of the mempool
     static CBlockIndex* pindexPrev;
-    static int64_t nStart;
     static CBlockTemplate* pblocktemplate;
     if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5)) {
+        mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast) {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = NULL;
 
         // Store the chainActive.Tip() used before CreateNewBlock, to avoid races
         nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
         CBlockIndex* pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
 
         // Create new block
         if (pblocktemplate) {
@@ -529,7 +529,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 		/* TODO-- too poor as per performance, but only way */
 		
 		CPubKey pubkey;
-		if (!pMiningKey->GetReservedKey(pubkey))
+		if (!pMiningKey || !pMiningKey->GetReservedKey(pubkey))
 			return NullUniValue;
 		
         CScript scriptDummy = CScript() << ToByteVector(pubkey) << OP_CHECKSIG;
@@ -8,6 +8,7 @@
 
 #include "base58.h"
 #include "clientversion.h"
+#include "httpserver.h"
 #include "init.h"
 #include "main.h"
 #include "masternode-sync.h"
@@ -527,6 +528,102 @@ UniValue setmocktime(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+UniValue getrpcstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getrpcstats ( \"method\" )\n"
+            "\nReturns the state of the RPC work queues and the latency of the calls to each method since startup.\n"
+            "\nArguments:\n"
+            "1. \"method\"    (string, optional) Only show the calls to this method\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queues\": [                (array) the HTTP work queues, empty if the HTTP server is not running\n"
+            "    {\n"
+            "      \"name\": \"name\",        (string) read, wallet or chainstate\n"
+            "      \"threads\": n,          (numeric) worker threads of the queue\n"
+            "      \"depth\": n,            (numeric) requests waiting\n"
+            "      \"maxdepth\": n,         (numeric) requests that may wait before new ones are rejected\n"
+            "      \"peakdepth\": n,        (numeric) most requests that waited at once\n"
+            "      \"processed\": n,        (numeric) requests taken from the queue\n"
+            "      \"stolen\": n,           (numeric) of those, by the workers of other queues\n"
+            "      \"rejected\": n          (numeric) requests rejected as the queue was full\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"methods\": {\n"
+            "    \"method\": {\n"
+            "      \"class\": \"class\",      (string) the queue the method runs on\n"
+            "      \"calls\": n,            (numeric) number of calls\n"
+            "      \"errors\": n,           (numeric) calls that returned an error\n"
+            "      \"total_us\": n,         (numeric) time spent in the calls, in microseconds\n"
+            "      \"avg_us\": n,           (numeric) average time of a call\n"
+            "      \"max_us\": n,           (numeric) longest call\n"
+            "      \"histogram\": [         (array) calls by time taken, for the non-empty buckets\n"
+            "        { \"lt_us\": n, \"count\": n }  (numeric) calls that took less than lt_us, and at least half of it\n"
+            "        ,...\n"
+            "        { \"ge_us\": n, \"count\": n }  (numeric) calls that took at least ge_us\n"
+            "      ]\n"
+            "    }\n"
+            "    ,...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpcstats", "") + HelpExampleCli("getrpcstats", "\"getblock\"") + HelpExampleRpc("getrpcstats", "\"getblock\""));
+
+    string strMethod;
+    if (params.size() > 0)
+        strMethod = params[0].get_str();
+
+    UniValue queues(UniValue::VARR);
+    BOOST_FOREACH (const HTTPWorkQueueStats& stats, GetHTTPWorkQueueStats()) {
+        UniValue queue(UniValue::VOBJ);
+        queue.push_back(Pair("name", stats.name));
+        queue.push_back(Pair("threads", stats.nThreads));
+        queue.push_back(Pair("depth", (uint64_t)stats.nDepth));
+        queue.push_back(Pair("maxdepth", (uint64_t)stats.nMaxDepth));
+        queue.push_back(Pair("peakdepth", (uint64_t)stats.nPeakDepth));
+        queue.push_back(Pair("processed", stats.nProcessed));
+        queue.push_back(Pair("stolen", stats.nStolen));
+        queue.push_back(Pair("rejected", stats.nRejected));
+        queues.push_back(queue);
+    }
+
+    UniValue methods(UniValue::VOBJ);
+    std::map<std::string, CRPCMethodStats> mapStats = GetRPCMethodStats();
+    for (std::map<std::string, CRPCMethodStats>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it) {
+        if (!strMethod.empty() && it->first != strMethod)
+            continue;
+        const CRPCMethodStats& stats = it->second;
+        UniValue method(UniValue::VOBJ);
+        method.push_back(Pair("class", RPCExecClassName(tableRPC.GetExecClass(it->first))));
+        method.push_back(Pair("calls", stats.nCalls));
+        method.push_back(Pair("errors", stats.nErrors));
+        method.push_back(Pair("total_us", stats.nTimeTotal));
+        method.push_back(Pair("avg_us", stats.nCalls ? stats.nTimeTotal / (int64_t)stats.nCalls : 0));
+        method.push_back(Pair("max_us", stats.nTimeMax));
+        UniValue histogram(UniValue::VARR);
+        for (int i = 0; i < CRPCMethodStats::HISTOGRAM_BUCKETS; i++) {
+            if (!stats.vHistogram[i])
+                continue;
+            UniValue bucket(UniValue::VOBJ);
+            if (i < CRPCMethodStats::HISTOGRAM_BUCKETS - 1)
+                bucket.push_back(Pair("lt_us", (int64_t)1 << i));
+            else
+                bucket.push_back(Pair("ge_us", (int64_t)1 << (i - 1)));
+            bucket.push_back(Pair("count", stats.vHistogram[i]));
+            histogram.push_back(bucket);
+        }
+        method.push_back(Pair("histogram", histogram));
+        methods.push_back(Pair(it->first, method));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("queues", queues));
+    ret.push_back(Pair("methods", methods));
+    return ret;
+}
+
 #ifdef ENABLE_WALLET
 UniValue getstakingstatus(const UniValue& params, bool fHelp)
 {
@@ -316,7 +316,16 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
-            "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"timemillis\": t,       (numeric) Total cpu time\n"
+            "  \"sockethandler\": {     (json object) The network thread's event loop\n"
+            "    \"mode\": \"xxxx\",        (string) How sockets are waited on (select or epoll)\n"
+            "    \"sockets\": n,           (numeric) Sockets currently tracked\n"
+            "    \"iterations\": n,        (numeric) Loop iterations since startup\n"
+            "    \"avgwait_us\": n,        (numeric) Average time waiting for sockets per iteration, in microseconds\n"
+            "    \"avgwork_us\": n,        (numeric) Average time servicing sockets per iteration, in microseconds\n"
+            "    \"maxwork_us\": n,        (numeric) Longest time servicing sockets in one iteration, in microseconds\n"
+            "    \"avgready\": x.xxx       (numeric) Average number of ready sockets per iteration\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getnettotals", "") + HelpExampleRpc("getnettotals", ""));
@@ -325,6 +334,19 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     obj.push_back(Pair("totalbytesrecv", CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent", CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis", GetTimeMillis()));
+
+    CSocketHandlerStats stats;
+    GetSocketHandlerStats(stats);
+    uint64_t nIterations = std::max(stats.nIterations, (uint64_t)1);
+    UniValue handler(UniValue::VOBJ);
+    handler.push_back(Pair("mode", stats.strMode));
+    handler.push_back(Pair("sockets", stats.nTrackedSockets));
+    handler.push_back(Pair("iterations", stats.nIterations));
+    handler.push_back(Pair("avgwait_us", stats.nWaitMicros / (int64_t)nIterations));
+    handler.push_back(Pair("avgwork_us", stats.nWorkMicros / (int64_t)nIterations));
+    handler.push_back(Pair("maxwork_us", stats.nMaxWorkMicros));
+    handler.push_back(Pair("avgready", (double)stats.nReadySockets / nIterations));
+    obj.push_back(Pair("sockethandler", handler));
     return obj;
 }
 
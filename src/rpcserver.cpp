@@ -16,6 +16,7 @@
 #include "guiinterface.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "utiltime.h"
 
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
@@ -43,6 +44,16 @@ static RPCTimerInterface* timerInterface = NULL;
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
 
+/* Latency of the calls to each method */
+static CCriticalSection cs_rpcStats;
+static std::map<std::string, CRPCMethodStats> mapRPCStats;
+
+/* Methods that take neither cs_main nor cs_wallet and return quickly. addnode
+ * (onetry connects) and getaddednodeinfo (dns resolves) block on the network */
+static const char* const vRPCReadMethods[] = {
+    "help", "stop", "getrpcstats", "getnettotals",
+    "getmempoolinfo", "estimatefee", "estimatepriority", "mnsync", "spork"};
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -286,6 +297,7 @@ static const CRPCCommand vRPCCommands[] =
         {"control", "getinfo", &getinfo, true, false, false}, /* uses wallet if enabled */
         {"control", "help", &help, true, true, false},
         {"control", "stop", &stop, true, true, false},
+        {"control", "getrpcstats", &getrpcstats, true, true, false},
 
         /* P2P networking */
         {"network", "getnetworkinfo", &getnetworkinfo, true, false, false},
@@ -306,6 +318,7 @@ static const CRPCCommand vRPCCommands[] =
         {"blockchain", "getchaintips", &getchaintips, true, false, false},
         {"blockchain", "getdifficulty", &getdifficulty, true, false, false},
         {"blockchain", "getmempoolinfo", &getmempoolinfo, true, true, false},
+        {"blockchain", "getsigcacheinfo", &getsigcacheinfo, true, false, false},
         {"blockchain", "getrawmempool", &getrawmempool, true, false, false},
         {"blockchain", "gettxout", &gettxout, true, false, false},
         {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true, false, false},
@@ -568,6 +581,63 @@ std::string JSONRPCExecBatch(const UniValue& vReq)
     return ret.write() + "\n";
 }
 
+CRPCMethodStats::CRPCMethodStats() : nCalls(0), nErrors(0), nTimeTotal(0), nTimeMax(0)
+{
+    std::fill(vHistogram, vHistogram + HISTOGRAM_BUCKETS, 0);
+}
+
+void CRPCMethodStats::Add(int64_t nTime, bool fError)
+{
+    nTime = std::max(nTime, (int64_t)0);
+    nCalls++;
+    if (fError)
+        nErrors++;
+    nTimeTotal += nTime;
+    nTimeMax = std::max(nTimeMax, nTime);
+    int nBucket = 0;
+    while (nBucket < HISTOGRAM_BUCKETS - 1 && nTime >= ((int64_t)1 << nBucket))
+        nBucket++;
+    vHistogram[nBucket]++;
+}
+
+static void RecordRPCCall(const std::string& strMethod, int64_t nTime, bool fError)
+{
+    LOCK(cs_rpcStats);
+    mapRPCStats[strMethod].Add(nTime, fError);
+}
+
+std::map<std::string, CRPCMethodStats> GetRPCMethodStats()
+{
+    LOCK(cs_rpcStats);
+    return mapRPCStats;
+}
+
+std::string RPCExecClassName(RPCExecClass execClass)
+{
+    switch (execClass) {
+    case RPC_EXEC_READ:
+        return "read";
+    case RPC_EXEC_WALLET:
+        return "wallet";
+    default:
+        return "chainstate";
+    }
+}
+
+RPCExecClass CRPCTable::GetExecClass(const std::string& name) const
+{
+    const CRPCCommand* pcmd = (*this)[name];
+    if (!pcmd)
+        return RPC_EXEC_CHAINSTATE;
+    if (pcmd->reqWallet)
+        return RPC_EXEC_WALLET;
+    for (unsigned int i = 0; i < sizeof(vRPCReadMethods) / sizeof(vRPCReadMethods[0]); i++) {
+        if (name == vRPCReadMethods[i])
+            return RPC_EXEC_READ;
+    }
+    return RPC_EXEC_CHAINSTATE;
+}
+
 UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
 {
     // Find method
@@ -577,11 +647,18 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    int64_t nTimeStart = GetTimeMicros();
     try {
         // Execute
-        return pcmd->actor(params, false);
+        UniValue result = pcmd->actor(params, false);
+        RecordRPCCall(strMethod, GetTimeMicros() - nTimeStart, false);
+        return result;
     } catch (std::exception& e) {
+        RecordRPCCall(strMethod, GetTimeMicros() - nTimeStart, true);
         throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    } catch (...) {
+        RecordRPCCall(strMethod, GetTimeMicros() - nTimeStart, true);
+        throw;
     }
 
     g_rpcSignals.PostCommand(*pcmd);
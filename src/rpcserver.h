@@ -58,6 +58,10 @@ void SetRPCWarmupFinished();
 /* returns the current warmup state.  */
 bool RPCIsInWarmup(std::string* statusOut);
 
+/* Reserve and release the wallet key getblocktemplate pays to (rpcmining.cpp) */
+void InitRPCMining();
+void ShutdownRPCMining();
+
 /**
  * Type-check arguments; throws JSONRPCError if wrong type given. Does not check that
  * the right number of arguments are passed, just that any passed are the correct type.
@@ -127,6 +131,34 @@ public:
     bool reqWallet;
 };
 
+/**
+ * What a method waits for while it runs. The HTTP server runs each class
+ * on a pool of threads of its own, so slow calls of one class do not hold
+ * up the calls of the others. Ordered from the lightest to the heaviest.
+ */
+enum RPCExecClass {
+    RPC_EXEC_READ,      //!< quick, takes neither cs_main nor cs_wallet
+    RPC_EXEC_WALLET,    //!< locks the wallet
+    RPC_EXEC_CHAINSTATE //!< locks cs_main, or is not known to be quick
+};
+
+/** Latency of the calls to one RPC method */
+class CRPCMethodStats
+{
+public:
+    //! bucket i counts the calls that took less than 2^i us, the last one all that took longer
+    static const int HISTOGRAM_BUCKETS = 25;
+
+    uint64_t nCalls;
+    uint64_t nErrors;
+    int64_t nTimeTotal; // us
+    int64_t nTimeMax;   // us
+    uint64_t vHistogram[HISTOGRAM_BUCKETS];
+
+    CRPCMethodStats();
+    void Add(int64_t nTime, bool fError);
+};
+
 /**
  * papara RPC command dispatcher.
  */
@@ -154,6 +186,9 @@ public:
     * @returns List of registered commands.
     */
     std::vector<std::string> listCommands() const;
+
+    /** Class of a method, RPC_EXEC_CHAINSTATE for unknown ones */
+    RPCExecClass GetExecClass(const std::string& name) const;
 };
 
 extern const CRPCTable tableRPC;
@@ -272,6 +307,7 @@ extern UniValue getbestblockhash(const UniValue& params, bool fHelp);
 extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue settxfee(const UniValue& params, bool fHelp);
 extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
+extern UniValue getsigcacheinfo(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
 extern UniValue getblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
@@ -319,10 +355,14 @@ extern UniValue createmultisig(const UniValue& params, bool fHelp);
 extern UniValue verifymessage(const UniValue& params, bool fHelp);
 extern UniValue setmocktime(const UniValue& params, bool fHelp);
 extern UniValue getstakingstatus(const UniValue& params, bool fHelp);
+extern UniValue getrpcstats(const UniValue& params, bool fHelp);
 
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
 std::string JSONRPCExecBatch(const UniValue& vReq);
+/** Latency statistics of the methods called since startup */
+std::map<std::string, CRPCMethodStats> GetRPCMethodStats();
+std::string RPCExecClassName(RPCExecClass execClass);
 
 #endif // BITCOIN_RPCSERVER_H
@@ -8,10 +8,26 @@
 
 #include "script/interpreter.h"
 
+#include <stdint.h>
 #include <vector>
 
+// DoS prevention: limit cache size to 1048576 entries of 32 bytes (32MB). The
+// erase flags add slightly more (~32.25 MB)
+static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 1048576;
+// Maximum sig cache size allowed, in entries (16GB)
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 536870912;
+
 class CPubKey;
 
+/** Signature cache lookups since startup and the size of the cache */
+struct CSignatureCacheStats
+{
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint32_t nEntries;
+    size_t nBytes;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -23,4 +39,7 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+void InitSignatureCache();
+void GetSignatureCacheStats(CSignatureCacheStats& stats);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -0,0 +1,252 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <boost/foreach.hpp>
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& mode)
+{
+    if (strMode == "select") {
+        mode = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifdef USE_EPOLL
+    if (strMode == "epoll") {
+        mode = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SOCKETEVENTS_SELECT:
+        return "select";
+    case SOCKETEVENTS_EPOLL:
+        return "epoll";
+    }
+    return "unknown";
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+#ifdef USE_EPOLL
+    return "select, epoll";
+#else
+    return "select";
+#endif
+}
+
+CSocketEvents::CSocketEvents(SocketEventsMode modeIn) : mode(modeIn), fdEpoll(-1)
+{
+#ifdef USE_EPOLL
+    if (mode == SOCKETEVENTS_EPOLL) {
+        fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (fdEpoll == -1) {
+            LogPrintf("CSocketEvents : epoll_create1 failed (%s), falling back to select\n", strerror(errno));
+            mode = SOCKETEVENTS_SELECT;
+        }
+    }
+#else
+    mode = SOCKETEVENTS_SELECT;
+#endif
+}
+
+CSocketEvents::~CSocketEvents()
+{
+#ifdef USE_EPOLL
+    if (fdEpoll != -1)
+        close(fdEpoll);
+#endif
+}
+
+bool CSocketEvents::IsTrackable(SocketEventsMode mode, SOCKET hSocket)
+{
+    if (hSocket == INVALID_SOCKET)
+        return false;
+    if (mode == SOCKETEVENTS_EPOLL)
+        return true;
+    return IsSelectableSocket(hSocket);
+}
+
+// Bring the kernel's interest in a socket from nEventsOld to nEventsNew.
+// Sockets without wanted events are not registered at all: epoll would keep
+// reporting a hung up socket that nobody is going to read.
+bool CSocketEvents::Register(SOCKET hSocket, int nEventsOld, int nEventsNew)
+{
+#ifdef USE_EPOLL
+    if (mode != SOCKETEVENTS_EPOLL || nEventsOld == nEventsNew)
+        return true;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.data.fd = hSocket;
+    if (nEventsNew & SOCKET_EVENT_RECV)
+        event.events |= EPOLLIN;
+    if (nEventsNew & SOCKET_EVENT_SEND)
+        event.events |= EPOLLOUT;
+
+    if (nEventsNew == 0) {
+        // a closed socket has already left the epoll set on its own
+        if (epoll_ctl(fdEpoll, EPOLL_CTL_DEL, hSocket, &event) == -1 && errno != EBADF && errno != ENOENT)
+            LogPrint("net", "CSocketEvents : epoll_ctl DEL failed: %s\n", strerror(errno));
+        return true;
+    }
+
+    int op = nEventsOld == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(fdEpoll, op, hSocket, &event) == 0)
+        return true;
+    // the kernel's view differs from ours, e.g. after a descriptor was reused
+    if (op == EPOLL_CTL_ADD && errno == EEXIST && epoll_ctl(fdEpoll, EPOLL_CTL_MOD, hSocket, &event) == 0)
+        return true;
+    if (op == EPOLL_CTL_MOD && errno == ENOENT && epoll_ctl(fdEpoll, EPOLL_CTL_ADD, hSocket, &event) == 0)
+        return true;
+    LogPrintf("CSocketEvents : epoll_ctl failed: %s\n", strerror(errno));
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool CSocketEvents::Set(SOCKET hSocket, int64_t nOwner, int nEvents)
+{
+    if (!IsTrackable(mode, hSocket))
+        return false;
+    nEvents &= SOCKET_EVENT_RECV | SOCKET_EVENT_SEND;
+
+    std::map<SOCKET, SocketEntry>::iterator it = mapSockets.find(hSocket);
+    if (it != mapSockets.end() && it->second.nOwner != nOwner) {
+        // the descriptor was closed and reused since it was registered
+        Register(hSocket, it->second.nEvents, 0);
+        mapSockets.erase(it);
+        it = mapSockets.end();
+    }
+
+    if (it == mapSockets.end()) {
+        if (!Register(hSocket, 0, nEvents))
+            return false;
+        SocketEntry entry;
+        entry.nOwner = nOwner;
+        entry.nEvents = nEvents;
+        entry.fSeen = true;
+        mapSockets.insert(std::make_pair(hSocket, entry));
+        return true;
+    }
+
+    it->second.fSeen = true;
+    if (!Register(hSocket, it->second.nEvents, nEvents))
+        return false;
+    it->second.nEvents = nEvents;
+    return true;
+}
+
+void CSocketEvents::RemoveStale()
+{
+    std::map<SOCKET, SocketEntry>::iterator it = mapSockets.begin();
+    while (it != mapSockets.end()) {
+        if (!it->second.fSeen) {
+            Register(it->first, it->second.nEvents, 0);
+            mapSockets.erase(it++);
+        } else {
+            it->second.fSeen = false;
+            ++it;
+        }
+    }
+}
+
+bool CSocketEvents::Wait(int64_t nTimeoutMillis, std::vector<std::pair<SOCKET, int> >& vReady)
+{
+    vReady.clear();
+
+#ifdef USE_EPOLL
+    if (mode == SOCKETEVENTS_EPOLL) {
+        std::vector<struct epoll_event> vEvents(std::max(mapSockets.size(), (size_t)1));
+        int nReady = epoll_wait(fdEpoll, &vEvents[0], vEvents.size(), nTimeoutMillis);
+        if (nReady == -1) {
+            if (errno == EINTR)
+                return true;
+            BOOST_FOREACH (const PAIRTYPE(SOCKET, SocketEntry)& item, mapSockets)
+                if (item.second.nEvents & SOCKET_EVENT_RECV)
+                    vReady.push_back(std::make_pair(item.first, (int)SOCKET_EVENT_RECV));
+            return false;
+        }
+        vReady.reserve(nReady);
+        for (int i = 0; i < nReady; i++) {
+            int nEvents = 0;
+            if (vEvents[i].events & EPOLLIN)
+                nEvents |= SOCKET_EVENT_RECV;
+            if (vEvents[i].events & EPOLLOUT)
+                nEvents |= SOCKET_EVENT_SEND;
+            if (vEvents[i].events & (EPOLLERR | EPOLLHUP))
+                nEvents |= SOCKET_EVENT_ERR;
+            vReady.push_back(std::make_pair((SOCKET)vEvents[i].data.fd, nEvents));
+        }
+        return true;
+    }
+#endif
+
+    struct timeval timeout;
+    timeout.tv_sec = nTimeoutMillis / 1000;
+    timeout.tv_usec = (nTimeoutMillis % 1000) * 1000;
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    BOOST_FOREACH (const PAIRTYPE(SOCKET, SocketEntry)& item, mapSockets) {
+        if (item.second.nEvents == 0)
+            continue;
+        if (item.second.nEvents & SOCKET_EVENT_RECV)
+            FD_SET(item.first, &fdsetRecv);
+        if (item.second.nEvents & SOCKET_EVENT_SEND)
+            FD_SET(item.first, &fdsetSend);
+        FD_SET(item.first, &fdsetError);
+        hSocketMax = std::max(hSocketMax, item.first);
+        have_fds = true;
+    }
+
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR) {
+        if (!have_fds)
+            return true;
+        BOOST_FOREACH (const PAIRTYPE(SOCKET, SocketEntry)& item, mapSockets)
+            if (item.second.nEvents & SOCKET_EVENT_RECV)
+                vReady.push_back(std::make_pair(item.first, (int)SOCKET_EVENT_RECV));
+        return false;
+    }
+
+    if (nSelect > 0) {
+        BOOST_FOREACH (const PAIRTYPE(SOCKET, SocketEntry)& item, mapSockets) {
+            int nEvents = 0;
+            if (FD_ISSET(item.first, &fdsetRecv))
+                nEvents |= SOCKET_EVENT_RECV;
+            if (FD_ISSET(item.first, &fdsetSend))
+                nEvents |= SOCKET_EVENT_SEND;
+            if (FD_ISSET(item.first, &fdsetError))
+                nEvents |= SOCKET_EVENT_ERR;
+            if (nEvents)
+                vReady.push_back(std::make_pair(item.first, nEvents));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#include "compat.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** How the socket handler waits for socket readiness */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT,
+    SOCKETEVENTS_EPOLL,
+};
+
+enum SocketEvent {
+    SOCKET_EVENT_RECV = 1,
+    SOCKET_EVENT_SEND = 2,
+    SOCKET_EVENT_ERR = 4,
+};
+
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& mode);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+/** The modes this build supports, for the help message */
+std::string GetSupportedSocketEventsModes();
+
+/**
+ * Readiness notification for a set of sockets.
+ *
+ * The caller declares which events it wants for each socket with Set() and
+ * Wait() returns the sockets that are ready. In epoll mode the interest set
+ * lives in the kernel: only changes to it cost a system call, and a wakeup
+ * costs O(ready sockets) no matter how many are tracked. In select mode the
+ * fd_sets are rebuilt on every Wait(), and sockets >= FD_SETSIZE cannot be
+ * tracked.
+ */
+class CSocketEvents
+{
+public:
+    explicit CSocketEvents(SocketEventsMode modeIn);
+    ~CSocketEvents();
+
+    SocketEventsMode GetMode() const { return mode; }
+
+    /** Whether a socket can be tracked in the given mode */
+    static bool IsTrackable(SocketEventsMode mode, SOCKET hSocket);
+
+    /**
+     * Declare the events wanted for a socket; 0 stops reporting it.
+     * @param nOwner tells a new socket apart from a closed one that had the same descriptor
+     * @return false if the socket cannot be tracked
+     */
+    bool Set(SOCKET hSocket, int64_t nOwner, int nEvents);
+
+    /** Stop tracking the sockets that were not Set() since the last call */
+    void RemoveStale();
+
+    /**
+     * Wait until a socket with wanted events is ready, or the timeout expires.
+     * @param[out] vReady the ready sockets and their SocketEvent flags
+     * @return false on error, in which case every socket wanting to receive is reported ready
+     */
+    bool Wait(int64_t nTimeoutMillis, std::vector<std::pair<SOCKET, int> >& vReady);
+
+    /** Number of sockets tracked */
+    size_t size() const { return mapSockets.size(); }
+
+private:
+    struct SocketEntry {
+        int64_t nOwner;
+        int nEvents;
+        bool fSeen;
+    };
+
+    SocketEventsMode mode;
+    int fdEpoll;
+    std::map<SOCKET, SocketEntry> mapSockets;
+
+    bool Register(SOCKET hSocket, int nEventsOld, int nEventsNew);
+
+    CSocketEvents(const CSocketEvents&);
+    CSocketEvents& operator=(const CSocketEvents&);
+};
+
+#endif // BITCOIN_SOCKETEVENTS_H
@@ -564,4 +564,90 @@ public:
     }
 };
 
+/** Stream that deserializes from a range of memory it does not own, such as a
+ *  mapped file. It offers the positioning interface of CBufferedFile, without
+ *  any limit on how far it can rewind.
+ */
+class CMemoryReader
+{
+private:
+    int nType;
+    int nVersion;
+
+    const char* pbegin;  // start of the memory
+    uint64_t nSize;      // size of the memory
+    uint64_t nReadPos;   // how many bytes have been read from this
+    uint64_t nReadLimit; // up to which position we're allowed to read
+
+public:
+    CMemoryReader(const char* pbeginIn, uint64_t nSizeIn, int nTypeIn, int nVersionIn) : nType(nTypeIn), nVersion(nVersionIn), pbegin(pbeginIn), nSize(nSizeIn), nReadPos(0), nReadLimit((uint64_t)(-1)) {}
+
+    int GetType() { return nType; }
+    int GetVersion() { return nVersion; }
+
+    // check whether we're at the end of the memory
+    bool eof() const
+    {
+        return nReadPos >= nSize;
+    }
+
+    // read a number of bytes
+    CMemoryReader& read(char* pch, size_t nReadSize)
+    {
+        if (nReadSize + nReadPos > nReadLimit)
+            throw std::ios_base::failure("Read attempted past buffer limit");
+        if (nReadSize + nReadPos > nSize)
+            throw std::ios_base::failure("CMemoryReader::read : end of data");
+        memcpy(pch, pbegin + nReadPos, nReadSize);
+        nReadPos += nReadSize;
+        return (*this);
+    }
+
+    // return the current reading position
+    uint64_t GetPos()
+    {
+        return nReadPos;
+    }
+
+    // move to a given reading position
+    bool SetPos(uint64_t nPos)
+    {
+        if (nPos > nSize) {
+            nReadPos = nSize;
+            return false;
+        }
+        nReadPos = nPos;
+        return true;
+    }
+
+    // prevent reading beyond a certain position
+    // no argument removes the limit
+    bool SetLimit(uint64_t nPos = (uint64_t)(-1))
+    {
+        if (nPos < nReadPos)
+            return false;
+        nReadLimit = nPos;
+        return true;
+    }
+
+    template <typename T>
+    CMemoryReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+
+    // search for a given byte in the stream, and remain positioned on it
+    void FindByte(char ch)
+    {
+        const char* p = nReadPos < nSize ? (const char*)memchr(pbegin + nReadPos, ch, nSize - nReadPos) : NULL;
+        if (!p) {
+            nReadPos = nSize;
+            throw std::ios_base::failure("CMemoryReader::FindByte : end of data");
+        }
+        nReadPos = p - pbegin;
+    }
+};
+
 #endif // BITCOIN_STREAMS_H
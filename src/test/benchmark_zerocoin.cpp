@@ -25,6 +25,7 @@
 #include "libzerocoin/Coin.h"
 #include "libzerocoin/CoinSpend.h"
 #include "libzerocoin/Accumulator.h"
+#include "libzerocoin/FixedBaseExp.h"
 
 using namespace std;
 using namespace libzerocoin;
@@ -360,6 +361,21 @@ Testb_MintAndSpend()
 
 		cout << "\tSPEND VERIFY ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
 
+		// Verify again once the fixed-base tables are built, and without them
+		timer.start();
+		ret = newSpend.Verify(acc) && ret;
+		timer.stop();
+
+		cout << "\tSPEND VERIFY (TABLES BUILT) ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+
+		FixedBaseExp::setEnabled(false);
+		timer.start();
+		ret = newSpend.Verify(acc) && ret;
+		timer.stop();
+		FixedBaseExp::setEnabled(true);
+
+		cout << "\tSPEND VERIFY (NO TABLES) ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+
 		return ret;
 	} catch (runtime_error &e) {
 		cout << e.what() << endl;
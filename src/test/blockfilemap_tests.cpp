@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "main.h"
+#include "streams.h"
+#include "util.h"
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// block files far beyond anything the test chain writes
+static const int TEST_BLOCK_FILE = 9000;
+
+BOOST_AUTO_TEST_SUITE(blockfilemap_tests)
+
+BOOST_AUTO_TEST_CASE(memoryreader_positioning)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (uint32_t)0xdeadbeef << string("block file") << (uint8_t)0x42;
+    vector<char> vch(ss.begin(), ss.end());
+    CMemoryReader reader(&vch[0], vch.size(), SER_DISK, CLIENT_VERSION);
+
+    uint32_t n;
+    string str;
+    reader >> n >> str;
+    BOOST_CHECK_EQUAL(n, 0xdeadbeef);
+    BOOST_CHECK_EQUAL(str, "block file");
+    BOOST_CHECK(!reader.eof());
+
+    // rewinding works back to the start, unlike with a CBufferedFile
+    BOOST_CHECK(reader.SetPos(0));
+    reader >> n;
+    BOOST_CHECK_EQUAL(n, 0xdeadbeef);
+
+    // limits are honoured
+    BOOST_CHECK(reader.SetLimit(6));
+    BOOST_CHECK_THROW(reader >> str, std::ios_base::failure);
+    reader.SetLimit();
+    BOOST_CHECK(reader.SetPos(4));
+
+    reader.FindByte(0x42);
+    BOOST_CHECK_EQUAL(reader.GetPos(), vch.size() - 1);
+    uint8_t ch;
+    reader >> ch;
+    BOOST_CHECK_EQUAL(ch, 0x42);
+    BOOST_CHECK(reader.eof());
+    BOOST_CHECK_THROW(reader >> ch, std::ios_base::failure);
+    BOOST_CHECK(!reader.SetPos(vch.size() + 1));
+    BOOST_CHECK_THROW(reader.FindByte(0x42), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilemap_read_blocks)
+{
+    CBlock genesis = Params().GenesisBlock();
+    CDiskBlockPos pos(TEST_BLOCK_FILE, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(genesis, pos));
+    CDiskBlockPos posFirst = pos;
+
+    // the second block is appended after the first one was mapped
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, posFirst));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+    CMappedBlockFileRef file = blockFileMap.Get(pos.nFile, GetBlockPosFilename(pos, "blk"), 0);
+    BOOST_REQUIRE(file);
+    size_t nMappedSize = file->size();
+
+    CBlock block2 = genesis;
+    block2.nNonce++;
+    pos.nPos += ::GetSerializeSize(genesis, SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(WriteBlockToDisk(block2, pos));
+    BOOST_CHECK(ReadBlockFromDisk(block, pos));
+    BOOST_CHECK(block.GetHash() == block2.GetHash());
+    CMappedBlockFileRef file2 = blockFileMap.Get(pos.nFile, GetBlockPosFilename(pos, "blk"), 0);
+    BOOST_CHECK(file2->size() > nMappedSize);
+    // the old mapping stays valid for whoever still holds it
+    BOOST_CHECK_EQUAL(file->size(), nMappedSize);
+
+    // the same through stdio
+    blockFileMap.SetEnabled(false);
+    BOOST_CHECK(!blockFileMap.Get(pos.nFile, GetBlockPosFilename(pos, "blk"), 0));
+    BOOST_CHECK(ReadBlockFromDisk(block, posFirst));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+    BOOST_CHECK(ReadBlockFromDisk(block, pos));
+    BOOST_CHECK(block.GetHash() == block2.GetHash());
+    blockFileMap.SetEnabled(true);
+
+    // a position past the end of the file does not map
+    CDiskBlockPos posBad(TEST_BLOCK_FILE, pos.nPos + 0x100000);
+    BOOST_CHECK(!blockFileMap.Get(posBad.nFile, GetBlockPosFilename(posBad, "blk"), posBad.nPos));
+    BOOST_CHECK(!ReadBlockFromDisk(block, posBad));
+    blockFileMap.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(blockfilemap_lru)
+{
+    CBlock genesis = Params().GenesisBlock();
+    vector<CMappedBlockFileRef> vFiles;
+    for (int i = 1; i <= 20; i++) {
+        CDiskBlockPos pos(TEST_BLOCK_FILE + i, 0);
+        BOOST_REQUIRE(WriteBlockToDisk(genesis, pos));
+        vFiles.push_back(blockFileMap.Get(pos.nFile, GetBlockPosFilename(pos, "blk"), 0));
+        BOOST_REQUIRE(vFiles.back());
+    }
+    // recently used files are served from the set, evicted ones are mapped again
+    CDiskBlockPos posLast(TEST_BLOCK_FILE + 20, 0);
+    BOOST_CHECK(blockFileMap.Get(posLast.nFile, GetBlockPosFilename(posLast, "blk"), 0) == vFiles.back());
+    CDiskBlockPos posFirst(TEST_BLOCK_FILE + 1, 0);
+    CMappedBlockFileRef file = blockFileMap.Get(posFirst.nFile, GetBlockPosFilename(posFirst, "blk"), 0);
+    BOOST_REQUIRE(file);
+    BOOST_CHECK(file != vFiles.front());
+    BOOST_CHECK(memcmp(file->begin(), vFiles.front()->begin(), file->size()) == 0);
+
+    blockFileMap.Erase(posFirst.nFile);
+    BOOST_CHECK(blockFileMap.Get(posFirst.nFile, GetBlockPosFilename(posFirst, "blk"), 0) != file);
+    blockFileMap.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
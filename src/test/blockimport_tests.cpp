@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "main.h"
+#include "streams.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// block files far beyond anything the test chain writes
+static const int TEST_BLOCK_FILE = 9100;
+
+static CMappedBlockFileRef WriteTestBlockFile(int nFile, const CDataStream& ss)
+{
+    CDiskBlockPos pos(nFile, 0);
+    FILE* file = OpenBlockFile(pos);
+    BOOST_REQUIRE(file);
+    BOOST_REQUIRE_EQUAL(fwrite(&ss[0], 1, ss.size(), file), ss.size());
+    fclose(file);
+    return blockFileMap.Get(pos.nFile, GetBlockPosFilename(pos, "blk"), ss.size());
+}
+
+static void WriteBlock(CDataStream& ss, const CBlock& block, unsigned int nSizeDelta = 0)
+{
+    unsigned int nSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION) + nSizeDelta;
+    ss << FLATDATA(Params().MessageStart()) << nSize << block;
+}
+
+BOOST_AUTO_TEST_SUITE(blockimport_tests)
+
+BOOST_AUTO_TEST_CASE(blockimport_file_order)
+{
+    CBlock genesis = Params().GenesisBlock();
+    vector<CBlock> vBlocks;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    for (int i = 0; i < 100; i++) {
+        CBlock block = genesis;
+        block.nNonce += i;
+        if (i == 42)
+            block.hashMerkleRoot = uint256(1);
+        WriteBlock(ss, block);
+        vBlocks.push_back(block);
+        // junk between blocks is skipped, as by the serial scanner
+        if (i % 10 == 3)
+            ss << FLATDATA(Params().MessageStart()) << (unsigned int)1 << FLATDATA(Params().MessageStart());
+    }
+    CMappedBlockFileRef file = WriteTestBlockFile(TEST_BLOCK_FILE, ss);
+    BOOST_REQUIRE(file);
+
+    CBlockImportPipeline pipeline(file, Params().MessageStart(), 4);
+    CImportedBlockRef item;
+    for (unsigned int i = 0; i < vBlocks.size(); i++) {
+        BOOST_REQUIRE(pipeline.Next(item));
+        BOOST_CHECK(item->fDecoded);
+        BOOST_CHECK_EQUAL(item->nEnd, item->nPos + item->nSize);
+        BOOST_CHECK(item->block.GetHash() == vBlocks[i].GetHash());
+        BOOST_CHECK_EQUAL(item->fPrechecked, i != 42);
+    }
+    BOOST_CHECK(!pipeline.Next(item));
+
+    CBlockImportStats stats = pipeline.GetStats();
+    BOOST_CHECK_EQUAL(stats.nBlocks, vBlocks.size());
+    BOOST_CHECK(stats.nDepthMax <= REINDEX_QUEUE_SIZE);
+    blockFileMap.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(blockimport_restart)
+{
+    CBlock genesis = Params().GenesisBlock();
+    CBlock block2 = genesis;
+    block2.nNonce++;
+    CBlock block3 = block2;
+    block3.nNonce++;
+
+    // the first block's size claims more than it decodes to, so the next
+    // block is only found by rescanning from where the first one ended
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    WriteBlock(ss, genesis, 100);
+    WriteBlock(ss, block2);
+    WriteBlock(ss, block3);
+    ss.insert(ss.end(), 100, 0);
+    CMappedBlockFileRef file = WriteTestBlockFile(TEST_BLOCK_FILE + 1, ss);
+    BOOST_REQUIRE(file);
+
+    CBlockImportPipeline pipeline(file, Params().MessageStart(), 2);
+    CImportedBlockRef item;
+    BOOST_REQUIRE(pipeline.Next(item));
+    BOOST_CHECK(item->block.GetHash() == genesis.GetHash());
+    BOOST_CHECK(item->nEnd < item->nPos + item->nSize);
+    pipeline.Restart(item->nEnd);
+    BOOST_REQUIRE(pipeline.Next(item));
+    BOOST_CHECK(item->block.GetHash() == block2.GetHash());
+    BOOST_REQUIRE(pipeline.Next(item));
+    BOOST_CHECK(item->block.GetHash() == block3.GetHash());
+    BOOST_CHECK(!pipeline.Next(item));
+
+    // rescanning from the start hands out the first block again
+    pipeline.Restart(0);
+    BOOST_REQUIRE(pipeline.Next(item));
+    BOOST_CHECK(item->block.GetHash() == genesis.GetHash());
+    blockFileMap.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 
 
 
+#include "checkqueue.h"
 #include "clientversion.h"
 #include "main.h"
 #include "utiltime.h"
@@ -17,6 +18,7 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 
 BOOST_AUTO_TEST_SUITE(CheckBlock_tests)
@@ -66,4 +68,52 @@ BOOST_AUTO_TEST_CASE(May15)
     SetMockTime(0);
 }
 
+static bool RunBlockChecks(CCheckQueue<CBlockCheck>& queue, const CBlock& block)
+{
+    CCheckQueueControl<CBlockCheck> control(&queue);
+    block.GetHash();
+    std::vector<CBlockCheck> vChecks;
+    vChecks.push_back(CBlockCheck(block, CBlockCheck::MERKLE_ROOT));
+    vChecks.push_back(CBlockCheck(block, CBlockCheck::BLOCK_SIGNATURE));
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+BOOST_AUTO_TEST_CASE(parallel_block_checks)
+{
+    CCheckQueue<CBlockCheck> queue(1);
+    boost::thread_group threads;
+    threads.create_thread(boost::bind(&CCheckQueue<CBlockCheck>::Thread, &queue));
+
+    CBlock block = Params().GenesisBlock();
+    BOOST_CHECK(CBlockCheck(block, CBlockCheck::MERKLE_ROOT)());
+    BOOST_CHECK(CBlockCheck(block, CBlockCheck::BLOCK_SIGNATURE)());
+    BOOST_CHECK(RunBlockChecks(queue, block));
+
+    // a proof-of-work block carries no signature
+    CBlock blockSigned = block;
+    blockSigned.vchBlockSig.push_back(0x30);
+    BOOST_CHECK(!CBlockCheck(blockSigned, CBlockCheck::BLOCK_SIGNATURE)());
+    BOOST_CHECK(!RunBlockChecks(queue, blockSigned));
+
+    CBlock blockBadRoot = block;
+    blockBadRoot.hashMerkleRoot = uint256(1);
+    BOOST_CHECK(!CBlockCheck(blockBadRoot, CBlockCheck::MERKLE_ROOT)());
+    BOOST_CHECK(!RunBlockChecks(queue, blockBadRoot));
+
+    // a duplicated transaction keeps the root of the tree but mutates it
+    CBlock blockMutated = block;
+    blockMutated.vtx.push_back(blockMutated.vtx[0]);
+    blockMutated.hashMerkleRoot = blockMutated.BuildMerkleTree();
+    BOOST_CHECK(!CBlockCheck(blockMutated, CBlockCheck::MERKLE_ROOT)());
+
+    // the serial CheckBlock, which ProcessNewBlock falls back to, tells which check failed
+    CValidationState state;
+    BOOST_CHECK(!CheckBlock(blockBadRoot, state, false, true));
+    BOOST_CHECK(state.GetRejectReason() == "bad-txnmrklroot");
+
+    threads.interrupt_all();
+    threads.join_all();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
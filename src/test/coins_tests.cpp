@@ -3,12 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "coins.h"
+#include "memusage.h"
 #include "random.h"
 #include "uint256.h"
 
 #include <vector>
 #include <map>
 
+#include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
 
 namespace
@@ -58,6 +60,32 @@ public:
 
     bool GetStats(CCoinsStats& stats) const { return false; }
 };
+
+class CCoinsViewCacheTest : public CCoinsViewCache
+{
+public:
+    CCoinsViewCacheTest(CCoinsView* base) : CCoinsViewCache(base) {}
+
+    void SelfTest() const
+    {
+        // Manually recompute the dynamic usage of the whole data, and compare it.
+        size_t ret = memusage::DynamicUsage(cacheCoins);
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+            ret += it->second.coins.DynamicMemoryUsage();
+        }
+        BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
+    }
+
+    size_t GetDirtyCount() const
+    {
+        size_t count = 0;
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+                count++;
+        }
+        return count;
+    }
+};
 }
 
 BOOST_AUTO_TEST_SUITE(coins_tests)
@@ -83,14 +111,15 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     bool updated_an_entry = false;
     bool found_an_entry = false;
     bool missed_an_entry = false;
+    bool synced_a_cache = false;
 
     // A simple map to track what we expect the cache stack to represent.
     std::map<uint256, CCoins> result;
 
     // The cache stack.
     CCoinsViewTest base; // A CCoinsViewTest at the bottom.
-    std::vector<CCoinsViewCache*> stack; // A stack of CCoinsViewCaches on top.
-    stack.push_back(new CCoinsViewCache(&base)); // Start with one cache.
+    std::vector<CCoinsViewCacheTest*> stack; // A stack of CCoinsViewCaches on top.
+    stack.push_back(new CCoinsViewCacheTest(&base)); // Start with one cache.
 
     // Use a limited set of random transaction ids, so we do test overwriting entries.
     std::vector<uint256> txids;
@@ -115,6 +144,7 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                 coins.nVersion = insecure_rand();
                 coins.vout.resize(1);
                 coins.vout[0].nValue = insecure_rand();
+                coins.vout[0].scriptPubKey.assign(insecure_rand() % 100, 0x51);
                 *entry = coins;
             } else {
                 coins.Clear();
@@ -135,6 +165,18 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                     missed_an_entry = true;
                 }
             }
+            BOOST_FOREACH (const CCoinsViewCacheTest* test, stack) {
+                test->SelfTest();
+            }
+        }
+
+        if (insecure_rand() % 250 == 0 && stack.size() > 0) {
+            // Occasionally write the tip through to its base and shrink it, keeping it in place.
+            BOOST_CHECK(stack.back()->Sync());
+            BOOST_CHECK_EQUAL(stack.back()->GetDirtyCount(), 0U);
+            stack.back()->Trim(stack.back()->DynamicMemoryUsage() / 2);
+            stack.back()->SelfTest();
+            synced_a_cache = true;
         }
 
         if (insecure_rand() % 100 == 0) {
@@ -151,7 +193,7 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                 } else {
                     removed_all_caches = true;
                 }
-                stack.push_back(new CCoinsViewCache(tip));
+                stack.push_back(new CCoinsViewCacheTest(tip));
                 if (stack.size() == 4) {
                     reached_4_caches = true;
                 }
@@ -173,6 +215,76 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(updated_an_entry);
     BOOST_CHECK(found_an_entry);
     BOOST_CHECK(missed_an_entry);
+    BOOST_CHECK(synced_a_cache);
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_usage_test)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), memusage::DynamicUsage(CCoinsMap()));
+
+    // A few large transactions.
+    std::vector<uint256> txids;
+    for (int i = 0; i < 20; i++) {
+        txids.push_back(GetRandHash());
+        CCoinsModifier coins = cache.ModifyCoins(txids.back());
+        coins->nVersion = 1;
+        coins->vout.resize(50);
+        for (unsigned int n = 0; n < coins->vout.size(); n++) {
+            coins->vout[n].nValue = n + 1;
+            coins->vout[n].scriptPubKey.assign(25, 0x51);
+        }
+    }
+    cache.SelfTest();
+    size_t nUsageFull = cache.DynamicMemoryUsage();
+
+    // Spending an output releases its script.
+    for (int i = 0; i < 20; i++) {
+        CCoinsModifier coins = cache.ModifyCoins(txids[i]);
+        for (unsigned int n = 0; n < 40; n++)
+            BOOST_CHECK(coins->Spend(n));
+        BOOST_CHECK(coins->IsAvailable(40));
+    }
+    cache.SelfTest();
+    BOOST_CHECK(cache.DynamicMemoryUsage() < nUsageFull);
+
+    // Syncing writes everything but keeps it cached.
+    size_t nUsage = cache.DynamicMemoryUsage();
+    BOOST_CHECK_EQUAL(cache.GetDirtyCount(), 20U);
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetDirtyCount(), 0U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 20U);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), nUsage);
+
+    // Modified entries survive trimming; clean ones go, and are read back from the base.
+    {
+        CCoinsModifier coins = cache.ModifyCoins(txids[0]);
+        BOOST_CHECK(coins->Spend(40));
+    }
+    cache.Trim(0);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() < nUsage);
+    for (int i = 1; i < 20; i++) {
+        const CCoins* coins = cache.AccessCoins(txids[i]);
+        BOOST_REQUIRE(coins);
+        BOOST_CHECK(!coins->IsAvailable(39));
+        BOOST_CHECK(coins->IsAvailable(40));
+        BOOST_CHECK_EQUAL(coins->vout[49].nValue, 50);
+    }
+    cache.SelfTest();
+
+    // Spending a transaction entirely drops it from the cache on sync.
+    {
+        CCoinsModifier coins = cache.ModifyCoins(txids[1]);
+        for (unsigned int n = 40; n < 50; n++)
+            BOOST_CHECK(coins->Spend(n));
+    }
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 19U);
+    BOOST_CHECK(!cache.HaveCoins(txids[1]));
+    cache.SelfTest();
 }
 
 BOOST_AUTO_TEST_SUITE_END()
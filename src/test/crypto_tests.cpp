@@ -11,6 +11,7 @@
 #include "crypto/hmac_sha512.h"
 #include "random.h"
 #include "utilstrencodings.h"
+#include "utiltime.h"
 
 #include <vector>
 
@@ -131,6 +132,50 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+static void TestSHA256D64(const std::vector<unsigned char>& in, size_t blocks)
+{
+    std::vector<unsigned char> out(32 * blocks), expected(32 * blocks);
+    for (size_t i = 0; i < blocks; i++) {
+        unsigned char hash[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(&in[64 * i], 64).Finalize(hash);
+        CSHA256().Write(hash, sizeof(hash)).Finalize(&expected[32 * i]);
+    }
+    SHA256D64(out.data(), in.data(), blocks);
+    BOOST_CHECK(out == expected);
+}
+
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    // every number of blocks, so each of the 8-, 4- and 1-way paths and their mixes is taken
+    std::vector<unsigned char> in(64 * 32);
+    for (size_t i = 0; i < in.size(); i++)
+        in[i] = insecure_rand();
+    for (int fHardware = 0; fHardware < 2; fHardware++) {
+        std::string strImpl = SHA256AutoDetect(fHardware);
+        BOOST_TEST_MESSAGE("SHA256 implementation: " << strImpl);
+        for (size_t blocks = 0; blocks <= 32; blocks++)
+            TestSHA256D64(in, blocks);
+    }
+
+    // the pairs of the first level of a merkle tree of 2048 transactions, and a 1MB block
+    std::vector<unsigned char> vPairs(64 * 1024), vHashes(32 * 1024), vBlock(1000000);
+    int64_t nTime[2], nTimeBlock[2];
+    for (int fHardware = 0; fHardware < 2; fHardware++) {
+        SHA256AutoDetect(fHardware);
+        int64_t nStart = GetTimeMicros();
+        for (int i = 0; i < 100; i++)
+            SHA256D64(vHashes.data(), vPairs.data(), 1024);
+        nTime[fHardware] = GetTimeMicros() - nStart;
+        unsigned char hash[CSHA256::OUTPUT_SIZE];
+        nStart = GetTimeMicros();
+        for (int i = 0; i < 10; i++)
+            CSHA256().Write(vBlock.data(), vBlock.size()).Finalize(hash);
+        nTimeBlock[fHardware] = GetTimeMicros() - nStart;
+    }
+    BOOST_TEST_MESSAGE("100 merkle levels of 1024 pairs: " << nTime[0] << "us portable, " << nTime[1] << "us detected");
+    BOOST_TEST_MESSAGE("10 SHA256 of 1MB: " << nTimeBlock[0] << "us portable, " << nTimeBlock[1] << "us detected");
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
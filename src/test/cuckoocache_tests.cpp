@@ -0,0 +1,142 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include <cstring>
+
+namespace
+{
+class TestHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+typedef CuckooCache::cache<uint256, TestHasher> test_cache;
+
+std::vector<uint256> RandomHashes(unsigned int n)
+{
+    std::vector<uint256> v(n);
+    for (unsigned int i = 0; i < n; i++)
+        v[i] = GetRandHash();
+    return v;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(cuckoocache_tests)
+
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_contains)
+{
+    test_cache cc;
+    // not sized yet: nothing is stored
+    uint256 hash = GetRandHash();
+    cc.insert(hash);
+    BOOST_CHECK(!cc.contains(hash, false));
+    BOOST_CHECK_EQUAL(cc.capacity(), 0U);
+
+    BOOST_CHECK_EQUAL(cc.setup(4096), 4096U);
+    BOOST_CHECK_EQUAL(cc.setup_bytes(0), 2U);
+    BOOST_CHECK_EQUAL(cc.setup_bytes(4096 * sizeof(uint256)), 4096U);
+
+    std::vector<uint256> vIn = RandomHashes(1000);
+    std::vector<uint256> vOut = RandomHashes(1000);
+    BOOST_FOREACH (const uint256& h, vIn)
+        cc.insert(h);
+
+    BOOST_FOREACH (const uint256& h, vIn)
+        BOOST_CHECK(cc.contains(h, false));
+    BOOST_FOREACH (const uint256& h, vOut)
+        BOOST_CHECK(!cc.contains(h, false));
+
+    // erasing only marks the slot; the element stays until it is overwritten
+    BOOST_CHECK(cc.contains(vIn[0], true));
+    BOOST_CHECK(cc.contains(vIn[0], false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_eviction)
+{
+    test_cache cc;
+    uint32_t nSize = cc.setup(1 << 12);
+
+    // filling the cache twice over keeps most of the most recent entries
+    std::vector<uint256> vOld = RandomHashes(nSize);
+    std::vector<uint256> vNew = RandomHashes(nSize / 2);
+    BOOST_FOREACH (const uint256& h, vOld)
+        cc.insert(h);
+    BOOST_FOREACH (const uint256& h, vNew)
+        cc.insert(h);
+
+    unsigned int nNewFound = 0;
+    BOOST_FOREACH (const uint256& h, vNew)
+        nNewFound += cc.contains(h, false);
+    BOOST_CHECK(nNewFound > vNew.size() * 9 / 10);
+
+    // erased entries are the first to be replaced
+    std::vector<uint256> vErase = RandomHashes(nSize / 4);
+    test_cache cc2;
+    cc2.setup(nSize);
+    BOOST_FOREACH (const uint256& h, vErase)
+        cc2.insert(h);
+    BOOST_FOREACH (const uint256& h, vErase)
+        cc2.contains(h, true);
+    std::vector<uint256> vKeep = RandomHashes(nSize * 3 / 4);
+    BOOST_FOREACH (const uint256& h, vKeep)
+        cc2.insert(h);
+    unsigned int nKeepFound = 0;
+    BOOST_FOREACH (const uint256& h, vKeep)
+        nKeepFound += cc2.contains(h, false);
+    BOOST_CHECK(nKeepFound > vKeep.size() * 95 / 100);
+}
+
+static void ReadCache(const test_cache* cc, const std::vector<uint256>* v, size_t nStart, size_t nEnd, unsigned int* pnFound)
+{
+    for (size_t i = nStart; i < nEnd; i++)
+        *pnFound += cc->contains((*v)[i], true);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_concurrent_readers)
+{
+    test_cache cc;
+    cc.setup(1 << 14);
+    std::vector<uint256> v = RandomHashes(4000);
+    BOOST_FOREACH (const uint256& h, v)
+        cc.insert(h);
+
+    // readers may look up and erase at the same time
+    const unsigned int nThreads = 4;
+    std::vector<unsigned int> vFound(nThreads, 0);
+    boost::thread_group threads;
+    for (unsigned int i = 0; i < nThreads; i++) {
+        size_t nStart = v.size() * i / nThreads, nEnd = v.size() * (i + 1) / nThreads;
+        threads.create_thread(boost::bind(&ReadCache, &cc, &v, nStart, nEnd, &vFound[i]));
+    }
+    threads.join_all();
+
+    unsigned int nFound = 0;
+    for (unsigned int i = 0; i < nThreads; i++)
+        nFound += vFound[i];
+    BOOST_CHECK_EQUAL(nFound, v.size());
+
+    // everything is erasable now, so new inserts all find room
+    std::vector<uint256> vNew = RandomHashes(4000);
+    BOOST_FOREACH (const uint256& h, vNew)
+        cc.insert(h);
+    BOOST_FOREACH (const uint256& h, vNew)
+        BOOST_CHECK(cc.contains(h, false));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
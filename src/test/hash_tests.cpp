@@ -3,11 +3,16 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/sph_aesni.h"
+#include "primitives/block.h"
+#include "random.h"
 #include "utilstrencodings.h"
+#include "utiltime.h"
 
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 using namespace std;
 
@@ -46,4 +51,127 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+#define XEVAN_BENCH_HEADERS 2000
+
+BOOST_AUTO_TEST_CASE(xevan_aesni)
+{
+    // 80 byte block headers, as hashed by CBlockHeader::GetHash()
+    vector<vector<unsigned char> > vHeaders;
+    for (int i = 0; i < XEVAN_BENCH_HEADERS; i++) {
+        vector<unsigned char> vch(80);
+        GetRandBytes(&vch[0], vch.size());
+        vHeaders.push_back(vch);
+    }
+
+    int64_t nTimes[2];
+    vector<uint256> vHashes[2];
+    int fWasActive = sph_aesni_active;
+    for (int fAesNi = 0; fAesNi < 2; fAesNi++) {
+        sph_aesni_enable(fAesNi);
+        int64_t nStart = GetTimeMicros();
+        for (int i = 0; i < XEVAN_BENCH_HEADERS; i++)
+            vHashes[fAesNi].push_back(XEVAN(vHeaders[i].begin(), vHeaders[i].end()));
+        nTimes[fAesNi] = std::max(GetTimeMicros() - nStart, (int64_t)1);
+    }
+    sph_aesni_enable(fWasActive);
+
+    BOOST_CHECK(vHashes[0] == vHashes[1]);
+    BOOST_TEST_MESSAGE("XEVAN headers/s: portable " << (int64_t)XEVAN_BENCH_HEADERS * 1000000 / nTimes[0]
+                                                    << (sph_aesni_supported() ? ", AES-NI " : ", AES-NI not supported ")
+                                                    << (int64_t)XEVAN_BENCH_HEADERS * 1000000 / nTimes[1]);
+}
+
+BOOST_AUTO_TEST_CASE(block_header_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 3;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1525981707;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 1;
+
+    // hashed once, then served from the cache
+    uint64_t nHashes = CBlockHeader::GetHashCount();
+    uint256 hash = header.GetHash();
+    BOOST_CHECK(hash == XEVAN(BEGIN(header.nVersion), END(header.nNonce)));
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCount() - nHashes, 1U);
+
+    // copies keep the cache
+    CBlockHeader copy = header;
+    CBlock block(header);
+    BOOST_CHECK(copy.GetHash() == hash);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCount() - nHashes, 1U);
+
+    // changing any hashed field invalidates it
+    header.nNonce++;
+    uint256 hashNonce = header.GetHash();
+    BOOST_CHECK(hashNonce != hash);
+    BOOST_CHECK(hashNonce == XEVAN(BEGIN(header.nVersion), END(header.nNonce)));
+    header.nNonce--;
+    BOOST_CHECK(header.GetHash() == hash);
+    header.hashPrevBlock = GetRandHash();
+    BOOST_CHECK(header.GetHash() != hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCount() - nHashes, 4U);
+
+    // the accumulator checkpoint is only hashed from version 4 on
+    header.nAccumulatorCheckpoint = GetRandHash();
+    uint256 hashV3 = header.GetHash();
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCount() - nHashes, 4U);
+    header.nVersion = 4;
+    uint256 hashV4 = header.GetHash();
+    BOOST_CHECK(hashV4 == Hash(BEGIN(header.nVersion), END(header.nAccumulatorCheckpoint)));
+    header.nAccumulatorCheckpoint = GetRandHash();
+    BOOST_CHECK(header.GetHash() != hashV4);
+    BOOST_CHECK(hashV3 != hashV4);
+
+    // a hash handed in from the block index is trusted for the current fields only
+    CBlockHeader indexed = copy;
+    indexed.SetNull();
+    indexed.nVersion = copy.nVersion;
+    indexed.hashPrevBlock = copy.hashPrevBlock;
+    indexed.hashMerkleRoot = copy.hashMerkleRoot;
+    indexed.nTime = copy.nTime;
+    indexed.nBits = copy.nBits;
+    indexed.nNonce = copy.nNonce;
+    indexed.SetCachedHash(hash);
+    nHashes = CBlockHeader::GetHashCount();
+    BOOST_CHECK(indexed.GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCount(), nHashes);
+    indexed.nTime++;
+    BOOST_CHECK(indexed.GetHash() != hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::GetHashCount() - nHashes, 1U);
+}
+
+static void HashSharedBlock(const CBlock* pblock, uint256* phash, bool* pfSame)
+{
+    *pfSame = true;
+    for (int i = 0; i < 1000; i++) {
+        CBlockHeader header = pblock->GetBlockHeader();
+        *pfSame &= pblock->GetHash() == *phash && header.GetHash() == *phash;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_header_hash_threads)
+{
+    CBlock block;
+    block.nVersion = 3;
+    block.hashPrevBlock = GetRandHash();
+    block.nBits = 0x1e0ffff0;
+    uint256 hash = XEVAN(BEGIN(block.nVersion), END(block.nNonce));
+
+    // threads hashing and copying a shared block all get its hash
+    bool vfSame[4];
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++)
+        threads.create_thread(boost::bind(&HashSharedBlock, &block, &hash, &vfSame[i]));
+    threads.join_all();
+    for (int i = 0; i < 4; i++)
+        BOOST_CHECK(vfSame[i]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+// Copyright (c) 2017-2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <boost/test/unit_test.hpp>
+
+#include "kernel.h"
+#include "random.h"
+#include "utiltime.h"
+
+#define KERNEL_BENCH_OUTPUTS 2000
+#define KERNEL_BENCH_DRIFT 45
+
+BOOST_AUTO_TEST_SUITE(kernel_tests)
+
+BOOST_AUTO_TEST_CASE(stake_kernel_hash)
+{
+    std::vector<COutPoint> vPrevouts;
+    std::vector<uint64_t> vModifiers;
+    for (int i = 0; i < KERNEL_BENCH_OUTPUTS; i++) {
+        vPrevouts.push_back(COutPoint(GetRandHash(), GetRand(10)));
+        vModifiers.push_back(GetRand(std::numeric_limits<uint64_t>::max()));
+    }
+    unsigned int nTimeBlockFrom = 1525981707;
+    unsigned int nTimeTx = nTimeBlockFrom + 60 * 60 * 24;
+
+    // serialize the full preimage per try, as CheckStakeKernelHash does
+    std::vector<uint256> vStreamed;
+    int64_t nStart = GetTimeMicros();
+    for (int i = 0; i < KERNEL_BENCH_OUTPUTS; i++) {
+        CDataStream ss(SER_GETHASH, 0);
+        ss << vModifiers[i];
+        for (unsigned int n = 0; n < KERNEL_BENCH_DRIFT; n++)
+            vStreamed.push_back(stakeHash(nTimeTx + n, ss, vPrevouts[i].n, vPrevouts[i].hash, nTimeBlockFrom));
+    }
+    int64_t nStreamedTime = std::max(GetTimeMicros() - nStart, (int64_t)1);
+
+    std::vector<uint256> vKernel;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < KERNEL_BENCH_OUTPUTS; i++) {
+        CStakeKernel kernel(vModifiers[i], nTimeBlockFrom, vPrevouts[i]);
+        for (unsigned int n = 0; n < KERNEL_BENCH_DRIFT; n++)
+            vKernel.push_back(kernel.GetHash(nTimeTx + n));
+    }
+    int64_t nKernelTime = std::max(GetTimeMicros() - nStart, (int64_t)1);
+
+    BOOST_CHECK(vStreamed == vKernel);
+
+    double nHashes = KERNEL_BENCH_OUTPUTS * KERNEL_BENCH_DRIFT;
+    BOOST_TEST_MESSAGE("stake kernels/s: stream " << (int64_t)(nHashes * 1000000 / nStreamedTime)
+                                                  << ", precomputed prefix " << (int64_t)(nHashes * 1000000 / nKernelTime));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,6 +23,7 @@
 #include "libzerocoin/Coin.h"
 #include "libzerocoin/CoinSpend.h"
 #include "libzerocoin/Accumulator.h"
+#include "libzerocoin/FixedBaseExp.h"
 
 using namespace std;
 using namespace libzerocoin;
@@ -489,4 +490,27 @@ BOOST_AUTO_TEST_CASE(libzerocoin_tests)
 	
 	Test_RunAllTests();
 }
+
+BOOST_AUTO_TEST_CASE(fixed_base_exp_tests)
+{
+	CBigNum modulus = CBigNum::generatePrime(512);
+	CBigNum g = CBigNum::randBignum(modulus);
+	CBigNum h = CBigNum::randBignum(modulus);
+	GroupExpTables tables(g, h, modulus);
+
+	for (unsigned int bits = 1; bits <= 2048; bits *= 2) {
+		CBigNum x = CBigNum::RandKBitBigum(bits);
+		CBigNum y = CBigNum::RandKBitBigum(bits / 2 + 1);
+		BOOST_CHECK(tables.g.pow_mod(x) == g.pow_mod(x, modulus));
+		BOOST_CHECK(tables.g.pow_mod(x * -1) == g.pow_mod(x * -1, modulus));
+		BOOST_CHECK(tables.pow_mod_gh(x, y) == g.pow_mod(x, modulus).mul_mod(h.pow_mod(y, modulus), modulus));
+		BOOST_CHECK(tables.pow_mod_gh(x * -1, y) == g.pow_mod(x * -1, modulus).mul_mod(h.pow_mod(y, modulus), modulus));
+	}
+
+	// exponents past the table and a zero exponent take the plain path
+	CBigNum big = CBigNum::RandKBitBigum(4 * 512);
+	BOOST_CHECK(tables.h.pow_mod(big) == h.pow_mod(big, modulus));
+	BOOST_CHECK(tables.pow_mod_gh(big, 0) == g.pow_mod(big, modulus));
+	BOOST_CHECK(tables.pow_mod_gh(0, 0) == CBigNum(1));
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+// Copyright (c) 2017-2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "masternode-payments.h"
+#include "utiltime.h"
+
+#define LASTPAID_MASTERNODES 5000
+#define LASTPAID_DEPTH (LASTPAID_MASTERNODES * 5 / 4)
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(masternode_payments_tests)
+
+namespace
+{
+    CScript PayeeScript(int n)
+    {
+        return CScript() << OP_DUP << OP_HASH160 << CScriptNum(n) << OP_EQUALVERIFY << OP_CHECKSIG;
+    }
+
+    // reference implementation: the chain walk CMasternode::GetLastPaid used to do per masternode
+    int WalkLastPaidHeight(CMasternodePayments& payments, const CScript& payee, int nTipHeight, int nDepth)
+    {
+        for (int h = nTipHeight, n = 0; h > 0 && n < nDepth; h--, n++) {
+            if (payments.mapMasternodeBlocks.count(h) &&
+                payments.mapMasternodeBlocks[h].HasPayeeWithVotes(payee, MNPAYMENTS_LASTPAID_MIN_VOTES))
+                return h;
+        }
+        return 0;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lastpaid_index)
+{
+    CMasternodePayments payments;
+    vector<CScript> vPayees;
+    for (int i = 0; i < LASTPAID_MASTERNODES; i++)
+        vPayees.push_back(PayeeScript(i));
+
+    // every block has a winner, every 7th winner is short of votes and a rival payee trails behind it
+    int nTipHeight = LASTPAID_DEPTH + 100;
+    for (int h = 1; h <= nTipHeight + 10; h++) {
+        CMasternodeBlockPayees blockPayees(h);
+        blockPayees.AddPayee(vPayees[(h * 7919) % LASTPAID_MASTERNODES], h % 7 == 0 ? 1 : 3);
+        blockPayees.AddPayee(vPayees[(h * 104729) % LASTPAID_MASTERNODES], 1);
+        payments.mapMasternodeBlocks[h] = blockPayees;
+    }
+    payments.RebuildLastPaidIndex();
+
+    int64_t nStart = GetTimeMicros();
+    vector<int> vIndexed;
+    for (int i = 0; i < LASTPAID_MASTERNODES; i++)
+        vIndexed.push_back(payments.GetLastPaidHeight(vPayees[i], nTipHeight, LASTPAID_DEPTH));
+    int64_t nIndexed = GetTimeMicros() - nStart;
+
+    nStart = GetTimeMicros();
+    for (int i = 0; i < LASTPAID_MASTERNODES; i++)
+        BOOST_CHECK_EQUAL(vIndexed[i], WalkLastPaidHeight(payments, vPayees[i], nTipHeight, LASTPAID_DEPTH));
+    int64_t nWalked = GetTimeMicros() - nStart;
+
+    BOOST_TEST_MESSAGE("last paid lookup for " << LASTPAID_MASTERNODES << " masternodes: index " << nIndexed
+                                               << "us, chain walk " << nWalked << "us");
+
+    // blocks beyond the tip and outside the depth window are not payments yet/anymore
+    int nFuture = nTipHeight + 5;
+    CScript futurePayee = vPayees[(nFuture * 7919) % LASTPAID_MASTERNODES];
+    BOOST_CHECK(payments.GetLastPaidHeight(futurePayee, nTipHeight, LASTPAID_DEPTH) < nFuture);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidHeight(vPayees[0], nTipHeight, 0), 0);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidHeight(PayeeScript(LASTPAID_MASTERNODES), nTipHeight, LASTPAID_DEPTH), 0);
+
+    payments.Clear();
+    BOOST_CHECK_EQUAL(payments.GetLastPaidHeight(vPayees[1], nTipHeight, LASTPAID_DEPTH), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,322 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hash.h"
+#include "key.h"
+#include "masternode-budget.h"
+#include "masternode-payments.h"
+#include "masternode-sigqueue.h"
+#include "masternode.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "obfuscation.h"
+#include "random.h"
+#include "utiltime.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+#define REPLAY_MASTERNODES 100
+#define REPLAY_MESSAGES 2000
+
+using namespace std;
+
+struct CTestMasternode {
+    CTxIn vin;
+    CKey keyCollateral;
+    CKey keyMasternode;
+};
+
+static void Record(CDataStream& recording, const char* pszCommand, const CDataStream& payload)
+{
+    CMessageHeader hdr(pszCommand, payload.size());
+    uint256 hash = Hash(payload.begin(), payload.end());
+    memcpy(&hdr.nChecksum, &hash, sizeof(hdr.nChecksum));
+    recording << hdr;
+    recording.write(&payload[0], payload.size());
+}
+
+// split the recording into messages, as CNode::ReceiveMsgBytes does
+static void Replay(const CDataStream& recording, deque<CNetMessage>& vRecvMsg)
+{
+    const char* pch = &recording[0];
+    unsigned int nBytes = recording.size();
+    while (nBytes > 0) {
+        if (vRecvMsg.empty() || vRecvMsg.back().complete())
+            vRecvMsg.push_back(CNetMessage(SER_NETWORK, PROTOCOL_VERSION));
+        CNetMessage& msg = vRecvMsg.back();
+        int nHandled = msg.in_data ? msg.readData(pch, nBytes) : msg.readHeader(pch, nBytes);
+        BOOST_REQUIRE(nHandled > 0);
+        pch += nHandled;
+        nBytes -= nHandled;
+    }
+}
+
+static void Break(bool fBreak, vector<unsigned char>& vchSig)
+{
+    if (fBreak)
+        vchSig[10] ^= 1;
+}
+
+static bool Verify(const CPubKey& pubkey, vector<unsigned char>& vchSig, const string& strMessage)
+{
+    string errorMessage;
+    return obfuScationSigner.VerifyMessage(pubkey, vchSig, strMessage, errorMessage);
+}
+
+// the signature checks of the message handlers, one message after the other
+static vector<bool> Process(deque<CNetMessage>& vRecvMsg, map<COutPoint, CTestMasternode>& mapMasternodes)
+{
+    vector<bool> vValid;
+    BOOST_FOREACH (CNetMessage& msg, vRecvMsg) {
+        string strCommand = msg.hdr.GetCommand();
+        if (strCommand == "mnb") {
+            CMasternodeBroadcast mnb;
+            msg.vRecv >> mnb;
+            CTestMasternode& mn = mapMasternodes[mnb.vin.prevout];
+            vValid.push_back(Verify(mn.keyCollateral.GetPubKey(), mnb.sig, mnb.GetStrMessage()) &&
+                             Verify(mn.keyMasternode.GetPubKey(), mnb.lastPing.vchSig, mnb.lastPing.GetStrMessage()));
+        } else if (strCommand == "mnp") {
+            CMasternodePing mnp;
+            msg.vRecv >> mnp;
+            vValid.push_back(Verify(mapMasternodes[mnp.vin.prevout].keyMasternode.GetPubKey(), mnp.vchSig, mnp.GetStrMessage()));
+        } else if (strCommand == "mnw") {
+            CMasternodePaymentWinner winner;
+            msg.vRecv >> winner;
+            vValid.push_back(Verify(mapMasternodes[winner.vinMasternode.prevout].keyMasternode.GetPubKey(), winner.vchSig, winner.GetStrMessage()));
+        } else if (strCommand == "mvote") {
+            CBudgetVote vote;
+            msg.vRecv >> vote;
+            vValid.push_back(Verify(mapMasternodes[vote.vin.prevout].keyMasternode.GetPubKey(), vote.vchSig, vote.GetStrMessage()));
+        } else if (strCommand == "fbvote") {
+            CFinalizedBudgetVote vote;
+            msg.vRecv >> vote;
+            vValid.push_back(Verify(mapMasternodes[vote.vin.prevout].keyMasternode.GetPubKey(), vote.vchSig, vote.GetStrMessage()));
+        }
+    }
+    return vValid;
+}
+
+BOOST_AUTO_TEST_SUITE(masternode_sigqueue_tests)
+
+BOOST_AUTO_TEST_CASE(sigqueue_replay)
+{
+    map<COutPoint, CTestMasternode> mapMasternodes;
+    vector<CTestMasternode> vMasternodes;
+    for (int i = 0; i < REPLAY_MASTERNODES; i++) {
+        CTestMasternode mn;
+        mn.vin = CTxIn(COutPoint(GetRandHash(), 0));
+        mn.keyCollateral.MakeNewKey(true);
+        mn.keyMasternode.MakeNewKey(true);
+        mapMasternodes[mn.vin.prevout] = mn;
+        vMasternodes.push_back(mn);
+
+        // in the list, or only their broadcasts would be queued
+        CMasternode mnListed(CMasternodeBroadcast(CService("1.2.3.4", 8051), mn.vin, 1, mn.keyCollateral.GetPubKey(), mn.keyMasternode.GetPubKey(), PROTOCOL_VERSION));
+        BOOST_REQUIRE(mnodeman.Add(mnListed));
+    }
+
+    // record what a dseg reply and the sync after it look like: broadcasts,
+    // pings, winners and budget votes, with every tenth signature broken
+    CDataStream recording(SER_NETWORK, PROTOCOL_VERSION);
+    vector<bool> vExpected;
+    for (int i = 0; i < REPLAY_MESSAGES; i++) {
+        CTestMasternode& mn = vMasternodes[i % REPLAY_MASTERNODES];
+        CPubKey pubKeyMasternode = mn.keyMasternode.GetPubKey();
+        CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+        const char* pszCommand;
+        bool fBreak = i % 10 == 7;
+
+        CMasternodePing mnp;
+        mnp.vin = mn.vin;
+        mnp.blockHash = GetRandHash();
+        BOOST_REQUIRE(mnp.Sign(mn.keyMasternode, pubKeyMasternode));
+        switch (i % 5) {
+        case 0: {
+            CMasternodeBroadcast mnb(CService("1.2.3.4", 8051), mn.vin, 1, mn.keyCollateral.GetPubKey(), pubKeyMasternode, PROTOCOL_VERSION);
+            mnb.lastPing = mnp;
+            BOOST_REQUIRE(mnb.Sign(mn.keyCollateral));
+            Break(fBreak, mnb.sig);
+            payload << mnb;
+            pszCommand = "mnb";
+            break;
+        }
+        case 1:
+            Break(fBreak, mnp.vchSig);
+            payload << mnp;
+            pszCommand = "mnp";
+            break;
+        case 2: {
+            CMasternodePaymentWinner winner(mn.vin);
+            winner.nBlockHeight = 1000 + i;
+            winner.AddPayee(GetScriptForDestination(mn.keyCollateral.GetPubKey().GetID()));
+            BOOST_REQUIRE(winner.Sign(mn.keyMasternode, pubKeyMasternode));
+            Break(fBreak, winner.vchSig);
+            payload << winner;
+            pszCommand = "mnw";
+            break;
+        }
+        case 3: {
+            CBudgetVote vote(mn.vin, GetRandHash(), VOTE_YES);
+            BOOST_REQUIRE(vote.Sign(mn.keyMasternode, pubKeyMasternode));
+            Break(fBreak, vote.vchSig);
+            payload << vote;
+            pszCommand = "mvote";
+            break;
+        }
+        default: {
+            CFinalizedBudgetVote vote(mn.vin, GetRandHash());
+            BOOST_REQUIRE(vote.Sign(mn.keyMasternode, pubKeyMasternode));
+            Break(fBreak, vote.vchSig);
+            payload << vote;
+            pszCommand = "fbvote";
+            break;
+        }
+        }
+        Record(recording, pszCommand, payload);
+        vExpected.push_back(!fBreak);
+    }
+
+    // one message after the other on the message handler thread
+    deque<CNetMessage> vRecvMsg;
+    Replay(recording, vRecvMsg);
+    BOOST_REQUIRE_EQUAL(vRecvMsg.size(), REPLAY_MESSAGES);
+    BOOST_CHECK(!masternodeSigQueue.HasWorkers());
+    QueueMasternodeSignatures(vRecvMsg);
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 0);
+    int64_t nStart = GetTimeMicros();
+    vector<bool> vSerial = Process(vRecvMsg, mapMasternodes);
+    int64_t nSerial = GetTimeMicros() - nStart;
+    BOOST_CHECK(vSerial == vExpected);
+
+    // the same recording with the keys recovered on workers meanwhile
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++)
+        threads.create_thread(&ThreadMasternodeSigCheck);
+    while (!masternodeSigQueue.HasWorkers())
+        MilliSleep(1);
+    vRecvMsg.clear();
+    Replay(recording, vRecvMsg);
+    nStart = GetTimeMicros();
+    QueueMasternodeSignatures(vRecvMsg);
+    vector<bool> vQueued = Process(vRecvMsg, mapMasternodes);
+    int64_t nQueued = GetTimeMicros() - nStart;
+    BOOST_CHECK(vQueued == vExpected);
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 0);
+
+    BOOST_TEST_MESSAGE("replay of " << REPLAY_MESSAGES << " masternode messages: " << nSerial << "us serial, "
+                                    << nQueued << "us with 4 workers on " << boost::thread::hardware_concurrency() << " cores");
+
+    // messages looked at once are not queued again, the ones received later are
+    QueueMasternodeSignatures(vRecvMsg);
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 0);
+    vRecvMsg.erase(vRecvMsg.begin(), vRecvMsg.begin() + 10);
+    Replay(recording, vRecvMsg);
+    QueueMasternodeSignatures(vRecvMsg);
+    BOOST_CHECK(masternodeSigQueue.size() > 0);
+    vRecvMsg.erase(vRecvMsg.begin(), vRecvMsg.begin() + REPLAY_MESSAGES - 10);
+    BOOST_CHECK(Process(vRecvMsg, mapMasternodes) == vExpected);
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 0);
+
+    threads.interrupt_all();
+    threads.join_all();
+    BOOST_CHECK(!masternodeSigQueue.HasWorkers());
+    BOOST_FOREACH (const CTestMasternode& mn, vMasternodes)
+        mnodeman.Remove(mn.vin);
+}
+
+BOOST_AUTO_TEST_CASE(sigqueue_dropped)
+{
+    boost::thread_group threads;
+    for (int i = 0; i < 2; i++)
+        threads.create_thread(&ThreadMasternodeSigCheck);
+    while (!masternodeSigQueue.HasWorkers())
+        MilliSleep(1);
+
+    CKey keyCollateral, keyMasternode;
+    keyCollateral.MakeNewKey(true);
+    keyMasternode.MakeNewKey(true);
+    CPubKey pubKeyMasternode = keyMasternode.GetPubKey();
+    CTxIn vin(COutPoint(GetRandHash(), 0));
+
+    // messages of a masternode that is not in the list, and a broadcast seen
+    // before, are dropped by the handlers before the signature is checked
+    CDataStream recording(SER_NETWORK, PROTOCOL_VERSION);
+    CMasternodePing mnp;
+    mnp.vin = vin;
+    mnp.blockHash = GetRandHash();
+    BOOST_REQUIRE(mnp.Sign(keyMasternode, pubKeyMasternode));
+    CDataStream payloadPing(SER_NETWORK, PROTOCOL_VERSION);
+    payloadPing << mnp;
+    Record(recording, "mnp", payloadPing);
+
+    CMasternodeBroadcast mnb(CService("1.2.3.4", 8051), vin, 1, keyCollateral.GetPubKey(), pubKeyMasternode, PROTOCOL_VERSION);
+    mnb.lastPing = mnp;
+    BOOST_REQUIRE(mnb.Sign(keyCollateral));
+    CDataStream payloadBroadcast(SER_NETWORK, PROTOCOL_VERSION);
+    payloadBroadcast << mnb;
+    Record(recording, "mnb", payloadBroadcast);
+    mnodeman.mapSeenMasternodeBroadcast.insert(make_pair(mnb.GetHash(), mnb));
+
+    CMasternodePaymentWinner winner(vin);
+    winner.nBlockHeight = 1000;
+    winner.AddPayee(GetScriptForDestination(keyCollateral.GetPubKey().GetID()));
+    BOOST_REQUIRE(winner.Sign(keyMasternode, pubKeyMasternode));
+    CDataStream payloadWinner(SER_NETWORK, PROTOCOL_VERSION);
+    payloadWinner << winner;
+    Record(recording, "mnw", payloadWinner);
+
+    CBudgetVote vote(vin, GetRandHash(), VOTE_YES);
+    BOOST_REQUIRE(vote.Sign(keyMasternode, pubKeyMasternode));
+    CDataStream payloadVote(SER_NETWORK, PROTOCOL_VERSION);
+    payloadVote << vote;
+    Record(recording, "mvote", payloadVote);
+
+    CFinalizedBudgetVote fbvote(vin, GetRandHash());
+    BOOST_REQUIRE(fbvote.Sign(keyMasternode, pubKeyMasternode));
+    CDataStream payloadFinalizedVote(SER_NETWORK, PROTOCOL_VERSION);
+    payloadFinalizedVote << fbvote;
+    Record(recording, "fbvote", payloadFinalizedVote);
+
+    deque<CNetMessage> vRecvMsg;
+    for (int i = 0; i < 100; i++)
+        Replay(recording, vRecvMsg);
+    QueueMasternodeSignatures(vRecvMsg);
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 0);
+    mnodeman.mapSeenMasternodeBroadcast.erase(mnb.GetHash());
+
+    // the keys of messages dropped after they were queued are forgotten in time
+    int64_t nNow = GetTime();
+    SetMockTime(nNow);
+    vector<unsigned char> vchSig;
+    for (int i = 0; i < 100; i++) {
+        BOOST_REQUIRE(keyMasternode.SignCompact(GetRandHash(), vchSig));
+        masternodeSigQueue.Add(GetRandHash(), vchSig);
+    }
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 100);
+
+    SetMockTime(nNow + MASTERNODE_SIGS_QUEUE_TIMEOUT);
+    uint256 hashMessage = GetRandHash();
+    BOOST_REQUIRE(keyMasternode.SignCompact(hashMessage, vchSig));
+    // entries a worker is busy with are kept until it is done
+    for (int i = 0; i < 1000 && masternodeSigQueue.size() != 1; i++) {
+        masternodeSigQueue.Add(hashMessage, vchSig);
+        MilliSleep(1);
+    }
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 1);
+    CPubKey pubkey;
+    BOOST_CHECK(masternodeSigQueue.Recover(hashMessage, vchSig, pubkey));
+    BOOST_CHECK(pubkey == pubKeyMasternode);
+    BOOST_CHECK_EQUAL(masternodeSigQueue.size(), 0);
+    SetMockTime(0);
+
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,237 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "clientversion.h"
+#include "key.h"
+#include "main.h"
+#include "masternodeman.h"
+#include "random.h"
+#include "streams.h"
+#include "timedata.h"
+#include "utiltime.h"
+
+#define RANK_MASTERNODES 2000
+#define RANK_CHAIN_HEIGHT 200
+#define RANK_VOTES 20000
+#define FIND_MASTERNODES 2000
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(masternodeman_tests)
+
+namespace
+{
+    CMasternode MakeMasternode(int nProtocolVersion)
+    {
+        CMasternode mn;
+        mn.vin = CTxIn(COutPoint(GetRandHash(), 0));
+        mn.protocolVersion = nProtocolVersion;
+        mn.unitTest = true;
+        mn.activeState = CMasternode::MASTERNODE_ENABLED;
+        mn.sigTime = GetAdjustedTime() - 3 * MASTERNODE_REMOVAL_SECONDS;
+        mn.lastPing = CMasternodePing(mn.vin);
+        mn.lastPing.sigTime = GetAdjustedTime();
+        return mn;
+    }
+
+    // a chain of made up blocks, for masternode pings and scores
+    struct FakeChain {
+        vector<uint256> vHashes;
+        vector<CBlockIndex> vIndex;
+        CBlockIndex* pindexOldTip;
+
+        FakeChain(int nHeight) : vIndex(nHeight + 1)
+        {
+            for (int i = 0; i <= nHeight; i++)
+                vHashes.push_back(GetRandHash());
+            for (int i = 0; i <= nHeight; i++) {
+                vIndex[i].nHeight = i;
+                vIndex[i].phashBlock = &vHashes[i];
+                vIndex[i].pprev = i ? &vIndex[i - 1] : NULL;
+            }
+            pindexOldTip = chainActive.Tip();
+            chainActive.SetTip(&vIndex.back());
+            mapCacheBlockHashes.clear();
+        }
+
+        ~FakeChain()
+        {
+            chainActive.SetTip(pindexOldTip);
+            mapCacheBlockHashes.clear();
+        }
+    };
+
+    struct CompareScore {
+        bool operator()(const pair<int64_t, CTxIn>& t1, const pair<int64_t, CTxIn>& t2) const
+        {
+            return t1.first < t2.first;
+        }
+    };
+
+    // reference implementation: the sort GetMasternodeRank used to do per vote; masternodes
+    // with equal compact scores come out of it in any order, so any of their ranks is right
+    bool IsSortedRank(vector<CMasternode>& vMasternodes, const CTxIn& vin, int nBlockHeight, int minProtocol, int nRank)
+    {
+        vector<pair<int64_t, CTxIn> > vecScores;
+        BOOST_FOREACH (CMasternode& mn, vMasternodes) {
+            if (mn.protocolVersion < minProtocol) continue;
+            vecScores.push_back(make_pair(mn.CalculateScore(1, nBlockHeight).GetCompact(false), mn.vin));
+        }
+        sort(vecScores.rbegin(), vecScores.rend(), CompareScore());
+        for (unsigned int i = 0; i < vecScores.size(); i++) {
+            if (vecScores[i].second.prevout == vin.prevout)
+                return nRank >= 1 && nRank <= (int)vecScores.size() && vecScores[nRank - 1].first == vecScores[i].first;
+        }
+        return nRank == -1;
+    }
+
+    // reference implementation: the scan Find used to do
+    CMasternode* ScanFind(vector<CMasternode>& vMasternodes, const CTxIn& vin)
+    {
+        BOOST_FOREACH (CMasternode& mn, vMasternodes) {
+            if (mn.vin.prevout == vin.prevout)
+                return &mn;
+        }
+        return NULL;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ranking_snapshot)
+{
+    FakeChain chain(RANK_CHAIN_HEIGHT);
+
+    CMasternodeMan man;
+    for (int i = 0; i < RANK_MASTERNODES; i++) {
+        CMasternode mn = MakeMasternode(i % 10 ? PROTOCOL_VERSION : PROTOCOL_VERSION - 1);
+        BOOST_REQUIRE(man.Add(mn));
+    }
+    vector<CMasternode> vMasternodes = man.GetFullMasternodeVector();
+
+    // a vote storm: every masternode votes for a few blocks, several times over
+    vector<pair<int, CTxIn> > vVotes;
+    for (int i = 0; i < RANK_VOTES; i++)
+        vVotes.push_back(make_pair(RANK_CHAIN_HEIGHT - 100 + i % 4, vMasternodes[GetRandInt(RANK_MASTERNODES)].vin));
+
+    int64_t nStart = GetTimeMicros();
+    vector<int> vRanks;
+    BOOST_FOREACH (const PAIRTYPE(int, CTxIn) & vote, vVotes)
+        vRanks.push_back(man.GetMasternodeRank(vote.second, vote.first, PROTOCOL_VERSION));
+    int64_t nRanked = GetTimeMicros() - nStart;
+
+    // sorting per vote is too slow for the whole storm, check every 100th vote
+    nStart = GetTimeMicros();
+    for (unsigned int i = 0; i < vVotes.size(); i += 100)
+        BOOST_CHECK(IsSortedRank(vMasternodes, vVotes[i].second, vVotes[i].first, PROTOCOL_VERSION, vRanks[i]));
+    int64_t nSorted = (GetTimeMicros() - nStart) * 100;
+
+    BOOST_TEST_MESSAGE("rank lookups for " << RANK_VOTES << " votes over " << RANK_MASTERNODES << " masternodes: snapshot "
+                                           << nRanked << "us, sort per vote ~" << nSorted << "us");
+
+    // outdated masternodes are not ranked, ranks and masternodes by rank agree
+    int nHeight = RANK_CHAIN_HEIGHT - 100;
+    BOOST_CHECK_EQUAL(man.GetMasternodeRank(vMasternodes[0].vin, nHeight, PROTOCOL_VERSION), -1);
+    BOOST_CHECK(man.GetMasternodeRank(vMasternodes[0].vin, nHeight, PROTOCOL_VERSION - 1) > 0);
+    for (int nRank = 1; nRank <= 50; nRank++) {
+        CMasternode* pmn = man.GetMasternodeByRank(nRank, nHeight, PROTOCOL_VERSION);
+        BOOST_REQUIRE(pmn);
+        BOOST_CHECK_EQUAL(man.GetMasternodeRank(pmn->vin, nHeight, PROTOCOL_VERSION), nRank);
+    }
+    BOOST_CHECK(!man.GetMasternodeByRank(0, nHeight, PROTOCOL_VERSION));
+    BOOST_CHECK(!man.GetMasternodeByRank(RANK_MASTERNODES, nHeight, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(man.GetMasternodeRank(vMasternodes[1].vin, RANK_CHAIN_HEIGHT + 10, PROTOCOL_VERSION), -1);
+
+    // list changes show up right away
+    CMasternode* pmnFirst = man.GetMasternodeByRank(1, nHeight, PROTOCOL_VERSION);
+    CTxIn vinFirst = pmnFirst->vin;
+    CTxIn vinSecond = man.GetMasternodeByRank(2, nHeight, PROTOCOL_VERSION)->vin;
+    man.Remove(vinFirst);
+    BOOST_CHECK_EQUAL(man.GetMasternodeRank(vinFirst, nHeight, PROTOCOL_VERSION), -1);
+    BOOST_CHECK_EQUAL(man.GetMasternodeRank(vinSecond, nHeight, PROTOCOL_VERSION), 1);
+    CMasternode mnNew = MakeMasternode(PROTOCOL_VERSION);
+    BOOST_REQUIRE(man.Add(mnNew));
+    vMasternodes = man.GetFullMasternodeVector();
+    BOOST_CHECK(IsSortedRank(vMasternodes, mnNew.vin, nHeight, PROTOCOL_VERSION, man.GetMasternodeRank(mnNew.vin, nHeight, PROTOCOL_VERSION)));
+
+    man.Clear();
+    BOOST_CHECK_EQUAL(man.GetMasternodeRank(vinSecond, nHeight, PROTOCOL_VERSION), -1);
+}
+
+BOOST_AUTO_TEST_CASE(find_index)
+{
+    FakeChain chain(RANK_CHAIN_HEIGHT);
+
+    CMasternodeMan man;
+    for (int i = 0; i < FIND_MASTERNODES; i++) {
+        CMasternode mn = MakeMasternode(PROTOCOL_VERSION);
+        CKey key;
+        key.MakeNewKey(true);
+        mn.pubKeyCollateralAddress = key.GetPubKey();
+        key.MakeNewKey(true);
+        mn.pubKeyMasternode = key.GetPubKey();
+        BOOST_REQUIRE(man.Add(mn));
+    }
+    vector<CMasternode> vMasternodes = man.GetFullMasternodeVector();
+    BOOST_REQUIRE_EQUAL(vMasternodes.size(), FIND_MASTERNODES);
+
+    int64_t nStart = GetTimeMicros();
+    BOOST_FOREACH (const CMasternode& mn, vMasternodes) {
+        CMasternode* pmn = man.Find(mn.vin);
+        BOOST_REQUIRE(pmn);
+        BOOST_CHECK(pmn->vin == mn.vin);
+        BOOST_CHECK(man.Find(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID())) == pmn);
+        BOOST_CHECK(man.Find(mn.pubKeyMasternode) == pmn);
+    }
+    int64_t nIndexed = GetTimeMicros() - nStart;
+
+    nStart = GetTimeMicros();
+    BOOST_FOREACH (const CMasternode& mn, vMasternodes)
+        BOOST_CHECK(ScanFind(vMasternodes, mn.vin));
+    int64_t nScanned = GetTimeMicros() - nStart;
+
+    BOOST_TEST_MESSAGE("lookups of " << FIND_MASTERNODES << " masternodes by outpoint, payee and key: index "
+                                     << nIndexed << "us, scan by outpoint alone " << nScanned << "us");
+
+    CTxIn vinUnknown(COutPoint(GetRandHash(), 0));
+    BOOST_CHECK(!man.Find(vinUnknown));
+    BOOST_CHECK(!man.Find(CScript()));
+    BOOST_CHECK(!man.Find(CPubKey()));
+
+    // masternodes stay in place while others come and go
+    CMasternode* pmnKept = man.Find(vMasternodes[1].vin);
+    man.Remove(vMasternodes[0].vin);
+    BOOST_CHECK(!man.Find(vMasternodes[0].vin));
+    BOOST_CHECK(!man.Find(vMasternodes[0].pubKeyMasternode));
+    BOOST_CHECK(man.Find(vMasternodes[1].vin) == pmnKept);
+    CMasternode mnNew = MakeMasternode(PROTOCOL_VERSION);
+    BOOST_REQUIRE(man.Add(mnNew));
+    BOOST_CHECK(!man.Add(mnNew));
+    BOOST_CHECK(man.Find(mnNew.vin));
+    BOOST_CHECK(man.Find(vMasternodes[1].vin) == pmnKept);
+    BOOST_CHECK_EQUAL(man.size(), FIND_MASTERNODES);
+
+    // the cache is written in the format of a plain vector of masternodes
+    vMasternodes = man.GetFullMasternodeVector();
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << man;
+    CDataStream ssVector(SER_DISK, CLIENT_VERSION);
+    ssVector << vMasternodes;
+    BOOST_CHECK(ss.str().compare(0, ssVector.size(), ssVector.str()) == 0);
+
+    CMasternodeMan manRead;
+    ss >> manRead;
+    BOOST_CHECK_EQUAL(manRead.size(), FIND_MASTERNODES);
+    BOOST_FOREACH (const CMasternode& mn, vMasternodes) {
+        CMasternode* pmn = manRead.Find(mn.pubKeyMasternode);
+        BOOST_REQUIRE(pmn);
+        BOOST_CHECK(pmn->vin == mn.vin);
+        BOOST_CHECK(manRead.Find(mn.vin) == pmn);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
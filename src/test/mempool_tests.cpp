@@ -5,9 +5,12 @@
 #include "main.h"
 #include "txmempool.h"
 #include "util.h"
+#include "utiltime.h"
 
+#include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
 #include <list>
+#include <vector>
 
 BOOST_AUTO_TEST_SUITE(mempool_tests)
 
@@ -99,4 +102,201 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     removed.clear();
 }
 
+namespace
+{
+CMutableTransaction MakeTx(const uint256& hashPrev, unsigned int nOut, int nOutputs)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vin[0].prevout.hash = hashPrev;
+    tx.vin[0].prevout.n = nOut;
+    tx.vout.resize(nOutputs);
+    for (int i = 0; i < nOutputs; i++) {
+        tx.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[i].nValue = COIN;
+    }
+    return tx;
+}
+
+void CheckPackage(CTxMemPool& pool, const CTransaction& tx, uint64_t nAncestors, CAmount nAncestorFees, uint64_t nDescendants, CAmount nDescendantFees)
+{
+    CTxMemPool::txiter it = pool.mapTx.find(tx.GetHash());
+    BOOST_REQUIRE(it != pool.mapTx.end());
+    BOOST_CHECK_EQUAL(it->GetCountWithAncestors(), nAncestors);
+    BOOST_CHECK_EQUAL(it->GetModFeesWithAncestors(), nAncestorFees);
+    BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), nDescendants);
+    BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), nDescendantFees);
+}
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPackageStatsTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    pool.setSanityCheck(true);
+    LOCK(cs_main);
+    CCoinsViewCache view(pcoinsTip);
+    {
+        CCoinsModifier coins = view.ModifyCoins(uint256(1));
+        coins->vout.resize(1);
+        coins->vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        coins->vout[0].nValue = 10 * COIN;
+        coins->nHeight = 1;
+    }
+
+    // parent -> child -> grandchild, and a second child spending the parent
+    CMutableTransaction txParent = MakeTx(uint256(1), 0, 2);
+    CMutableTransaction txChild = MakeTx(txParent.GetHash(), 0, 1);
+    CMutableTransaction txGrandChild = MakeTx(txChild.GetHash(), 0, 1);
+    CMutableTransaction txChild2 = MakeTx(txParent.GetHash(), 1, 1);
+
+    std::list<CTransaction> removed;
+    pool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1));
+    pool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 2000, 0, 0.0, 1));
+    pool.addUnchecked(txGrandChild.GetHash(), CTxMemPoolEntry(txGrandChild, 4000, 0, 0.0, 1));
+    pool.addUnchecked(txChild2.GetHash(), CTxMemPoolEntry(txChild2, 8000, 0, 0.0, 1));
+    CheckPackage(pool, txParent, 1, 1000, 4, 15000);
+    CheckPackage(pool, txChild, 2, 3000, 2, 6000);
+    CheckPackage(pool, txGrandChild, 3, 7000, 1, 4000);
+    CheckPackage(pool, txChild2, 2, 9000, 1, 8000);
+    pool.check(&view);
+
+    // fee deltas count towards the packages
+    pool.PrioritiseTransaction(txChild.GetHash(), txChild.GetHash().ToString(), 0.0, 500);
+    CheckPackage(pool, txParent, 1, 1000, 4, 15500);
+    CheckPackage(pool, txGrandChild, 3, 7500, 1, 4000);
+    pool.check(&view);
+
+    // a block confirming the parent leaves two separate packages
+    pool.remove(txParent, removed, false);
+    CheckPackage(pool, txChild, 1, 2500, 2, 6500);
+    CheckPackage(pool, txGrandChild, 2, 6500, 1, 4000);
+    CheckPackage(pool, txChild2, 1, 8000, 1, 8000);
+
+    // a parent coming back from a disconnected block rejoins them
+    pool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1));
+    CheckPackage(pool, txParent, 1, 1000, 4, 15500);
+    CheckPackage(pool, txGrandChild, 3, 7500, 1, 4000);
+    pool.check(&view);
+
+    removed.clear();
+    pool.remove(txChild, removed, true);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    CheckPackage(pool, txParent, 1, 1000, 2, 9000);
+    pool.check(&view);
+    pool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+
+    // three unrelated transactions of the same size with different fees,
+    // and a high fee child of the cheapest one
+    std::vector<CMutableTransaction> vtx;
+    for (int i = 0; i < 3; i++)
+        vtx.push_back(MakeTx(uint256(i + 1), 0, 1));
+    CMutableTransaction txChild = MakeTx(vtx[0].GetHash(), 0, 1);
+    pool.addUnchecked(vtx[0].GetHash(), CTxMemPoolEntry(vtx[0], 1000, 3, 0.0, 1));
+    pool.addUnchecked(vtx[1].GetHash(), CTxMemPoolEntry(vtx[1], 2000, 2, 0.0, 1));
+    pool.addUnchecked(vtx[2].GetHash(), CTxMemPoolEntry(vtx[2], 3000, 1, 0.0, 1));
+    pool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 10000, 4, 0.0, 1));
+
+    // by own fee rate, highest first
+    std::vector<uint256> vOrder;
+    BOOST_FOREACH (const CTxMemPoolEntry& e, pool.mapTx.get<feerate_score>())
+        vOrder.push_back(e.GetTx().GetHash());
+    BOOST_CHECK(vOrder[0] == txChild.GetHash());
+    BOOST_CHECK(vOrder[1] == vtx[2].GetHash());
+    BOOST_CHECK(vOrder[3] == vtx[0].GetHash());
+
+    // eviction order: the cheap parent is worth keeping for its child, so vtx[1] goes first
+    vOrder.clear();
+    BOOST_FOREACH (const CTxMemPoolEntry& e, pool.mapTx.get<descendant_score>())
+        vOrder.push_back(e.GetTx().GetHash());
+    BOOST_CHECK(vOrder[0] == vtx[1].GetHash());
+    BOOST_CHECK(vOrder[1] == vtx[2].GetHash());
+
+    // mining order: the parent with its child beats everything else
+    vOrder.clear();
+    BOOST_FOREACH (const CTxMemPoolEntry& e, pool.mapTx.get<ancestor_score>())
+        vOrder.push_back(e.GetTx().GetHash());
+    BOOST_CHECK(vOrder[0] == txChild.GetHash());
+    BOOST_CHECK(vOrder[1] == vtx[2].GetHash());
+    BOOST_CHECK(vOrder[3] == vtx[0].GetHash());
+
+    // entry time, oldest first
+    vOrder.clear();
+    BOOST_FOREACH (const CTxMemPoolEntry& e, pool.mapTx.get<entry_time>())
+        vOrder.push_back(e.GetTx().GetHash());
+    BOOST_CHECK(vOrder[0] == vtx[2].GetHash());
+    BOOST_CHECK(vOrder[3] == txChild.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
+{
+    SetMockTime(42);
+    CTxMemPool pool(CFeeRate(1000));
+
+    CMutableTransaction tx1 = MakeTx(uint256(1), 0, 1);
+    CMutableTransaction tx2 = MakeTx(uint256(2), 0, 1);
+    CMutableTransaction tx3 = MakeTx(tx2.GetHash(), 0, 1);
+    CMutableTransaction tx4 = MakeTx(uint256(4), 0, 1);
+    unsigned int nTxSize = ::GetSerializeSize(tx1, SER_NETWORK, PROTOCOL_VERSION);
+
+    pool.addUnchecked(tx1.GetHash(), CTxMemPoolEntry(tx1, 10000, 10, 0.0, 1));
+    pool.addUnchecked(tx2.GetHash(), CTxMemPoolEntry(tx2, 5000, 20, 0.0, 1));
+    pool.addUnchecked(tx3.GetHash(), CTxMemPoolEntry(tx3, 20000, 30, 0.0, 1));
+    pool.addUnchecked(tx4.GetHash(), CTxMemPoolEntry(tx4, 1000, 40, 0.0, 1));
+    BOOST_CHECK_EQUAL(pool.GetTotalTxSize(), 4 * nTxSize);
+    BOOST_CHECK(pool.GetMinFee(4 * nTxSize) == CFeeRate(0));
+
+    // below the limit nothing happens
+    pool.TrimToSize(pool.GetTotalTxSize());
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+
+    // the cheapest package goes first, then tx1 as the tx2+tx3 package pays more
+    pool.TrimToSize(pool.GetTotalTxSize() - 1);
+    BOOST_CHECK_EQUAL(pool.size(), 3);
+    BOOST_CHECK(!pool.exists(tx4.GetHash()));
+    CFeeRate minFee(1000, nTxSize);
+    minFee += CFeeRate(1000);
+    BOOST_CHECK(pool.GetMinFee(4 * nTxSize) == minFee);
+
+    pool.TrimToSize(2 * nTxSize);
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+    BOOST_CHECK(pool.exists(tx2.GetHash()));
+    BOOST_CHECK(pool.exists(tx3.GetHash()));
+
+    // a whole package goes at once
+    pool.TrimToSize(nTxSize);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+    BOOST_CHECK_EQUAL(pool.GetTotalTxSize(), 0);
+    CFeeRate maxFee(25000, 2 * nTxSize);
+    maxFee += CFeeRate(1000);
+    BOOST_CHECK(pool.GetMinFee(4 * nTxSize) == maxFee);
+
+    // the minimum fee only decays after a block, faster in an empty pool
+    SetMockTime(42 + CTxMemPool::ROLLING_FEE_HALFLIFE);
+    BOOST_CHECK(pool.GetMinFee(4 * nTxSize) == maxFee);
+    std::vector<CTransaction> vtx;
+    std::list<CTransaction> conflicts;
+    pool.removeForBlock(vtx, 1, conflicts);
+    SetMockTime(42 + CTxMemPool::ROLLING_FEE_HALFLIFE + CTxMemPool::ROLLING_FEE_HALFLIFE / 4);
+    BOOST_CHECK_EQUAL(pool.GetMinFee(4 * nTxSize).GetFeePerK(), maxFee.GetFeePerK() / 2);
+    SetMockTime(42 + CTxMemPool::ROLLING_FEE_HALFLIFE + 10 * CTxMemPool::ROLLING_FEE_HALFLIFE);
+    BOOST_CHECK(pool.GetMinFee(4 * nTxSize) == CFeeRate(0));
+
+    // expiry takes old transactions and their descendants
+    pool.addUnchecked(tx1.GetHash(), CTxMemPoolEntry(tx1, 10000, 10, 0.0, 1));
+    pool.addUnchecked(tx2.GetHash(), CTxMemPoolEntry(tx2, 5000, 20, 0.0, 1));
+    pool.addUnchecked(tx3.GetHash(), CTxMemPoolEntry(tx3, 20000, 30, 0.0, 1));
+    BOOST_CHECK_EQUAL(pool.Expire(10), 0);
+    BOOST_CHECK_EQUAL(pool.Expire(11), 1);
+    BOOST_CHECK_EQUAL(pool.Expire(25), 2);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
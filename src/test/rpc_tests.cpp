@@ -181,4 +181,58 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_exec_class)
+{
+    BOOST_CHECK_EQUAL(tableRPC.GetExecClass("getrpcstats"), RPC_EXEC_READ);
+    BOOST_CHECK_EQUAL(tableRPC.GetExecClass("getnettotals"), RPC_EXEC_READ);
+    BOOST_CHECK_EQUAL(tableRPC.GetExecClass("getblock"), RPC_EXEC_CHAINSTATE);
+    BOOST_CHECK_EQUAL(tableRPC.GetExecClass("getmasternodewinners"), RPC_EXEC_CHAINSTATE);
+    BOOST_CHECK_EQUAL(tableRPC.GetExecClass("getaddednodeinfo"), RPC_EXEC_CHAINSTATE);
+#ifdef ENABLE_WALLET
+    BOOST_CHECK_EQUAL(tableRPC.GetExecClass("listtransactions"), RPC_EXEC_WALLET);
+#endif
+    BOOST_CHECK_EQUAL(tableRPC.GetExecClass("nosuchmethod"), RPC_EXEC_CHAINSTATE);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_method_stats)
+{
+    CRPCMethodStats stats;
+    stats.Add(0, false);
+    stats.Add(1, false);
+    stats.Add(3, true);
+    stats.Add(1000000000, false);
+    BOOST_CHECK_EQUAL(stats.nCalls, 4U);
+    BOOST_CHECK_EQUAL(stats.nErrors, 1U);
+    BOOST_CHECK_EQUAL(stats.nTimeTotal, 1000000004);
+    BOOST_CHECK_EQUAL(stats.nTimeMax, 1000000000);
+    BOOST_CHECK_EQUAL(stats.vHistogram[0], 1U);
+    BOOST_CHECK_EQUAL(stats.vHistogram[1], 1U);
+    BOOST_CHECK_EQUAL(stats.vHistogram[2], 1U);
+    BOOST_CHECK_EQUAL(stats.vHistogram[CRPCMethodStats::HISTOGRAM_BUCKETS - 1], 1U);
+
+    // calls through the table are counted, failed ones as errors
+    uint64_t nCalls = GetRPCMethodStats()["getrpcstats"].nCalls;
+    uint64_t nErrors = GetRPCMethodStats()["getrpcstats"].nErrors;
+    UniValue params(UniValue::VARR);
+    params.push_back("getrpcstats");
+    tableRPC.execute("getrpcstats", params);
+    params.push_back("toomany");
+    BOOST_CHECK_THROW(tableRPC.execute("getrpcstats", params), UniValue);
+    BOOST_CHECK_EQUAL(GetRPCMethodStats()["getrpcstats"].nCalls, nCalls + 2);
+    BOOST_CHECK_EQUAL(GetRPCMethodStats()["getrpcstats"].nErrors, nErrors + 1);
+
+    UniValue result = CallRPC("getrpcstats getrpcstats");
+    BOOST_CHECK(find_value(result, "queues").isArray());
+    const UniValue& methods = find_value(result, "methods");
+    BOOST_CHECK_EQUAL(methods.size(), 1U);
+    const UniValue& method = find_value(methods, "getrpcstats");
+    BOOST_CHECK_EQUAL(find_value(method, "class").get_str(), "read");
+    BOOST_CHECK_EQUAL(find_value(method, "calls").get_int64(), (int64_t)nCalls + 2);
+    int64_t nCounted = 0;
+    const UniValue& histogram = find_value(method, "histogram");
+    for (unsigned int i = 0; i < histogram.size(); i++)
+        nCounted += find_value(histogram[i], "count").get_int64();
+    BOOST_CHECK_EQUAL(nCounted, (int64_t)nCalls + 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,254 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netbase.h"
+#include "socketevents.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#ifndef WIN32
+#include <arpa/inet.h>
+#endif
+
+using namespace std;
+
+// The stress test keeps 2 descriptors per connection open
+#define STRESS_CONNECTIONS 2000
+
+namespace
+{
+/** Loopback listener handing out connected (client, server) socket pairs */
+class CLoopback
+{
+public:
+    SOCKET hListen;
+    struct sockaddr_in addr;
+
+    CLoopback()
+    {
+        hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        BOOST_REQUIRE(hListen != INVALID_SOCKET);
+        BOOST_REQUIRE(bind(hListen, (struct sockaddr*)&addr, sizeof(addr)) != SOCKET_ERROR);
+        BOOST_REQUIRE(listen(hListen, SOMAXCONN) != SOCKET_ERROR);
+        BOOST_REQUIRE(getsockname(hListen, (struct sockaddr*)&addr, &len) != SOCKET_ERROR);
+    }
+
+    ~CLoopback()
+    {
+        CloseSocket(hListen);
+    }
+
+    bool Connect(SOCKET& hClient, SOCKET& hServer)
+    {
+        hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (hClient == INVALID_SOCKET)
+            return false;
+        if (connect(hClient, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+            CloseSocket(hClient);
+            return false;
+        }
+        hServer = accept(hListen, NULL, NULL);
+        if (hServer == INVALID_SOCKET) {
+            CloseSocket(hClient);
+            return false;
+        }
+        SetSocketNonBlocking(hServer, true);
+        return true;
+    }
+};
+
+/** Wait until nExpected sockets were reported ready or a second passed */
+map<SOCKET, int> WaitReady(CSocketEvents& events, size_t nExpected)
+{
+    map<SOCKET, int> mapReady;
+    int64_t nEnd = GetTimeMillis() + 1000;
+    do {
+        vector<pair<SOCKET, int> > vReady;
+        BOOST_CHECK(events.Wait(100, vReady));
+        for (size_t i = 0; i < vReady.size(); i++)
+            mapReady[vReady[i].first] |= vReady[i].second;
+    } while (mapReady.size() < nExpected && GetTimeMillis() < nEnd);
+    return mapReady;
+}
+
+void CheckEvents(SocketEventsMode mode)
+{
+    CLoopback loopback;
+    SOCKET hClient, hServer;
+    BOOST_REQUIRE(loopback.Connect(hClient, hServer));
+
+    CSocketEvents events(mode);
+    BOOST_CHECK_EQUAL(events.GetMode(), mode);
+    BOOST_CHECK(events.Set(hServer, 1, SOCKET_EVENT_RECV));
+    events.RemoveStale();
+    BOOST_CHECK_EQUAL(events.size(), 1U);
+
+    // nothing to read yet
+    vector<pair<SOCKET, int> > vReady;
+    BOOST_CHECK(events.Wait(10, vReady));
+    BOOST_CHECK(vReady.empty());
+
+    char ch = 'x';
+    BOOST_CHECK_EQUAL(send(hClient, &ch, 1, 0), 1);
+    map<SOCKET, int> mapReady = WaitReady(events, 1);
+    BOOST_CHECK_EQUAL(mapReady.size(), 1U);
+    BOOST_CHECK(mapReady[hServer] & SOCKET_EVENT_RECV);
+
+    // data stays readable until received, but is not reported once unwanted
+    BOOST_CHECK(events.Set(hServer, 1, 0));
+    BOOST_CHECK(events.Wait(10, vReady));
+    BOOST_CHECK(vReady.empty());
+
+    BOOST_CHECK(events.Set(hServer, 1, SOCKET_EVENT_SEND));
+    mapReady = WaitReady(events, 1);
+    BOOST_CHECK(mapReady[hServer] & SOCKET_EVENT_SEND);
+    BOOST_CHECK(!(mapReady[hServer] & SOCKET_EVENT_RECV));
+
+    // a new socket, possibly with the descriptor of the closed one, is tracked afresh
+    events.RemoveStale();
+    CloseSocket(hServer);
+    CloseSocket(hClient);
+    BOOST_REQUIRE(loopback.Connect(hClient, hServer));
+    BOOST_CHECK(events.Set(hServer, 2, SOCKET_EVENT_RECV));
+    events.RemoveStale();
+    BOOST_CHECK_EQUAL(events.size(), 1U);
+    BOOST_CHECK_EQUAL(send(hClient, &ch, 1, 0), 1);
+    mapReady = WaitReady(events, 1);
+    BOOST_CHECK_EQUAL(mapReady.size(), 1U);
+    BOOST_CHECK(mapReady[hServer] & SOCKET_EVENT_RECV);
+
+    // sockets not Set since the last sweep are dropped
+    events.RemoveStale();
+    BOOST_CHECK_EQUAL(events.size(), 0U);
+    BOOST_CHECK(events.Wait(10, vReady));
+    BOOST_CHECK(vReady.empty());
+
+    CloseSocket(hServer);
+    CloseSocket(hClient);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(socketevents_tests)
+
+BOOST_AUTO_TEST_CASE(socketevents_modes)
+{
+    SocketEventsMode mode;
+    BOOST_CHECK(ParseSocketEventsMode("select", mode));
+    BOOST_CHECK_EQUAL(mode, SOCKETEVENTS_SELECT);
+    BOOST_CHECK(!ParseSocketEventsMode("kqueue", mode));
+    BOOST_CHECK(ParseSocketEventsMode(DEFAULT_SOCKETEVENTS, mode));
+    BOOST_CHECK_EQUAL(GetSocketEventsModeName(mode), DEFAULT_SOCKETEVENTS);
+#ifdef USE_EPOLL
+    BOOST_CHECK(ParseSocketEventsMode("epoll", mode));
+    BOOST_CHECK_EQUAL(mode, SOCKETEVENTS_EPOLL);
+    BOOST_CHECK(CSocketEvents::IsTrackable(SOCKETEVENTS_EPOLL, FD_SETSIZE));
+#endif
+#ifndef WIN32
+    BOOST_CHECK(!CSocketEvents::IsTrackable(SOCKETEVENTS_SELECT, FD_SETSIZE));
+#endif
+    BOOST_CHECK(!CSocketEvents::IsTrackable(SOCKETEVENTS_SELECT, INVALID_SOCKET));
+}
+
+BOOST_AUTO_TEST_CASE(socketevents_select)
+{
+    CheckEvents(SOCKETEVENTS_SELECT);
+}
+
+#ifdef USE_EPOLL
+BOOST_AUTO_TEST_CASE(socketevents_epoll)
+{
+    CheckEvents(SOCKETEVENTS_EPOLL);
+}
+
+BOOST_AUTO_TEST_CASE(socketevents_epoll_stress)
+{
+    int nConnections = std::min(STRESS_CONNECTIONS, (RaiseFileDescriptorLimit(2 * STRESS_CONNECTIONS + 100) - 100) / 2);
+    CLoopback loopback;
+    vector<SOCKET> vClients, vServers;
+    for (int i = 0; i < nConnections; i++) {
+        SOCKET hClient, hServer;
+        if (!loopback.Connect(hClient, hServer))
+            break;
+        vClients.push_back(hClient);
+        vServers.push_back(hServer);
+    }
+    BOOST_TEST_MESSAGE("socketevents stress: " << vServers.size() << " loopback connections");
+    BOOST_CHECK(vServers.size() > 500);
+
+    CSocketEvents events(SOCKETEVENTS_EPOLL);
+    CSocketEvents eventsSelect(SOCKETEVENTS_SELECT);
+    bool fBeyondSelect = false;
+    for (size_t i = 0; i < vServers.size(); i++) {
+        BOOST_CHECK(events.Set(vServers[i], i, SOCKET_EVENT_RECV));
+        if (!IsSelectableSocket(vServers[i])) {
+            BOOST_CHECK(!eventsSelect.Set(vServers[i], i, SOCKET_EVENT_RECV));
+            fBeyondSelect = true;
+        }
+    }
+    events.RemoveStale();
+    BOOST_CHECK_EQUAL(events.size(), vServers.size());
+    if (vServers.size() >= FD_SETSIZE)
+        BOOST_CHECK(fBeyondSelect);
+
+    // an idle wakeup costs nothing per tracked socket
+    vector<pair<SOCKET, int> > vReady;
+    int64_t nStart = GetTimeMicros();
+    BOOST_CHECK(events.Wait(0, vReady));
+    int64_t nIdleWait = GetTimeMicros() - nStart;
+    BOOST_CHECK(vReady.empty());
+
+    // every third peer sends something
+    set<SOCKET> setSent;
+    char ch = 'x';
+    for (size_t i = 0; i < vClients.size(); i += 3) {
+        BOOST_CHECK_EQUAL(send(vClients[i], &ch, 1, 0), 1);
+        setSent.insert(vServers[i]);
+    }
+    nStart = GetTimeMicros();
+    map<SOCKET, int> mapReady = WaitReady(events, setSent.size());
+    int64_t nReadyWait = GetTimeMicros() - nStart;
+    BOOST_CHECK_EQUAL(mapReady.size(), setSent.size());
+    BOOST_FOREACH (const PAIRTYPE(SOCKET, int)& item, mapReady) {
+        BOOST_CHECK(setSent.count(item.first));
+        BOOST_CHECK(item.second & SOCKET_EVENT_RECV);
+    }
+    BOOST_TEST_MESSAGE("socketevents stress: idle wait " << nIdleWait << "us, " << setSent.size() << " ready in " << nReadyWait << "us");
+
+    // receiving drains the readiness; updating an unchanged interest is free
+    BOOST_FOREACH (SOCKET hSocket, setSent)
+        BOOST_CHECK_EQUAL(recv(hSocket, &ch, 1, 0), 1);
+    for (size_t i = 0; i < vServers.size(); i++)
+        BOOST_CHECK(events.Set(vServers[i], i, SOCKET_EVENT_RECV));
+    events.RemoveStale();
+    BOOST_CHECK(events.Wait(0, vReady));
+    BOOST_CHECK(vReady.empty());
+
+    // peers hanging up are reported as readable
+    for (size_t i = 0; i < 10 && i < vClients.size(); i++)
+        CloseSocket(vClients[i]);
+    mapReady = WaitReady(events, 10);
+    BOOST_CHECK_EQUAL(mapReady.size(), 10U);
+
+    for (size_t i = 0; i < vClients.size(); i++) {
+        if (vClients[i] != INVALID_SOCKET)
+            CloseSocket(vClients[i]);
+        CloseSocket(vServers[i]);
+    }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -21,6 +21,8 @@
 
 using namespace std;
 
+extern CWallet* pwalletMain;
+
 typedef set<pair<const CWalletTx*,unsigned int> > CoinSet;
 
 BOOST_AUTO_TEST_SUITE(wallet_tests)
@@ -305,4 +307,113 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(utxo_index_buckets)
+{
+    CWalletUTXOIndex index;
+    uint256 hashA = uint256S("0a"), hashB = uint256S("0b");
+    CTxOut out(1 * COIN, CScript() << OP_TRUE);
+    CTxOut mint(10 * COIN, CScript() << OP_ZEROCOINMINT);
+
+    index.Add(COutPoint(hashB, 1), out);
+    index.Add(COutPoint(hashA, 0), out);
+    index.Add(COutPoint(hashB, 0), mint);
+    index.Add(COutPoint(hashA, 0), out); // already there
+    BOOST_CHECK_EQUAL(index.size(), 3U);
+    BOOST_CHECK_EQUAL(index.size(CWalletUTXOIndex::UTXO_STAKABLE), 2U);
+    BOOST_CHECK_EQUAL(index.size(CWalletUTXOIndex::UTXO_ZEROCOIN), 1U);
+
+    // results come in outpoint order, like a scan of mapWallet
+    vector<COutPoint> vOutpoints;
+    index.GetAll(vOutpoints);
+    BOOST_REQUIRE_EQUAL(vOutpoints.size(), 3U);
+    BOOST_CHECK(vOutpoints[0] == COutPoint(hashA, 0));
+    BOOST_CHECK(vOutpoints[1] == COutPoint(hashB, 0));
+    BOOST_CHECK(vOutpoints[2] == COutPoint(hashB, 1));
+
+    index.Get(CWalletUTXOIndex::UTXO_STAKABLE, vOutpoints);
+    BOOST_REQUIRE_EQUAL(vOutpoints.size(), 2U);
+    BOOST_CHECK(vOutpoints[0] == COutPoint(hashA, 0));
+    BOOST_CHECK(vOutpoints[1] == COutPoint(hashB, 1));
+
+    vector<CAmount> vAmounts;
+    vAmounts.push_back(10 * COIN);
+    vAmounts.push_back(1 * COIN);
+    vAmounts.push_back(5 * COIN);
+    index.GetByAmounts(vAmounts, vOutpoints);
+    BOOST_CHECK_EQUAL(vOutpoints.size(), 3U);
+    vAmounts.resize(1);
+    index.GetByAmounts(vAmounts, vOutpoints);
+    BOOST_REQUIRE_EQUAL(vOutpoints.size(), 1U);
+    BOOST_CHECK(vOutpoints[0] == COutPoint(hashB, 0));
+
+    // an output changing value moves to its new amount
+    index.Add(COutPoint(hashB, 0), CTxOut(5 * COIN, CScript() << OP_TRUE));
+    index.GetByAmounts(vAmounts, vOutpoints);
+    BOOST_CHECK(vOutpoints.empty());
+    BOOST_CHECK_EQUAL(index.size(CWalletUTXOIndex::UTXO_ZEROCOIN), 0U);
+
+    BOOST_CHECK(index.Remove(COutPoint(hashA, 0)));
+    BOOST_CHECK(!index.Remove(COutPoint(hashA, 0)));
+    BOOST_CHECK(!index.Contains(COutPoint(hashA, 0)));
+    BOOST_CHECK_EQUAL(index.size(CWalletUTXOIndex::UTXO_STAKABLE), 2U);
+    index.clear();
+    BOOST_CHECK_EQUAL(index.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(utxo_index_wallet)
+{
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    const CWalletUTXOIndex& index = pwalletMain->GetUTXOIndex();
+
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_REQUIRE(pwalletMain->AddKey(key));
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+
+    CMutableTransaction tx;
+    tx.vout.push_back(CTxOut(3 * COIN, scriptMine));
+    tx.vout.push_back(CTxOut(1 * COIN, GetScriptForDestination(keyOther.GetPubKey().GetID())));
+    tx.vout.push_back(CTxOut(2 * COIN, scriptMine));
+    CWalletTx wtx(pwalletMain, tx);
+    BOOST_CHECK(pwalletMain->AddToWallet(wtx));
+    uint256 hash = wtx.GetHash();
+
+    // only our own outputs are indexed
+    BOOST_CHECK(index.Contains(COutPoint(hash, 0)));
+    BOOST_CHECK(!index.Contains(COutPoint(hash, 1)));
+    BOOST_CHECK(index.Contains(COutPoint(hash, 2)));
+
+    // and AvailableCoins finds them through the index
+    vector<COutput> vAvailable;
+    pwalletMain->AvailableCoins(vAvailable, false);
+    set<pair<uint256, int> > setAvailable;
+    BOOST_FOREACH (const COutput& out, vAvailable)
+        setAvailable.insert(make_pair(out.tx->GetHash(), out.i));
+    BOOST_CHECK(setAvailable.count(make_pair(hash, 0)));
+    BOOST_CHECK(!setAvailable.count(make_pair(hash, 1)));
+    BOOST_CHECK(setAvailable.count(make_pair(hash, 2)));
+
+    // a spend that is not in the chain may still be abandoned, so the output stays indexed
+    CMutableTransaction txSpend;
+    txSpend.vin.push_back(CTxIn(COutPoint(hash, 0)));
+    txSpend.vout.push_back(CTxOut(3 * COIN, GetScriptForDestination(keyOther.GetPubKey().GetID())));
+    CWalletTx wtxSpend(pwalletMain, txSpend);
+    BOOST_CHECK(pwalletMain->AddToWallet(wtxSpend));
+    BOOST_CHECK(index.Contains(COutPoint(hash, 0)));
+    BOOST_CHECK(!index.Contains(COutPoint(wtxSpend.GetHash(), 0)));
+
+    // rebuilding from mapWallet gives the same index
+    size_t nSize = index.size();
+    pwalletMain->RebuildUTXOIndex();
+    BOOST_CHECK_EQUAL(index.size(), nSize);
+    BOOST_CHECK(index.Contains(COutPoint(hash, 2)));
+
+    pwalletMain->EraseFromWallet(wtxSpend.GetHash());
+    pwalletMain->EraseFromWallet(hash);
+    BOOST_CHECK(!index.Contains(COutPoint(hash, 0)));
+    BOOST_CHECK(!index.Contains(COutPoint(hash, 2)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "random.h"
+#include "util.h"
+#include "utiltime.h"
+#include "wallet/wallet.h"
+#include "wallet/walletdb.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#define BATCH_TXS 2000
+#define BATCH_KEYS 200
+
+using namespace std;
+
+static CWalletTx MakeWalletTx(int n)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(GetRandHash(), n);
+    tx.vout.resize(2);
+    tx.vout[0].nValue = n;
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    tx.vout[1].nValue = COIN;
+    tx.vout[1].scriptPubKey = CScript() << OP_TRUE;
+    return CWalletTx(NULL, tx);
+}
+
+static void ReadPoolInThread(const string& strFile, int64_t nPool, bool* pfFound)
+{
+    CKeyPool keypool;
+    *pfFound = CWalletDB(strFile).ReadPool(nPool, keypool);
+}
+
+BOOST_AUTO_TEST_SUITE(walletbatch_tests)
+
+BOOST_AUTO_TEST_CASE(batch_records)
+{
+    const string strFile = "walletbatch.dat";
+    {
+        CWalletDB walletdb(strFile, "cr+");
+    }
+
+    vector<CWalletTx> vTx;
+    for (int i = 0; i < 2 * BATCH_TXS; i++)
+        vTx.push_back(MakeWalletTx(i));
+
+    // a rescan as it wrote its transactions: a commit and a checkpoint for each
+    int64_t nStart = GetTimeMicros();
+    for (int i = 0; i < BATCH_TXS; i++)
+        BOOST_REQUIRE(CWalletDB(strFile).WriteTx(vTx[i].GetHash(), vTx[i]));
+    int64_t nSingle = GetTimeMicros() - nStart;
+
+    // the same in a batch, committed every -walletbatchsize records
+    mapArgs["-walletbatchsize"] = "500";
+    nStart = GetTimeMicros();
+    {
+        CDBBatch batch(strFile);
+        for (int i = BATCH_TXS; i < 2 * BATCH_TXS; i++)
+            BOOST_REQUIRE(CWalletDB(strFile).WriteTx(vTx[i].GetHash(), vTx[i]));
+
+        // the thread sees what it wrote before the commit, nested transactions join the batch
+        CWalletDB walletdb(strFile);
+        BOOST_CHECK(walletdb.WritePool(1, CKeyPool()));
+        CKeyPool keypool;
+        BOOST_CHECK(walletdb.ReadPool(1, keypool));
+        BOOST_REQUIRE(walletdb.TxnBegin());
+        BOOST_CHECK(walletdb.WritePool(2, CKeyPool()));
+        BOOST_CHECK(walletdb.TxnAbort());
+        BOOST_REQUIRE(walletdb.TxnBegin());
+        BOOST_CHECK(walletdb.WritePool(3, CKeyPool()));
+        BOOST_CHECK(walletdb.TxnCommit());
+        BOOST_CHECK(walletdb.ReadPool(3, keypool));
+
+        // a commit waits for the handles on the file to be closed
+        BOOST_CHECK(!batch.Commit());
+        walletdb.Close();
+        BOOST_CHECK(batch.Commit());
+    }
+    int64_t nBatched = GetTimeMicros() - nStart;
+    mapArgs.erase("-walletbatchsize");
+
+    BOOST_TEST_MESSAGE(BATCH_TXS << " wallet transactions: " << nSingle << "us one by one, " << nBatched << "us batched");
+
+    // all of it is committed, and other threads are not held up by the batch any more
+    bool fFound = false;
+    boost::thread thread(boost::bind(&ReadPoolInThread, strFile, 3, &fFound));
+    BOOST_REQUIRE(thread.timed_join(boost::posix_time::seconds(10)));
+    BOOST_CHECK(fFound);
+
+    CWallet wallet(strFile);
+    vector<uint256> vTxHash;
+    vector<CWalletTx> vWtx;
+    BOOST_CHECK_EQUAL(CWalletDB(strFile).FindWalletTx(&wallet, vTxHash, vWtx), DB_LOAD_OK);
+    set<uint256> setTxHash(vTxHash.begin(), vTxHash.end());
+    BOOST_FOREACH (const CWalletTx& wtx, vTx)
+        BOOST_CHECK(setTxHash.count(wtx.GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(batch_keypool)
+{
+    const string strFile = "walletbatch_keypool.dat";
+    {
+        CWalletDB walletdb(strFile, "cr+");
+    }
+    CWallet wallet(strFile);
+    LOCK(wallet.cs_wallet);
+
+    // the refill as it was: the key and pool records committed one by one
+    int64_t nStart = GetTimeMicros();
+    {
+        CWalletDB walletdb(strFile);
+        for (int i = 0; i < BATCH_KEYS; i++)
+            BOOST_REQUIRE(walletdb.WritePool(BATCH_KEYS + 1 + i, CKeyPool(wallet.GenerateNewKey())));
+    }
+    int64_t nSingle = GetTimeMicros() - nStart;
+
+    nStart = GetTimeMicros();
+    BOOST_REQUIRE(wallet.TopUpKeyPool(BATCH_KEYS - 1));
+    int64_t nBatched = GetTimeMicros() - nStart;
+    BOOST_TEST_MESSAGE(BATCH_KEYS << " key pool keys: " << nSingle << "us one by one, " << nBatched << "us batched");
+
+    BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), BATCH_KEYS);
+    CWalletDB walletdb(strFile);
+    BOOST_FOREACH (int64_t nIndex, wallet.setKeyPool) {
+        CKeyPool keypool;
+        BOOST_REQUIRE(walletdb.ReadPool(nIndex, keypool));
+        BOOST_CHECK(wallet.HaveKey(keypool.vchPubKey.GetID()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batch_commit_failed)
+{
+    const string strFile = "walletbatch_commit.dat";
+    {
+        CWalletDB walletdb(strFile, "cr+");
+    }
+    CWallet wallet(strFile);
+    CWalletTx wtxCoin = MakeWalletTx(0);
+    {
+        LOCK(wallet.cs_wallet);
+        BOOST_REQUIRE(wallet.AddToWallet(wtxCoin));
+    }
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(wtxCoin.GetHash(), 1);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = COIN / 2;
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    CWalletTx wtxNew(&wallet, tx);
+    CReserveKey reservekey(&wallet);
+
+    // a handle left open on the file makes the commit of the transaction fail
+    {
+        CDBBatch batch(strFile);
+        CWalletDB walletdb(strFile);
+        BOOST_CHECK(!wallet.CommitTransaction(wtxNew, reservekey));
+    }
+
+    // and the wallet neither keeps it to resend nor its coin as spent
+    LOCK(wallet.cs_wallet);
+    BOOST_CHECK(!wallet.mapWallet.count(wtxNew.GetHash()));
+    BOOST_CHECK(!wallet.IsSpent(wtxCoin.GetHash(), 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
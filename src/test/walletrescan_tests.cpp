@@ -0,0 +1,250 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "main.h"
+#include "random.h"
+#include "util.h"
+#include "utiltime.h"
+#include "wallet/wallet.h"
+#include "wallet/walletrescan.h"
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#define RESCAN_BLOCKS 400
+#define RESCAN_BLOCK_TXS 50
+
+using namespace std;
+
+// block files far beyond anything the test chain writes
+static const int TEST_RESCAN_BLOCK_FILE = 9500;
+
+namespace
+{
+    CScript RandomScript()
+    {
+        uint256 hash = GetRandHash();
+        return GetScriptForDestination(CKeyID(uint160(vector<unsigned char>(hash.begin(), hash.begin() + 20))));
+    }
+
+    CMutableTransaction MakeTx(const COutPoint& prevout, const CScript& scriptPubKey)
+    {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        // a signature, and no public key the filter could know the spend by
+        tx.vin[0].scriptSig = CScript() << vector<unsigned char>(72, 0x30);
+        tx.vout.resize(2);
+        tx.vout[0].nValue = COIN;
+        tx.vout[0].scriptPubKey = scriptPubKey;
+        tx.vout[1].nValue = 2 * COIN;
+        tx.vout[1].scriptPubKey = RandomScript();
+        return tx;
+    }
+
+    // a chain of proof-of-stake blocks full of payments to others, written to a block file of its own
+    struct RescanChain {
+        vector<CBlock> vBlocks;
+        vector<uint256> vHashes;
+        vector<CBlockIndex> vIndex;
+        CBlockIndex* pindexOldTip;
+
+        RescanChain() : vBlocks(RESCAN_BLOCKS), vHashes(RESCAN_BLOCKS), vIndex(RESCAN_BLOCKS), pindexOldTip(chainActive.Tip())
+        {
+            for (int i = 0; i < RESCAN_BLOCKS; i++) {
+                CBlock& block = vBlocks[i];
+                block.nTime = Params().GenesisBlock().nTime + i * 60;
+                CMutableTransaction coinbase;
+                coinbase.vin.resize(1);
+                coinbase.vin[0].scriptSig = CScript() << i << OP_0;
+                coinbase.vout.resize(1);
+                block.vtx.push_back(coinbase);
+                CMutableTransaction coinstake = MakeTx(COutPoint(GetRandHash(), 0), RandomScript());
+                coinstake.vout.insert(coinstake.vout.begin(), CTxOut());
+                coinstake.vout[0].SetEmpty();
+                block.vtx.push_back(coinstake);
+                for (int j = 0; j < RESCAN_BLOCK_TXS; j++)
+                    block.vtx.push_back(MakeTx(COutPoint(GetRandHash(), j), RandomScript()));
+            }
+        }
+
+        // write the blocks out and make them the active chain
+        void Connect()
+        {
+            CDiskBlockPos pos(TEST_RESCAN_BLOCK_FILE, 0);
+            for (int i = 0; i < RESCAN_BLOCKS; i++) {
+                CBlock& block = vBlocks[i];
+                block.hashMerkleRoot = block.BuildMerkleTree();
+                BOOST_REQUIRE(WriteBlockToDisk(block, pos));
+                vHashes[i] = block.GetHash();
+                vIndex[i].nHeight = i;
+                vIndex[i].nTime = block.nTime;
+                vIndex[i].phashBlock = &vHashes[i];
+                vIndex[i].pprev = i ? &vIndex[i - 1] : NULL;
+                vIndex[i].nFile = pos.nFile;
+                vIndex[i].nDataPos = pos.nPos;
+                vIndex[i].nStatus = BLOCK_HAVE_DATA;
+                pos.nPos += ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            }
+            chainActive.SetTip(&vIndex.back());
+        }
+
+        ~RescanChain()
+        {
+            chainActive.SetTip(pindexOldTip);
+            blockFileMap.Clear();
+        }
+    };
+
+    // reference implementation: the serial scan ScanForWalletTransactions used to do
+    int ScanSerial(CWallet& wallet, CBlockIndex* pindex)
+    {
+        int ret = 0;
+        LOCK2(cs_main, wallet.cs_wallet);
+        CDBBatch batch(wallet.strWalletFile);
+        for (; pindex; pindex = chainActive.Next(pindex)) {
+            CBlock block;
+            ReadBlockFromDisk(block, pindex);
+            BOOST_FOREACH (CTransaction& tx, block.vtx) {
+                if (wallet.AddToWalletIfInvolvingMe(tx, &block, true))
+                    ret++;
+            }
+        }
+        return ret;
+    }
+
+    set<uint256> WalletTxs(CWallet& wallet)
+    {
+        LOCK(wallet.cs_wallet);
+        set<uint256> setHashes;
+        for (map<uint256, CWalletTx>::const_iterator it = wallet.mapWallet.begin(); it != wallet.mapWallet.end(); ++it)
+            setHashes.insert(it->first);
+        return setHashes;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(walletrescan_tests)
+
+BOOST_AUTO_TEST_CASE(rescan_pipeline)
+{
+    RescanChain chain;
+
+    CKey key, keyP2PK;
+    key.MakeNewKey(true);
+    keyP2PK.MakeNewKey(true);
+    CScript scriptP2PKH = GetScriptForDestination(key.GetPubKey().GetID());
+    CScript scriptP2PK = CScript() << ToByteVector(keyP2PK.GetPubKey()) << OP_CHECKSIG;
+
+    // a transaction the wallet knows already, not in any block
+    CMutableTransaction txKnown = MakeTx(COutPoint(GetRandHash(), 0), scriptP2PKH);
+    vector<uint256> vExpected(1, txKnown.GetHash());
+
+    // payments to the wallet, by key hash and by public key
+    CMutableTransaction txP2PKH = MakeTx(COutPoint(GetRandHash(), 0), scriptP2PKH);
+    chain.vBlocks[50].vtx[10] = txP2PKH;
+    CMutableTransaction txP2PK = MakeTx(COutPoint(GetRandHash(), 0), scriptP2PK);
+    chain.vBlocks[100].vtx[20] = txP2PK;
+    // a spend the filter cannot see, of an output the rescan found earlier
+    CMutableTransaction txSpendFound = MakeTx(COutPoint(txP2PK.GetHash(), 0), RandomScript());
+    chain.vBlocks[200].vtx[5] = txSpendFound;
+    // the same within one block
+    CMutableTransaction txPayInBlock = MakeTx(COutPoint(GetRandHash(), 0), scriptP2PK);
+    CMutableTransaction txSpendInBlock = MakeTx(COutPoint(txPayInBlock.GetHash(), 0), RandomScript());
+    chain.vBlocks[300].vtx[30] = txPayInBlock;
+    chain.vBlocks[300].vtx[31] = txSpendInBlock;
+    // a spend of an output of the known transaction
+    CMutableTransaction txSpendKnown = MakeTx(COutPoint(txKnown.GetHash(), 0), RandomScript());
+    chain.vBlocks[350].vtx[40] = txSpendKnown;
+    vExpected.push_back(txP2PKH.GetHash());
+    vExpected.push_back(txP2PK.GetHash());
+    vExpected.push_back(txSpendFound.GetHash());
+    vExpected.push_back(txPayInBlock.GetHash());
+    vExpected.push_back(txSpendInBlock.GetHash());
+    vExpected.push_back(txSpendKnown.GetHash());
+    chain.Connect();
+
+    CWalletDB("walletrescan_serial.dat", "cr+");
+    CWalletDB("walletrescan_pipeline.dat", "cr+");
+    CWallet walletSerial("walletrescan_serial.dat");
+    CWallet walletPipeline("walletrescan_pipeline.dat");
+    CWallet* vWallets[] = {&walletSerial, &walletPipeline};
+    BOOST_FOREACH (CWallet* pwallet, vWallets) {
+        LOCK(pwallet->cs_wallet);
+        // both wallets hold the same keys, as if loaded from a backup
+        BOOST_REQUIRE(pwallet->LoadKey(key, key.GetPubKey()));
+        BOOST_REQUIRE(pwallet->LoadKey(keyP2PK, keyP2PK.GetPubKey()));
+        for (int i = 0; i < 100; i++)
+            pwallet->GenerateNewKey();
+        pwallet->nTimeFirstKey = 1; // as after an import, the whole chain is scanned
+        BOOST_REQUIRE(pwallet->AddToWallet(CWalletTx(pwallet, txKnown)));
+    }
+
+    int64_t nStart = GetTimeMicros();
+    int nSerial = ScanSerial(walletSerial, chainActive.Genesis());
+    int64_t nTimeSerial = GetTimeMicros() - nStart;
+
+    mapArgs["-rescanthreads"] = "2";
+    nStart = GetTimeMicros();
+    int nPipeline = walletPipeline.ScanForWalletTransactions(chainActive.Genesis(), true);
+    int64_t nTimePipeline = GetTimeMicros() - nStart;
+    mapArgs.erase("-rescanthreads");
+
+    BOOST_TEST_MESSAGE("rescan of " << RESCAN_BLOCKS << " blocks of " << RESCAN_BLOCK_TXS + 2 << " transactions: serial "
+                                    << nTimeSerial << "us, pipelined " << nTimePipeline << "us");
+
+    // the same transactions found either way
+    BOOST_CHECK_EQUAL(nPipeline, nSerial);
+    set<uint256> setSerial = WalletTxs(walletSerial);
+    set<uint256> setPipeline = WalletTxs(walletPipeline);
+    BOOST_CHECK(setSerial == setPipeline);
+    BOOST_CHECK_EQUAL(setPipeline.size(), vExpected.size());
+    BOOST_FOREACH (const uint256& hash, vExpected)
+        BOOST_CHECK(setPipeline.count(hash));
+    {
+        LOCK(walletPipeline.cs_wallet);
+        BOOST_CHECK(walletPipeline.mapWallet[txSpendInBlock.GetHash()].hashBlock == chain.vHashes[300]);
+    }
+
+    // a rescan from the middle only reads what follows
+    CBloomFilter filter;
+    {
+        LOCK(walletPipeline.cs_wallet);
+        filter = walletPipeline.GetRescanFilter();
+    }
+    CWalletRescanPipeline pipeline(vector<CBlockIndex*>(1, &chain.vIndex[100]), filter, 1);
+    CRescanBlockRef item;
+    BOOST_REQUIRE(pipeline.Next(item));
+    BOOST_CHECK(item->fRead);
+    BOOST_CHECK(item->block.GetHash() == chain.vHashes[100]);
+    BOOST_CHECK(item->vMatch[20]);
+    BOOST_CHECK(!pipeline.Next(item));
+}
+
+BOOST_AUTO_TEST_CASE(rescan_filter)
+{
+    CWalletDB("walletrescan_filter.dat", "cr+");
+    CWallet wallet("walletrescan_filter.dat");
+    LOCK(wallet.cs_wallet);
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_REQUIRE(wallet.AddKeyPubKey(key, key.GetPubKey()));
+    CScript scriptMultisig = GetScriptForMultisig(1, vector<CPubKey>(1, key.GetPubKey()));
+    BOOST_REQUIRE(wallet.AddCScript(scriptMultisig));
+
+    CBloomFilter filter = wallet.GetRescanFilter();
+    BOOST_CHECK(filter.IsRelevantAndUpdate(MakeTx(COutPoint(GetRandHash(), 0), GetScriptForDestination(key.GetPubKey().GetID()))));
+    BOOST_CHECK(filter.IsRelevantAndUpdate(MakeTx(COutPoint(GetRandHash(), 0), GetScriptForDestination(CScriptID(scriptMultisig)))));
+    BOOST_CHECK(!filter.IsRelevantAndUpdate(MakeTx(COutPoint(GetRandHash(), 0), RandomScript())));
+
+    // a watched script without data in it to look for lets every transaction through
+    BOOST_REQUIRE(wallet.AddWatchOnly(CScript() << OP_TRUE));
+    BOOST_CHECK(wallet.GetRescanFilter().IsRelevantAndUpdate(MakeTx(COutPoint(GetRandHash(), 0), RandomScript())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
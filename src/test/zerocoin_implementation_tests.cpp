@@ -349,4 +349,273 @@ BOOST_AUTO_TEST_CASE(checksum_tests)
 }
 
 
+BOOST_AUTO_TEST_CASE(pubcoin_index_test)
+{
+    cout << "Running pubcoin_index_test...\n";
+
+    CZerocoinDB db(1 << 20, true);
+    ZerocoinParams* params = Params().Zerocoin_Params();
+
+    //a few mints of two denominations around height byte boundaries
+    std::vector<int> vHeights {1, 255, 256, 257, 511, 65535, 65536, 300000};
+    std::map<int, std::list<PublicCoin> > mapBlocks;
+    for (int nHeight : vHeights) {
+        std::list<PublicCoin> listPubcoins;
+        listPubcoins.emplace_back(PublicCoin(params, CBigNum(nHeight * 10 + 1), CoinDenomination::ZQ_ONE));
+        listPubcoins.emplace_back(PublicCoin(params, CBigNum(nHeight * 10 + 2), CoinDenomination::ZQ_ONE));
+        if (nHeight % 2)
+            listPubcoins.emplace_back(PublicCoin(params, CBigNum(nHeight * 10 + 3), CoinDenomination::ZQ_FIVE));
+        BOOST_CHECK(db.WriteBlockPubcoins(nHeight, uint256(nHeight), listPubcoins));
+        mapBlocks[nHeight] = listPubcoins;
+    }
+
+    //ranges come back in height order and stop at the end of the range and the denomination
+    std::map<int, CBlockPubcoins> mapPubcoins;
+    BOOST_CHECK(db.ReadPubcoinRange(CoinDenomination::ZQ_ONE, 255, 65536, mapPubcoins));
+    BOOST_CHECK_EQUAL(mapPubcoins.size(), 5);
+    BOOST_CHECK_EQUAL(mapPubcoins.begin()->first, 255);
+    BOOST_CHECK_EQUAL(mapPubcoins.rbegin()->first, 65535);
+    for (const auto& entry : mapPubcoins) {
+        BOOST_CHECK(entry.second.hashBlock == uint256(entry.first));
+        BOOST_CHECK_EQUAL(entry.second.vPubcoins.size(), 2);
+        BOOST_CHECK(entry.second.vPubcoins[1] == CBigNum(entry.first * 10 + 2));
+    }
+
+    mapPubcoins.clear();
+    BOOST_CHECK(db.ReadPubcoinRange(CoinDenomination::ZQ_FIVE, 0, 1000000, mapPubcoins));
+    BOOST_CHECK_EQUAL(mapPubcoins.size(), 5);
+    mapPubcoins.clear();
+    BOOST_CHECK(db.ReadPubcoinRange(CoinDenomination::ZQ_TEN, 0, 1000000, mapPubcoins));
+    BOOST_CHECK(mapPubcoins.empty());
+
+    std::map<int, uint256> mapIndexed;
+    BOOST_CHECK(db.ReadIndexedBlocks(0, 1000000, mapIndexed));
+    BOOST_CHECK_EQUAL(mapIndexed.size(), vHeights.size());
+
+    //another block at the same height replaces the entries, disconnecting erases them
+    std::list<PublicCoin> listReplaced;
+    listReplaced.emplace_back(PublicCoin(params, CBigNum(7), CoinDenomination::ZQ_TEN));
+    BOOST_CHECK(db.WriteBlockPubcoins(257, uint256(7), listReplaced));
+    mapPubcoins.clear();
+    BOOST_CHECK(db.ReadPubcoinRange(CoinDenomination::ZQ_ONE, 257, 258, mapPubcoins));
+    BOOST_CHECK(mapPubcoins.empty());
+    BOOST_CHECK(db.ReadPubcoinRange(CoinDenomination::ZQ_TEN, 257, 258, mapPubcoins));
+    BOOST_CHECK_EQUAL(mapPubcoins.size(), 1);
+
+    BOOST_CHECK(db.EraseBlockPubcoins(256));
+    mapIndexed.clear();
+    BOOST_CHECK(db.ReadIndexedBlocks(255, 258, mapIndexed));
+    BOOST_CHECK_EQUAL(mapIndexed.size(), 2);
+    BOOST_CHECK(!mapIndexed.count(256));
+    BOOST_CHECK(mapIndexed[257] == uint256(7));
+}
+
+BOOST_AUTO_TEST_CASE(pubcoin_index_verifydb_test)
+{
+    cout << "Running pubcoin_index_verifydb_test...\n";
+
+    SelectParams(CBaseChainParams::UNITTEST);
+    LOCK(cs_main);
+    ModifiableParams()->setSkipProofOfWorkCheck(true);
+    CBlockIndex* pindexGenesis = chainActive.Tip();
+    uint256 hashBestCoins = pcoinsTip->GetBestBlock();
+
+    //a block on top of genesis with its data and undo data on disk, so VerifyDB can disconnect it
+    CMutableTransaction txCoinbase;
+    txCoinbase.vin.resize(1);
+    txCoinbase.vin[0].prevout.SetNull();
+    txCoinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    txCoinbase.vout.resize(1);
+    txCoinbase.vout[0].nValue = 1 * COIN;
+    txCoinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    CBlock block;
+    block.nVersion = 1;
+    block.hashPrevBlock = pindexGenesis->GetBlockHash();
+    block.nTime = pindexGenesis->nTime + 60;
+    block.nBits = pindexGenesis->nBits;
+    block.vtx.push_back(CTransaction(txCoinbase));
+    block.hashMerkleRoot = block.BuildMerkleTree();
+
+    CDiskBlockPos blockPos(99, 0);
+    BOOST_CHECK(WriteBlockToDisk(block, blockPos));
+    CDiskBlockPos undoPos(99, 0);
+    CBlockUndo blockundo;
+    BOOST_CHECK(blockundo.WriteToDisk(undoPos, pindexGenesis->GetBlockHash()));
+
+    CBlockIndex* pindex = new CBlockIndex(block);
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(block.GetHash(), pindex)).first;
+    pindex->phashBlock = &mi->first;
+    pindex->pprev = pindexGenesis;
+    pindex->nHeight = 1;
+    pindex->nFile = 99;
+    pindex->nDataPos = blockPos.nPos;
+    pindex->nUndoPos = undoPos.nPos;
+    pindex->nStatus |= BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO;
+    chainActive.SetTip(pindex);
+    *pcoinsTip->ModifyCoins(block.vtx[0].GetHash()) = CCoins(block.vtx[0], 1);
+    pcoinsTip->SetBestBlock(block.GetHash());
+
+    std::list<PublicCoin> listPubcoins;
+    listPubcoins.emplace_back(PublicCoin(Params().Zerocoin_Params(), CBigNum(11), CoinDenomination::ZQ_ONE));
+    BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(1, block.GetHash(), listPubcoins));
+
+    //the startup check disconnects the tip in memory only, the index must not lose the block
+    fVerifyingBlocks = true;
+    BOOST_CHECK(CVerifyDB().VerifyDB(pcoinsTip, 3, 1));
+    fVerifyingBlocks = false;
+
+    std::map<int, uint256> mapIndexed;
+    BOOST_CHECK(zerocoinDB->ReadIndexedBlocks(1, 2, mapIndexed));
+    BOOST_CHECK_EQUAL(mapIndexed.size(), 1);
+    BOOST_CHECK(mapIndexed[1] == block.GetHash());
+
+    BOOST_CHECK(zerocoinDB->EraseBlockPubcoins(1));
+    pcoinsTip->ModifyCoins(block.vtx[0].GetHash())->Clear();
+    pcoinsTip->SetBestBlock(hashBestCoins);
+    chainActive.SetTip(pindexGenesis);
+    mapBlockIndex.erase(mi);
+    delete pindex;
+    ModifiableParams()->setSkipProofOfWorkCheck(false);
+}
+
+//the checkpoint of the blocks in [10k, 10k + 10) has checksum k + 1 for the last denomination
+static uint256 TestCheckpoint(int nHeight)
+{
+    return uint256(nHeight / 10 + 1);
+}
+
+static CBlockIndex* AddTestBlock(const uint256& hash, std::vector<CBlockIndex*>& vIndex)
+{
+    CBlockIndex* pindex = new CBlockIndex();
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindex)).first;
+    pindex->phashBlock = &mi->first;
+    pindex->pprev = chainActive.Tip();
+    pindex->nHeight = chainActive.Height() + 1;
+    pindex->nAccumulatorCheckpoint = TestCheckpoint(pindex->nHeight);
+    chainActive.SetTip(pindex);
+    vIndex.push_back(pindex);
+    return pindex;
+}
+
+//a block with one pubcoin of the denomination in the pubcoin index
+static void AddTestPubcoinBlock(CoinDenomination denom, std::vector<CBlockIndex*>& vIndex, std::map<int, std::list<PublicCoin> >& mapPubcoins)
+{
+    CBlockIndex* pindex = AddTestBlock(GetRandHash(), vIndex);
+    std::list<PublicCoin>& listPubcoins = mapPubcoins[pindex->nHeight];
+    listPubcoins.clear();
+    listPubcoins.emplace_back(PublicCoin(Params().Zerocoin_Params(), CBigNum(GetRandHash()), denom));
+    BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(pindex->nHeight, pindex->GetBlockHash(), listPubcoins));
+}
+
+static bool GenerateTestWitness(const PublicCoin& coin, CBigNum& bnWitness, int& nMintsAdded, CMintWitness* pMintWitness)
+{
+    Accumulator accumulator(Params().Zerocoin_Params(), coin.getDenomination());
+    AccumulatorWitness witness(Params().Zerocoin_Params(), accumulator, coin);
+    std::string strError;
+    if (!GenerateAccumulatorWitness(coin, accumulator, witness, 100, nMintsAdded, strError, pMintWitness))
+        return false;
+    bnWitness = witness.getValue();
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(accumulator_witness_resume_test)
+{
+    cout << "Running accumulator_witness_resume_test...\n";
+
+    SelectParams(CBaseChainParams::UNITTEST);
+    LOCK(cs_main);
+    CBlockIndex* pindexGenesis = chainActive.Tip();
+    CoinDenomination denom = zerocoinDenomList.back();
+    std::vector<CBlockIndex*> vIndex;
+    std::map<int, std::list<PublicCoin> > mapPubcoins;
+
+    //the accumulator values of all checkpoints the chain below gets
+    for (uint32_t nChecksum = 1; nChecksum <= 40; nChecksum++)
+        BOOST_CHECK(zerocoinDB->WriteAccumulatorValue(nChecksum, CBigNum(GetRandHash())));
+
+    while (chainActive.Height() < 299)
+        AddTestBlock(GetRandHash(), vIndex);
+
+    //the mint at height 300, in a block on disk that the transaction index points to
+    CMutableTransaction txMint;
+    txMint.vout.resize(1);
+    txMint.vout[0].nValue = 1 * COIN;
+    txMint.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    CBlock block;
+    block.hashPrevBlock = chainActive.Tip()->GetBlockHash();
+    block.vtx.push_back(CTransaction(txMint));
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    CDiskBlockPos blockPos(98, 0);
+    BOOST_CHECK(WriteBlockToDisk(block, blockPos));
+    CBlockIndex* pindexMint = AddTestBlock(block.GetHash(), vIndex);
+    pindexMint->nFile = blockPos.nFile;
+    pindexMint->nDataPos = blockPos.nPos;
+    pindexMint->nStatus |= BLOCK_HAVE_DATA;
+    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+    vPos.push_back(std::make_pair(block.vtx[0].GetHash(), CDiskTxPos(blockPos, GetSizeOfCompactSize(block.vtx.size()))));
+    BOOST_CHECK(pblocktree->WriteTxIndex(vPos));
+    fTxIndex = true;
+
+    PublicCoin coin(Params().Zerocoin_Params(), CBigNum(GetRandHash()), denom);
+    BOOST_CHECK(zerocoinDB->WriteCoinMint(coin, block.vtx[0].GetHash()));
+    mapPubcoins[300].emplace_back(coin);
+    BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(300, block.GetHash(), mapPubcoins[300]));
+
+    //a first spend keeps the witness up to two checkpoints below the tip
+    while (chainActive.Height() < 350)
+        AddTestPubcoinBlock(denom, vIndex, mapPubcoins);
+    CMintWitness mintWitness;
+    CBigNum bnWitness;
+    int nMintsAdded = 0;
+    BOOST_CHECK(GenerateTestWitness(coin, bnWitness, nMintsAdded, &mintWitness));
+    BOOST_CHECK_EQUAL(mintWitness.nHeightAccStart, 300);
+    BOOST_CHECK_EQUAL(mintWitness.nHeightAccEnd, 330);
+    BOOST_CHECK(mintWitness.hashBlockAccEnd == chainActive[329]->GetBlockHash());
+    CMintWitness mintWitnessFirst = mintWitness;
+
+    //the next spend resumes from it and ends up where one from scratch does
+    while (chainActive.Height() < 370)
+        AddTestPubcoinBlock(denom, vIndex, mapPubcoins);
+    CBigNum bnWitnessFresh, bnWitnessResumed;
+    int nMintsFresh = 0, nMintsResumed = 0;
+    BOOST_CHECK(GenerateTestWitness(coin, bnWitnessFresh, nMintsFresh, NULL));
+    BOOST_CHECK(GenerateTestWitness(coin, bnWitnessResumed, nMintsResumed, &mintWitness));
+    BOOST_CHECK(bnWitnessResumed == bnWitnessFresh);
+    BOOST_CHECK_EQUAL(nMintsResumed, nMintsFresh);
+    BOOST_CHECK_EQUAL(mintWitness.nHeightAccEnd, 350);
+
+    //without reading the pubcoins the kept witness covers
+    for (int nHeight = 300; nHeight < 330; nHeight++)
+        BOOST_CHECK(zerocoinDB->EraseBlockPubcoins(nHeight));
+    mintWitness = mintWitnessFirst;
+    BOOST_CHECK(GenerateTestWitness(coin, bnWitnessResumed, nMintsResumed, &mintWitness));
+    BOOST_CHECK(bnWitnessResumed == bnWitnessFresh);
+    BOOST_CHECK_EQUAL(nMintsResumed, nMintsFresh);
+    for (int nHeight = 300; nHeight < 330; nHeight++)
+        BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(nHeight, chainActive[nHeight]->GetBlockHash(), mapPubcoins[nHeight]));
+
+    //a reorg below the end of the kept witness invalidates it
+    chainActive.SetTip(chainActive[344]);
+    while (chainActive.Height() < 370)
+        AddTestPubcoinBlock(denom, vIndex, mapPubcoins);
+    BOOST_CHECK(GenerateTestWitness(coin, bnWitnessFresh, nMintsFresh, NULL));
+    BOOST_CHECK(GenerateTestWitness(coin, bnWitnessResumed, nMintsResumed, &mintWitness));
+    BOOST_CHECK(bnWitnessResumed == bnWitnessFresh);
+    BOOST_CHECK_EQUAL(nMintsResumed, nMintsFresh);
+    BOOST_CHECK_EQUAL(mintWitness.nHeightAccEnd, 350);
+    BOOST_CHECK(mintWitness.hashBlockAccEnd == chainActive[349]->GetBlockHash());
+
+    fTxIndex = false;
+    for (int nHeight = 300; nHeight <= 370; nHeight++)
+        BOOST_CHECK(zerocoinDB->EraseBlockPubcoins(nHeight));
+    BOOST_CHECK(zerocoinDB->EraseCoinMint(coin.getValue()));
+    for (uint32_t nChecksum = 1; nChecksum <= 40; nChecksum++)
+        BOOST_CHECK(zerocoinDB->EraseAccumulatorValue(nChecksum));
+    chainActive.SetTip(pindexGenesis);
+    for (CBlockIndex* pindex : vIndex) {
+        mapBlockIndex.erase(pindex->GetBlockHash());
+        delete pindex;
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "libzerocoin/Denominations.h"
+#include "random.h"
+#include "utiltime.h"
+#include "wallet/walletdb.h"
+#include "zpara/zparatracker.h"
+
+#include <boost/test/unit_test.hpp>
+
+#define TRACKER_MINTS 1000
+#define TRACKER_SPENT 100
+
+using namespace std;
+
+// what CWalletDB::ListMintedCoins(true, false, false) used to do for every balance query
+static list<CZerocoinMint> ListUnusedFromDB(const string& strFile)
+{
+    CWalletDB walletdb(strFile);
+    list<CZerocoinMint> listMints;
+    for (const CZerocoinMint& mint : walletdb.ListMintedCoins()) {
+        if (!mint.IsUsed() && !walletdb.ReadZerocoinSpendSerialEntry(mint.GetSerialNumber()))
+            listMints.push_back(mint);
+    }
+    return listMints;
+}
+
+BOOST_AUTO_TEST_SUITE(zparatracker_tests)
+
+BOOST_AUTO_TEST_CASE(tracker_list_mints)
+{
+    const string strFile = "zparatracker.dat";
+    {
+        CWalletDB walletdb(strFile, "cr+");
+    }
+
+    CzparaTracker tracker(strFile);
+    tracker.Init();
+    BOOST_CHECK_EQUAL(tracker.size(), 0);
+
+    vector<CZerocoinMint> vMints;
+    for (int i = 0; i < TRACKER_MINTS; i++) {
+        CZerocoinMint mint(libzerocoin::zerocoinDenomList[i % libzerocoin::zerocoinDenomList.size()],
+                           CBigNum(GetRandHash()), CBigNum(GetRandHash()), CBigNum(GetRandHash()), false, 1);
+        mint.SetTxHash(GetRandHash());
+        BOOST_REQUIRE(tracker.Add(mint));
+        vMints.push_back(mint);
+    }
+    for (int i = 0; i < TRACKER_SPENT; i++) {
+        const CZerocoinMint& mint = vMints[i * (TRACKER_MINTS / TRACKER_SPENT)];
+        BOOST_REQUIRE(tracker.AddSpend(CZerocoinSpend(mint.GetSerialNumber(), GetRandHash(), mint.GetValue(), mint.GetDenomination(), 0)));
+    }
+    BOOST_CHECK_EQUAL(tracker.size(), TRACKER_MINTS);
+    BOOST_CHECK(tracker.HasSpend(vMints[0].GetSerialNumber()));
+    BOOST_CHECK(!tracker.HasUnusedSerial(vMints[0].GetSerialNumber()));
+    BOOST_CHECK(tracker.HasUnusedSerial(vMints[1].GetSerialNumber()));
+    BOOST_CHECK(!tracker.HasUnusedSerial(CBigNum(GetRandHash())));
+
+    int64_t nStart = GetTimeMicros();
+    list<CZerocoinMint> listDB = ListUnusedFromDB(strFile);
+    int64_t nDB = GetTimeMicros() - nStart;
+    // the first listing writes the used flags of the spent mints back, time the ones after it
+    list<CZerocoinMint> listTracker = tracker.ListMints(true, false, false);
+    nStart = GetTimeMicros();
+    BOOST_CHECK_EQUAL(tracker.ListMints(true, false, false).size(), listTracker.size());
+    int64_t nTracker = GetTimeMicros() - nStart;
+    BOOST_TEST_MESSAGE("unused mints out of " << TRACKER_MINTS << ": " << nDB << "us with a cursor scan, "
+                                              << nTracker << "us from memory");
+
+    BOOST_CHECK_EQUAL(listDB.size(), TRACKER_MINTS - TRACKER_SPENT);
+    BOOST_CHECK_EQUAL(listTracker.size(), listDB.size());
+    set<uint256> setDB;
+    for (const CZerocoinMint& mint : listDB)
+        setDB.insert(GetPubCoinHash(mint.GetValue()));
+    for (const CZerocoinMint& mint : listTracker)
+        BOOST_CHECK(setDB.count(GetPubCoinHash(mint.GetValue())));
+
+    // the spent mints were marked used and written back, so a reload agrees
+    CzparaTracker trackerReloaded(strFile);
+    trackerReloaded.Init();
+    BOOST_CHECK_EQUAL(trackerReloaded.size(), TRACKER_MINTS);
+    BOOST_CHECK_EQUAL(trackerReloaded.ListMints(false, false, false).size(), TRACKER_MINTS);
+    int nUsed = 0;
+    for (const CZerocoinMint& mint : CWalletDB(strFile).ListMintedCoins())
+        nUsed += mint.IsUsed();
+    BOOST_CHECK_EQUAL(nUsed, TRACKER_SPENT);
+
+    // erasing and archiving drop the mint from memory and from the database
+    BOOST_REQUIRE(tracker.Erase(vMints[1]));
+    BOOST_REQUIRE(tracker.Archive(vMints[2]));
+    BOOST_CHECK(!tracker.HasUnusedSerial(vMints[1].GetSerialNumber()));
+    BOOST_CHECK_EQUAL(tracker.size(), TRACKER_MINTS - 2);
+    BOOST_CHECK_EQUAL(CWalletDB(strFile).ListMintedCoins().size(), TRACKER_MINTS - 2);
+    BOOST_REQUIRE(tracker.Unarchive(vMints[2]));
+    BOOST_CHECK(tracker.HasUnusedSerial(vMints[2].GetSerialNumber()));
+    BOOST_CHECK_EQUAL(tracker.size(), TRACKER_MINTS - 1);
+
+    BOOST_REQUIRE(tracker.EraseSpend(vMints[0].GetSerialNumber()));
+    BOOST_CHECK(!tracker.HasSpend(vMints[0].GetSerialNumber()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -231,8 +231,12 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                 CDiskBlockIndex diskindex;
                 ssValue >> diskindex;
 
+                // the key holds the block hash: rehashing every header with XEVAN would dominate startup
+                uint256 hashBlock;
+                ssKey >> hashBlock;
+
                 // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = InsertBlockIndex(hashBlock);
                 pindexNew->pprev = InsertBlockIndex(diskindex.hashPrev);
                 pindexNew->pnext = InsertBlockIndex(diskindex.hashNext);
                 pindexNew->nHeight = diskindex.nHeight;
@@ -365,3 +369,61 @@ bool CZerocoinDB::EraseAccumulatorValue(const uint32_t& nChecksum)
     LogPrint("zero", "%s : checksum:%d\n", __func__, nChecksum);
     return Erase(make_pair('a', nChecksum));
 }
+
+bool CZerocoinDB::WriteBlockPubcoins(int nHeight, const uint256& hashBlock, const std::list<PublicCoin>& listPubcoins)
+{
+    std::map<CoinDenomination, CBlockPubcoins> mapDenoms;
+    for (const PublicCoin& pubcoin : listPubcoins) {
+        CBlockPubcoins& entry = mapDenoms[pubcoin.getDenomination()];
+        entry.hashBlock = hashBlock;
+        entry.vPubcoins.push_back(pubcoin.getValue());
+    }
+
+    // replace whatever a block previously connected at this height left behind
+    CLevelDBBatch batch;
+    for (CoinDenomination denom : zerocoinDenomList) {
+        if (mapDenoms.count(denom))
+            batch.Write(CPubcoinIndexKey(denom, nHeight), mapDenoms[denom]);
+        else
+            batch.Erase(CPubcoinIndexKey(denom, nHeight));
+    }
+    batch.Write(CPubcoinIndexKey(ZQ_ERROR, nHeight), hashBlock);
+    return WriteBatch(batch);
+}
+
+bool CZerocoinDB::EraseBlockPubcoins(int nHeight)
+{
+    CLevelDBBatch batch;
+    for (CoinDenomination denom : zerocoinDenomList)
+        batch.Erase(CPubcoinIndexKey(denom, nHeight));
+    batch.Erase(CPubcoinIndexKey(ZQ_ERROR, nHeight));
+    return WriteBatch(batch);
+}
+
+template <typename V>
+static bool ReadPubcoinIndexRange(CLevelDBWrapper& db, CoinDenomination denom, int nHeightStart, int nHeightEnd, std::map<int, V>& mapValues)
+{
+    boost::scoped_ptr<CLevelDBIterator> pcursor(db.NewRangeIterator());
+    for (pcursor->Seek(CPubcoinIndexKey(denom, nHeightStart)); pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        CPubcoinIndexKey key;
+        if (!pcursor->GetKey(key) || key.chType != 'p' || key.denom != denom || key.nHeight >= nHeightEnd)
+            break;
+
+        V value;
+        if (!pcursor->GetValue(value))
+            return error("%s : failed to read pubcoin index at height %d", __func__, key.nHeight);
+        mapValues.insert(std::make_pair(key.nHeight, value));
+    }
+    return true;
+}
+
+bool CZerocoinDB::ReadIndexedBlocks(int nHeightStart, int nHeightEnd, std::map<int, uint256>& mapBlockHashes)
+{
+    return ReadPubcoinIndexRange(*this, ZQ_ERROR, nHeightStart, nHeightEnd, mapBlockHashes);
+}
+
+bool CZerocoinDB::ReadPubcoinRange(CoinDenomination denom, int nHeightStart, int nHeightEnd, std::map<int, CBlockPubcoins>& mapPubcoins)
+{
+    return ReadPubcoinIndexRange(*this, denom, nHeightStart, nHeightEnd, mapPubcoins);
+}
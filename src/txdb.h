@@ -70,6 +70,62 @@ public:
     bool LoadBlockIndexGuts();
 };
 
+/** Key of the pubcoin index of CZerocoinDB. The height is written big endian so that the keys
+ *  of one denomination sort by height; the ZQ_ERROR denomination marks a height as indexed. */
+class CPubcoinIndexKey
+{
+public:
+    char chType;
+    libzerocoin::CoinDenomination denom;
+    int nHeight;
+
+    CPubcoinIndexKey() : chType('p'), denom(libzerocoin::ZQ_ERROR), nHeight(0) {}
+    CPubcoinIndexKey(libzerocoin::CoinDenomination denomIn, int nHeightIn) : chType('p'), denom(denomIn), nHeight(nHeightIn) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 1 + ::GetSerializeSize(denom, nType, nVersion) + 4;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        s << chType << denom;
+        for (int i = 3; i >= 0; i--)
+            s << (unsigned char)((uint32_t)nHeight >> (8 * i));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        s >> chType >> denom;
+        uint32_t n = 0;
+        for (int i = 0; i < 4; i++) {
+            unsigned char c;
+            s >> c;
+            n = (n << 8) | c;
+        }
+        nHeight = n;
+    }
+};
+
+/** Pubcoins of one denomination minted in a block, as kept in the pubcoin index */
+class CBlockPubcoins
+{
+public:
+    uint256 hashBlock;
+    std::vector<CBigNum> vPubcoins;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(hashBlock);
+        READWRITE(vPubcoins);
+    }
+};
+
 class CZerocoinDB : public CLevelDBWrapper
 {
 public:
@@ -89,6 +145,10 @@ public:
     bool WriteAccumulatorValue(const uint32_t& nChecksum, const CBigNum& bnValue);
     bool ReadAccumulatorValue(const uint32_t& nChecksum, CBigNum& bnValue);
     bool EraseAccumulatorValue(const uint32_t& nChecksum);
+    bool WriteBlockPubcoins(int nHeight, const uint256& hashBlock, const std::list<libzerocoin::PublicCoin>& listPubcoins);
+    bool EraseBlockPubcoins(int nHeight);
+    bool ReadIndexedBlocks(int nHeightStart, int nHeightEnd, std::map<int, uint256>& mapBlockHashes);
+    bool ReadPubcoinRange(libzerocoin::CoinDenomination denom, int nHeightStart, int nHeightEnd, std::map<int, CBlockPubcoins>& mapPubcoins);
 };
 
 #endif // BITCOIN_TXDB_H
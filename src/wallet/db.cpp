@@ -90,7 +90,11 @@ bool CDBEnv::Open(const boost::filesystem::path& pathIn)
     dbenv.set_lk_max_objects(40000);
     dbenv.set_errfile(fopen(pathErrorFile.string().c_str(), "a")); /// debug
     dbenv.set_flags(DB_AUTO_COMMIT, 1);
-    dbenv.set_flags(DB_TXN_WRITE_NOSYNC, 1);
+    std::string strDurability = GetArg("-walletdurability", DEFAULT_WALLET_DURABILITY);
+    if (strDurability == "none")
+        dbenv.set_flags(DB_TXN_NOSYNC, 1);
+    else if (strDurability != "sync")
+        dbenv.set_flags(DB_TXN_WRITE_NOSYNC, 1);
     dbenv.log_set_config(DB_LOG_AUTO_REMOVE, 1);
     int ret = dbenv.open(strPath.c_str(),
         DB_CREATE |
@@ -218,7 +222,98 @@ void CDBEnv::CheckpointLSN(const std::string& strFile)
 }
 
 
-CDB::CDB(const std::string& strFilename, const char* pszMode) : pdb(NULL), activeTxn(NULL)
+namespace
+{
+struct CBatchState {
+    DbTxn* ptxn;
+    unsigned int nRecords;   // written in ptxn by the handles closed so far
+    unsigned int nBatchSize;
+    int nScopes;             // open CDBBatch objects
+    int nHandles;            // open CDB objects in ptxn
+    bool fFailed;            // a commit of the batch failed, its records are lost
+
+    CBatchState() : ptxn(NULL), nRecords(0), nBatchSize(0), nScopes(0), nHandles(0), fFailed(false) {}
+};
+
+// the batches of each thread, by file
+boost::thread_specific_ptr<std::map<std::string, CBatchState> > batches;
+
+CBatchState* GetBatch(const std::string& strFile)
+{
+    if (!batches.get())
+        return NULL;
+    std::map<std::string, CBatchState>::iterator it = batches->find(strFile);
+    return it == batches->end() ? NULL : &it->second;
+}
+
+bool CommitBatch(const std::string& strFile, CBatchState& batch)
+{
+    if (!batch.ptxn)
+        return true;
+    int ret = batch.ptxn->commit(0);
+    unsigned int nRecords = batch.nRecords;
+    batch.ptxn = NULL;
+    batch.nRecords = 0;
+    if (ret != 0) {
+        batch.fFailed = true;
+        return error("%s : Error %d committing %u records to %s: %s", __func__, ret, nRecords, strFile, DbEnv::strerror(ret));
+    }
+    LogPrint("db", "%s : %u records committed to %s\n", __func__, nRecords, strFile);
+    return true;
+}
+
+// Commit, checkpoint and forget the batch once its last scope and handle are closed
+void EndBatch(const std::string& strFile, CBatchState& batch)
+{
+    if (batch.nScopes > 0 || batch.nHandles > 0)
+        return;
+    CommitBatch(strFile, batch);
+    bitdb.dbenv.txn_checkpoint(0, 0, 0);
+    {
+        LOCK(bitdb.cs_db);
+        --bitdb.mapFileUseCount[strFile];
+    }
+    batches->erase(strFile);
+}
+} // namespace
+
+CDBBatch::CDBBatch(const std::string& strFileIn) : strFile(strFileIn)
+{
+    if (strFile.empty())
+        return;
+    if (!batches.get())
+        batches.reset(new std::map<std::string, CBatchState>());
+    if (!batches->count(strFile)) {
+        // keep the file open, and out of the flush thread's hands, until the batch is committed
+        LOCK(bitdb.cs_db);
+        ++bitdb.mapFileUseCount[strFile];
+        (*batches)[strFile].nBatchSize = std::max(GetArg("-walletbatchsize", DEFAULT_WALLET_BATCHSIZE), (int64_t)1);
+    }
+    (*batches)[strFile].nScopes++;
+}
+
+bool CDBBatch::Commit()
+{
+    CBatchState* pbatch = GetBatch(strFile);
+    if (!pbatch)
+        return true;
+    if (pbatch->nHandles > 0)
+        return error("%s : %s still has %d open handles in the batch", __func__, strFile, pbatch->nHandles);
+    CommitBatch(strFile, *pbatch);
+    return !pbatch->fFailed;
+}
+
+CDBBatch::~CDBBatch()
+{
+    CBatchState* pbatch = GetBatch(strFile);
+    if (!pbatch)
+        return;
+    pbatch->nScopes--;
+    EndBatch(strFile, *pbatch);
+}
+
+
+CDB::CDB(const std::string& strFilename, const char* pszMode) : pdb(NULL), activeTxn(NULL), ptxnBatch(NULL), nWrites(0)
 {
     int ret;
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
@@ -274,6 +369,17 @@ CDB::CDB(const std::string& strFilename, const char* pszMode) : pdb(NULL), activ
             bitdb.mapDb[strFile] = pdb;
         }
     }
+
+    CBatchState* pbatch = GetBatch(strFile);
+    if (pbatch) {
+        if (!pbatch->ptxn)
+            pbatch->ptxn = bitdb.TxnBegin();
+        // without a transaction the handle writes on its own, as outside a batch
+        if (pbatch->ptxn) {
+            pbatch->nHandles++;
+            activeTxn = ptxnBatch = pbatch->ptxn;
+        }
+    }
 }
 
 void CDB::Flush()
@@ -293,12 +399,23 @@ void CDB::Close()
 {
     if (!pdb)
         return;
-    if (activeTxn)
+    if (activeTxn != ptxnBatch)
         activeTxn->abort();
     activeTxn = NULL;
     pdb = NULL;
 
-    Flush();
+    if (ptxnBatch) {
+        // the batch commits and checkpoints instead
+        CBatchState* pbatch = GetBatch(strFile);
+        ptxnBatch = NULL;
+        pbatch->nHandles--;
+        pbatch->nRecords += nWrites;
+        if (pbatch->nHandles == 0 && pbatch->nRecords >= pbatch->nBatchSize)
+            CommitBatch(strFile, *pbatch);
+        EndBatch(strFile, *pbatch);
+    } else {
+        Flush();
+    }
 
     {
         LOCK(bitdb.cs_db);
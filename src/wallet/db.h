@@ -27,6 +27,11 @@ struct CBlockLocator;
 
 extern unsigned int nWalletDBUpdated;
 
+//! Records written to a file in one transaction by a CDBBatch
+static const unsigned int DEFAULT_WALLET_BATCHSIZE = 1000;
+//! How far a commit goes: "sync" to disk, "write" to the operating system, or "none"
+static const char* const DEFAULT_WALLET_DURABILITY = "write";
+
 void ThreadFlushWalletDB(const std::string& strWalletFile);
 
 
@@ -80,10 +85,10 @@ public:
     void CloseDb(const std::string& strFile);
     bool RemoveDb(const std::string& strFile);
 
-    DbTxn* TxnBegin(int flags = DB_TXN_WRITE_NOSYNC)
+    DbTxn* TxnBegin(DbTxn* ptxnParent = NULL, int flags = 0)
     {
         DbTxn* ptxn = NULL;
-        int ret = dbenv.txn_begin(NULL, &ptxn, flags);
+        int ret = dbenv.txn_begin(ptxnParent, &ptxn, flags);
         if (!ptxn || ret != 0)
             return NULL;
         return ptxn;
@@ -93,6 +98,42 @@ public:
 extern CDBEnv bitdb;
 
 
+/**
+ * RAII class that groups the writes the current thread makes to a database
+ * file into few transactions.
+ *
+ * Every CDB the thread opens on the file while a batch is open joins the
+ * batch's transaction instead of committing each record on its own and
+ * checkpointing the environment when it is closed. The transaction is
+ * committed, with the -walletdurability policy, whenever all those handles
+ * are closed and -walletbatchsize records have been written, and when the
+ * outermost batch ends, which also checkpoints once. Until then other threads
+ * block on the pages it wrote, so only open a batch while holding the lock
+ * that guards the data being written (cs_wallet for the wallet).
+ *
+ * The writes succeed before anything is committed, so callers that must
+ * know their records are on disk call Commit() and check it.
+ */
+class CDBBatch
+{
+private:
+    std::string strFile;
+
+    CDBBatch(const CDBBatch&);
+    void operator=(const CDBBatch&);
+
+public:
+    explicit CDBBatch(const std::string& strFileIn);
+    ~CDBBatch();
+
+    /**
+     * Commit what the batch holds so far. Close the CDB handles on the file first.
+     * @return false if this or an earlier commit of the batch failed
+     */
+    bool Commit();
+};
+
+
 /** RAII class that provides access to a Berkeley database */
 class CDB
 {
@@ -100,6 +141,8 @@ protected:
     Db* pdb;
     std::string strFile;
     DbTxn* activeTxn;
+    DbTxn* ptxnBatch; // transaction of the thread's CDBBatch on the file, if any
+    unsigned int nWrites;
     bool fReadOnly;
 
     explicit CDB(const std::string& strFilename, const char* pszMode = "r+");
@@ -170,6 +213,8 @@ protected:
 
         // Write
         int ret = pdb->put(activeTxn, &datKey, &datValue, (fOverwrite ? 0 : DB_NOOVERWRITE));
+        if (ret == 0)
+            nWrites++;
 
         // Clear memory in case it was a private key
         memset(datKey.get_data(), 0, datKey.get_size());
@@ -193,6 +238,8 @@ protected:
 
         // Erase
         int ret = pdb->del(activeTxn, &datKey, 0);
+        if (ret == 0)
+            nWrites++;
 
         // Clear memory
         memset(datKey.get_data(), 0, datKey.get_size());
@@ -224,7 +271,7 @@ protected:
         if (!pdb)
             return NULL;
         Dbc* pcursor = NULL;
-        int ret = pdb->cursor(NULL, &pcursor, 0);
+        int ret = pdb->cursor(ptxnBatch ? activeTxn : NULL, &pcursor, 0);
         if (ret != 0)
             return NULL;
         return pcursor;
@@ -268,11 +315,12 @@ protected:
     }
 
 public:
+    // Inside a batch, these nest a transaction in the batch's one
     bool TxnBegin()
     {
-        if (!pdb || activeTxn)
+        if (!pdb || activeTxn != ptxnBatch)
             return false;
-        DbTxn* ptxn = bitdb.TxnBegin();
+        DbTxn* ptxn = bitdb.TxnBegin(ptxnBatch);
         if (!ptxn)
             return false;
         activeTxn = ptxn;
@@ -281,19 +329,19 @@ public:
 
     bool TxnCommit()
     {
-        if (!pdb || !activeTxn)
+        if (!pdb || activeTxn == ptxnBatch)
             return false;
         int ret = activeTxn->commit(0);
-        activeTxn = NULL;
+        activeTxn = ptxnBatch;
         return (ret == 0);
     }
 
     bool TxnAbort()
     {
-        if (!pdb || !activeTxn)
+        if (!pdb || activeTxn == ptxnBatch)
             return false;
         int ret = activeTxn->abort();
-        activeTxn = NULL;
+        activeTxn = ptxnBatch;
         return (ret == 0);
     }
 
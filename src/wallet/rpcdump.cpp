@@ -136,7 +136,8 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
 
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+            if (pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true) < 0)
+            throw JSONRPCError(RPC_WALLET_ERROR, "Error: failed to write the transactions found by the rescan");
         }
     }
 
@@ -199,7 +200,8 @@ UniValue importaddress(const UniValue& params, bool fHelp)
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding address to wallet");
 
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+            if (pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true) < 0)
+            throw JSONRPCError(RPC_WALLET_ERROR, "Error: failed to write the transactions found by the rescan");
             pwalletMain->ReacceptWalletTransactions();
         }
     }
@@ -294,7 +296,8 @@ UniValue importwallet(const UniValue& params, bool fHelp)
         pwalletMain->nTimeFirstKey = nTimeBegin;
 
     LogPrintf("Rescanning last %i blocks\n", chainActive.Height() - pindex->nHeight + 1);
-    pwalletMain->ScanForWalletTransactions(pindex);
+    if (pwalletMain->ScanForWalletTransactions(pindex) < 0)
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error: failed to write the transactions found by the rescan");
     pwalletMain->MarkDirty();
 
     if (!fGood)
@@ -483,7 +486,8 @@ UniValue bip38decrypt(const UniValue& params, bool fHelp)
 
         // whenever a key is imported, we need to scan the whole chain
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+        if (pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true) < 0)
+            throw JSONRPCError(RPC_WALLET_ERROR, "Error: failed to write the transactions found by the rescan");
     }
 
     return result;
@@ -23,6 +23,7 @@
 #include "timedata.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "wallet/walletrescan.h"
 
 #include "denomination_functions.h"
 #include "libzerocoin/Denominations.h"
@@ -449,6 +450,84 @@ void CWallet::SyncMetaData(pair<TxSpends::iterator, TxSpends::iterator> range)
     }
 }
 
+void CWalletUTXOIndex::Add(const COutPoint& outpoint, const CTxOut& txout)
+{
+    unsigned int nBuckets = txout.IsZerocoinMint() ? UTXO_ZEROCOIN : UTXO_STAKABLE;
+    std::map<COutPoint, CEntry>::iterator it = mapCoins.find(outpoint);
+    if (it != mapCoins.end()) {
+        if (it->second.nValue == txout.nValue && it->second.nBuckets == nBuckets)
+            return;
+        Remove(outpoint);
+    }
+
+    CEntry entry;
+    entry.nValue = txout.nValue;
+    entry.nBuckets = nBuckets;
+    mapCoins.insert(make_pair(outpoint, entry));
+    if (nBuckets & UTXO_STAKABLE)
+        setStakable.insert(outpoint);
+    if (nBuckets & UTXO_ZEROCOIN)
+        setZerocoin.insert(outpoint);
+    mapByAmount[txout.nValue].insert(outpoint);
+}
+
+bool CWalletUTXOIndex::Remove(const COutPoint& outpoint)
+{
+    std::map<COutPoint, CEntry>::iterator it = mapCoins.find(outpoint);
+    if (it == mapCoins.end())
+        return false;
+
+    setStakable.erase(outpoint);
+    setZerocoin.erase(outpoint);
+    std::map<CAmount, std::set<COutPoint> >::iterator mi = mapByAmount.find(it->second.nValue);
+    if (mi != mapByAmount.end()) {
+        mi->second.erase(outpoint);
+        if (mi->second.empty())
+            mapByAmount.erase(mi);
+    }
+    mapCoins.erase(it);
+    return true;
+}
+
+void CWalletUTXOIndex::clear()
+{
+    mapCoins.clear();
+    setStakable.clear();
+    setZerocoin.clear();
+    mapByAmount.clear();
+}
+
+size_t CWalletUTXOIndex::size(Bucket bucket) const
+{
+    return GetBucket(bucket).size();
+}
+
+void CWalletUTXOIndex::GetAll(std::vector<COutPoint>& vOutpoints) const
+{
+    vOutpoints.clear();
+    vOutpoints.reserve(mapCoins.size());
+    for (std::map<COutPoint, CEntry>::const_iterator it = mapCoins.begin(); it != mapCoins.end(); ++it)
+        vOutpoints.push_back(it->first);
+}
+
+void CWalletUTXOIndex::Get(Bucket bucket, std::vector<COutPoint>& vOutpoints) const
+{
+    const std::set<COutPoint>& setBucket = GetBucket(bucket);
+    vOutpoints.assign(setBucket.begin(), setBucket.end());
+}
+
+void CWalletUTXOIndex::GetByAmounts(const std::vector<CAmount>& vAmounts, std::vector<COutPoint>& vOutpoints) const
+{
+    vOutpoints.clear();
+    std::set<CAmount> setAmounts(vAmounts.begin(), vAmounts.end());
+    BOOST_FOREACH (CAmount nAmount, setAmounts) {
+        std::map<CAmount, std::set<COutPoint> >::const_iterator mi = mapByAmount.find(nAmount);
+        if (mi != mapByAmount.end())
+            vOutpoints.insert(vOutpoints.end(), mi->second.begin(), mi->second.end());
+    }
+    std::sort(vOutpoints.begin(), vOutpoints.end());
+}
+
 /**
  * Outpoint is spent if any non-conflicted transaction
  * spends it:
@@ -473,11 +552,63 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+/**
+ * Outpoint is spent for good (as far as the unspent output index is
+ * concerned) if a transaction spending it is in the main chain:
+ */
+bool CWallet::IsSpentInMainChain(const COutPoint& outpoint) const
+{
+    pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && mit->second.IsInMainChain())
+            return true;
+    }
+    return false;
+}
+
+void CWallet::UpdateUTXOIndex(const COutPoint& outpoint)
+{
+    std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(outpoint.hash);
+    if (mi == mapWallet.end() || outpoint.n >= mi->second.vout.size()) {
+        utxoIndex.Remove(outpoint);
+        return;
+    }
+
+    const CTxOut& txout = mi->second.vout[outpoint.n];
+    isminetype mine = IsMine(txout);
+    if (mine == ISMINE_NO || mine == ISMINE_WATCH_ONLY || IsSpentInMainChain(outpoint))
+        utxoIndex.Remove(outpoint);
+    else
+        utxoIndex.Add(outpoint, txout);
+}
+
+void CWallet::UpdateUTXOIndex(const CWalletTx& wtx)
+{
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.vout.size(); i++)
+        UpdateUTXOIndex(COutPoint(hash, i));
+}
+
+void CWallet::RebuildUTXOIndex()
+{
+    LOCK2(cs_main, cs_wallet);
+    utxoIndex.clear();
+    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        UpdateUTXOIndex(it->second);
+    LogPrintf("%s : %u unspent outputs in %u wallet transactions\n", __func__, utxoIndex.size(), mapWallet.size());
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(make_pair(outpoint, wtxid));
     setLockedCoins.erase(outpoint);
-    
+
+    // the index is rebuilt after loading the wallet, so only keep it current afterwards
+    if (utxoIndex.Contains(outpoint))
+        UpdateUTXOIndex(outpoint);
+
     pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
     SyncMetaData(range);
@@ -495,6 +626,27 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::RemoveFromSpends(const uint256& wtxid)
+{
+    assert(mapWallet.count(wtxid));
+    CWalletTx& thisTx = mapWallet[wtxid];
+    if (thisTx.IsCoinBase())
+        return;
+
+    BOOST_FOREACH (const CTxIn& txin, thisTx.vin) {
+        pair<TxSpends::iterator, TxSpends::iterator> range = mapTxSpends.equal_range(txin.prevout);
+        for (TxSpends::iterator it = range.first; it != range.second;) {
+            if (it->second == wtxid)
+                mapTxSpends.erase(it++);
+            else
+                ++it;
+        }
+        if (mapWallet.count(txin.prevout.hash))
+            mapWallet[txin.prevout.hash].MarkDirty();
+        UpdateUTXOIndex(txin.prevout);
+    }
+}
+
 bool CWallet::GetMasternodeVinAndKeys(CTxIn& txinRet, unsigned int& tierRet, CPubKey& pubKeyRet, CKey& keyRet, std::string strTxHash, std::string strOutputIndex)
 {
     // wait for reindex and/or import to finish
@@ -782,6 +934,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
         // Break debit/credit balance caches:
         wtx.MarkDirty();
 
+        // Outputs may be new, or ours now that more keys are known
+        UpdateUTXOIndex(wtx);
+
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -826,10 +981,12 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
 
     // If a transaction changes 'conflicted' state, that changes the balance
     // available of the outputs it spends. So force those to be
-    // recomputed, also:
+    // recomputed, also, and re-check them against the unspent output index:
     BOOST_FOREACH (const CTxIn& txin, tx.vin) {
-        if (!tx.IsZerocoinSpend() && mapWallet.count(txin.prevout.hash))
+        if (!tx.IsZerocoinSpend() && mapWallet.count(txin.prevout.hash)) {
             mapWallet[txin.prevout.hash].MarkDirty();
+            UpdateUTXOIndex(txin.prevout);
+        }
     }
 }
 
@@ -839,8 +996,13 @@ void CWallet::EraseFromWallet(const uint256& hash)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it != mapWallet.end()) {
+            for (unsigned int i = 0; i < it->second.vout.size(); i++)
+                utxoIndex.Remove(COutPoint(hash, i));
+            mapWallet.erase(hash);
             CWalletDB(strWalletFile).EraseTx(hash);
+        }
     }
     return;
 }
@@ -869,7 +1031,7 @@ bool CWallet::IsUsed(const CBitcoinAddress address) const
 }
 bool CWallet::IsMyZerocoinSpend(const CBigNum& bnSerial) const
 {
-    return CWalletDB(strWalletFile).ReadZerocoinSpendSerialEntry(bnSerial);
+    return zparaTracker->HasSpend(bnSerial);
 }
 
 CAmount CWallet::GetDebit(const CTxIn& txin, const isminefilter& filter) const
@@ -1170,6 +1332,63 @@ bool CWalletTx::WriteToDisk()
     return CWalletDB(pwallet->strWalletFile).WriteTx(GetHash(), *this);
 }
 
+/**
+ * A filter for the rescan's reader threads: the data pushed by the scripts
+ * that pay the wallet, and the hashes and outpoints of its transactions. An
+ * empty filter, which lets everything through, when a script can only be
+ * matched as a whole.
+ */
+CBloomFilter CWallet::GetRescanFilter() const
+{
+    AssertLockHeld(cs_wallet);
+    LOCK(cs_KeyStore);
+
+    // data pushed by the output scripts that pay the wallet, and by the inputs that spend from it
+    std::vector<std::vector<unsigned char> > vData;
+    std::set<CKeyID> setKeys;
+    GetKeys(setKeys);
+    BOOST_FOREACH (const CKeyID& keyID, setKeys) {
+        vData.push_back(ToByteVector(keyID));
+        CPubKey pubkey;
+        if (GetPubKey(keyID, pubkey))
+            vData.push_back(ToByteVector(pubkey));
+    }
+    for (ScriptMap::const_iterator it = mapScripts.begin(); it != mapScripts.end(); ++it)
+        vData.push_back(ToByteVector(it->first));
+    std::vector<CScript> vScripts(setWatchOnly.begin(), setWatchOnly.end());
+    vScripts.insert(vScripts.end(), setMultiSig.begin(), setMultiSig.end());
+    BOOST_FOREACH (const CScript& script, vScripts) {
+        bool fData = false;
+        CScript::const_iterator pc = script.begin();
+        opcodetype opcode;
+        std::vector<unsigned char> data;
+        while (script.GetOp(pc, opcode, data)) {
+            if (!data.empty()) {
+                vData.push_back(data);
+                fData = true;
+            }
+        }
+        // a script without data can only be matched as a whole: let everything through
+        if (!fData)
+            return CBloomFilter();
+    }
+
+    unsigned int nElements = vData.size();
+    for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        nElements += 1 + it->second.vout.size();
+
+    CBloomFilter filter(std::max(nElements, 1u), 0.0001, GetRand(std::numeric_limits<unsigned int>::max()), BLOOM_UPDATE_NONE);
+    BOOST_FOREACH (const std::vector<unsigned char>& data, vData)
+        filter.insert(data);
+    // the wallet's transactions, and the outputs their spends refer to
+    for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
+        filter.insert(it->first);
+        for (unsigned int i = 0; i < it->second.vout.size(); i++)
+            filter.insert(COutPoint(it->first, i));
+    }
+    return filter;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -1179,37 +1398,105 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
     int ret = 0;
     int64_t nNow = GetTime();
+    int64_t nTimeStart = GetTimeMicros();
+
+    // -rescanthreads=0 means one per core besides this thread, but at least one
+    int nThreads = GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS);
+    if (nThreads <= 0)
+        nThreads += boost::thread::hardware_concurrency() - 1;
+    nThreads = std::max(1, std::min(nThreads, MAX_RESCAN_THREADS));
 
     CBlockIndex* pindex = pindexStart;
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
+    }
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainActive.Tip(), false);
-        while (pindex) {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-
-            CBlock block;
-            ReadBlockFromDisk(block, pindex);
-            BOOST_FOREACH (CTransaction& tx, block.vtx) {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
-                    ret++;
-            }
-            pindex = chainActive.Next(pindex);
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+    std::set<uint256> setFound; // transactions the rescan added, spends of them are the wallet's too
+    CWalletRescanStats stats;
+    while (pindex) {
+        // the blocks up to the tip and the filter are taken as they are now, blocks
+        // connected meanwhile are scanned again by the next pass
+        std::vector<CBlockIndex*> vIndex;
+        CBloomFilter filter;
+        double dProgressStart, dProgressTip;
+        {
+            LOCK2(cs_main, cs_wallet);
+            for (; pindex; pindex = chainActive.Next(pindex))
+                vIndex.push_back(pindex);
+            filter = GetRescanFilter();
+            dProgressStart = Checkpoints::GuessVerificationProgress(vIndex.front(), false);
+            dProgressTip = Checkpoints::GuessVerificationProgress(vIndex.back(), false);
+        }
+
+        CWalletRescanPipeline pipeline(vIndex, filter, nThreads);
+        CRescanBlockRef item;
+        while (pipeline.Next(item)) {
+            if (item->pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(item->pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(pindex));
+                LogPrintf("Still rescanning. At block %d. Progress=%f\n", item->pindex->nHeight, Checkpoints::GuessVerificationProgress(item->pindex));
+            }
+
+            // the transactions that passed the filter, and the ones spending from them or from earlier finds
+            std::vector<const CTransaction*> vMatches;
+            std::set<uint256> setBlockMatches;
+            for (unsigned int i = 0; i < item->block.vtx.size(); i++) {
+                const CTransaction& tx = item->block.vtx[i];
+                bool fMatch = item->vMatch[i];
+                for (unsigned int j = 0; j < tx.vin.size() && !fMatch; j++)
+                    fMatch = setFound.count(tx.vin[j].prevout.hash) || setBlockMatches.count(tx.vin[j].prevout.hash);
+                if (fMatch) {
+                    vMatches.push_back(&tx);
+                    setBlockMatches.insert(tx.GetHash());
+                }
+            }
+            if (vMatches.empty())
+                continue;
+
+            LOCK2(cs_main, cs_wallet);
+            // a block disconnected meanwhile: its replacements are scanned by the next pass
+            if (!chainActive.Contains(item->pindex))
+                continue;
+            CDBBatch batch(strWalletFile);
+            BOOST_FOREACH (const CTransaction* ptx, vMatches) {
+                if (AddToWalletIfInvolvingMe(*ptx, &item->block, fUpdate)) {
+                    setFound.insert(ptx->GetHash());
+                    ret++;
+                }
+            }
+            if (!batch.Commit()) {
+                LogPrintf("%s : writing the transactions found in block %d failed\n", __func__, item->pindex->nHeight);
+                ShowProgress(_("Rescanning..."), 100);
+                return -1;
             }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
-    }
+
+        CWalletRescanStats statsPass = pipeline.GetStats();
+        stats.nBlocks += statsPass.nBlocks;
+        stats.nTx += statsPass.nTx;
+        stats.nMatches += statsPass.nMatches;
+        stats.nTimeRead += statsPass.nTimeRead;
+        stats.nTimeFilter += statsPass.nTimeFilter;
+        stats.nTimeWait += statsPass.nTimeWait;
+
+        // continue after the last block scanned, or where the chain forked off it
+        LOCK(cs_main);
+        const CBlockIndex* pindexFork = chainActive.FindFork(vIndex.back());
+        pindex = pindexFork ? chainActive.Next(pindexFork) : chainActive.Genesis();
+    }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+    int64_t nTime = GetTimeMicros() - nTimeStart;
+    LogPrintf("%s : %u blocks in %.3fs (%.1f blocks/s, %d threads), %u of %u transactions passed the filter, %d added or updated\n",
+        __func__, stats.nBlocks, nTime * 0.000001, stats.nBlocks * 1000000.0 / std::max(nTime, (int64_t)1), nThreads, stats.nMatches, stats.nTx, ret);
+    LogPrint("bench", "    - read %.2fms, filter %.2fms, waited %.2fms\n", stats.nTimeRead * 0.001, stats.nTimeFilter * 0.001, stats.nTimeWait * 0.001);
     return ret;
 }
 
@@ -1340,7 +1627,7 @@ CAmount CWallet::GetZerocoinBalance(bool fMatureOnly) const
     {
         LOCK2(cs_main, cs_wallet);
         // Get Unused coins
-        list<CZerocoinMint> listPubCoin = CWalletDB(strWalletFile).ListMintedCoins(true, fMatureOnly, true);
+        list<CZerocoinMint> listPubCoin = zparaTracker->ListMints(true, fMatureOnly, true);
         for (auto& mint : listPubCoin) {
             libzerocoin::CoinDenomination denom = mint.GetDenomination();
             nTotal += libzerocoin::ZerocoinDenominationToAmount(denom);
@@ -1365,8 +1652,7 @@ CAmount CWallet::GetImmatureZerocoinBalance() const
 CAmount CWallet::GetUnconfirmedZerocoinBalance() const
 {
     CAmount nUnconfirmed = 0;
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(true, false, true);
+    list<CZerocoinMint> listMints = zparaTracker->ListMints(true, false, true);
 
     std::map<libzerocoin::CoinDenomination, int> mapUnconfirmed;
     for (const auto& denom : libzerocoin::zerocoinDenomList){
@@ -1439,7 +1725,7 @@ std::map<libzerocoin::CoinDenomination, CAmount> CWallet::GetMyZerocoinDistribut
         spread.insert(std::pair<libzerocoin::CoinDenomination, CAmount>(denom, 0));
     {
         LOCK2(cs_main, cs_wallet);
-        list<CZerocoinMint> listPubCoin = CWalletDB(strWalletFile).ListMintedCoins(true, true, true);
+        list<CZerocoinMint> listPubCoin = zparaTracker->ListMints(true, true, true);
         for (auto& mint : listPubCoin)
             spread.at(mint.GetDenomination())++;
     }
@@ -1687,68 +1973,90 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
     {
         auto currentBlock = chainActive.Height();
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (!CheckFinalTx(*pcoin))
-                continue;
 
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
-
-            if ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && pcoin->GetBlocksToMaturity() > 0)
-                continue;
-
-            int nDepth = pcoin->GetDepthInMainChain(false);
-            // do not use IX for inputs that have less then 6 blockchain confirmations
-            if (fUseIX && nDepth < 6)
-                continue;
+        // Only look at the unspent outputs that can be of the requested type
+        vector<COutPoint> vOutpoints;
+        if (nCoinType == ONLY_DENOMINATED) {
+            utxoIndex.GetByAmounts(obfuScationDenominations, vOutpoints);
+        } else if (nCoinType == ONLY_10000) {
+            vector<CAmount> vCollaterals;
+            for (unsigned int tier = MasternodeTiers::TIER_100; tier < MasternodeTiers::TIER_NONE; ++tier)
+                vCollaterals.push_back(MASTERNODE_TIER_COINS[tier] * COIN);
+            utxoIndex.GetByAmounts(vCollaterals, vOutpoints);
+        } else if (nCoinType == STAKABLE_COINS) {
+            utxoIndex.Get(CWalletUTXOIndex::UTXO_STAKABLE, vOutpoints);
+        } else {
+            utxoIndex.GetAll(vOutpoints);
+        }
 
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
-                bool found = false;
-                if (nCoinType == ONLY_DENOMINATED) {
-                    found = IsDenominatedAmount(pcoin->vout[i].nValue);
-                } else if (nCoinType == ONLY_NOT10000IFMN) {
-                    found = !(fMasterNode && IsMasternodeOutput(pcoin->vout[i].nValue, currentBlock));
-                } else if (nCoinType == ONLY_NONDENOMINATED_NOT10000IFMN) {
-                    if (IsCollateralAmount(pcoin->vout[i].nValue)) continue; // do not use collateral amounts
-                    found = !IsDenominatedAmount(pcoin->vout[i].nValue);
-                    if (found && fMasterNode) found = !IsMasternodeOutput(pcoin->vout[i].nValue, currentBlock); // do not use Hot MN funds
-                } else if (nCoinType == ONLY_10000) {
-                    found = IsMasternodeOutput(pcoin->vout[i].nValue, currentBlock);
-                } else {
-                    found = true;
+        // outpoints are sorted, so the outputs of a transaction are checked together
+        const CWalletTx* pcoin = NULL;
+        bool fSkipTx = false;
+        int nDepth = 0;
+        BOOST_FOREACH (const COutPoint& outpoint, vOutpoints) {
+            const uint256& wtxid = outpoint.hash;
+            const unsigned int i = outpoint.n;
+
+            if (pcoin == NULL || pcoin->GetHash() != wtxid) {
+                map<uint256, CWalletTx>::const_iterator it = mapWallet.find(wtxid);
+                if (it == mapWallet.end())
+                    continue;
+                pcoin = &(*it).second;
+
+                fSkipTx = !CheckFinalTx(*pcoin) ||
+                          (fOnlyConfirmed && !pcoin->IsTrusted()) ||
+                          ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && pcoin->GetBlocksToMaturity() > 0);
+                if (!fSkipTx) {
+                    nDepth = pcoin->GetDepthInMainChain(false);
+                    // do not use IX for inputs that have less then 6 blockchain confirmations
+                    fSkipTx = fUseIX && nDepth < 6;
                 }
-                if (!found) continue;
+            }
+            if (fSkipTx)
+                continue;
 
-                if (nCoinType == STAKABLE_COINS) {
-                    if (pcoin->vout[i].IsZerocoinMint())
-                        continue;
-                }
+            bool found = false;
+            if (nCoinType == ONLY_DENOMINATED) {
+                found = IsDenominatedAmount(pcoin->vout[i].nValue);
+            } else if (nCoinType == ONLY_NOT10000IFMN) {
+                found = !(fMasterNode && IsMasternodeOutput(pcoin->vout[i].nValue, currentBlock));
+            } else if (nCoinType == ONLY_NONDENOMINATED_NOT10000IFMN) {
+                if (IsCollateralAmount(pcoin->vout[i].nValue)) continue; // do not use collateral amounts
+                found = !IsDenominatedAmount(pcoin->vout[i].nValue);
+                if (found && fMasterNode) found = !IsMasternodeOutput(pcoin->vout[i].nValue, currentBlock); // do not use Hot MN funds
+            } else if (nCoinType == ONLY_10000) {
+                found = IsMasternodeOutput(pcoin->vout[i].nValue, currentBlock);
+            } else {
+                found = true;
+            }
+            if (!found) continue;
 
-                isminetype mine = IsMine(pcoin->vout[i]);
-                if (IsSpent(wtxid, i))
-                    continue;
-                if (mine == ISMINE_NO)
-                    continue;
-                if (mine == ISMINE_WATCH_ONLY)
+            if (nCoinType == STAKABLE_COINS) {
+                if (pcoin->vout[i].IsZerocoinMint())
                     continue;
+            }
 
-                if (IsLockedCoin((*it).first, i) && nCoinType != ONLY_10000)
-                    continue;
-                if (pcoin->vout[i].nValue <= 0 && !fIncludeZeroValue)
-                    continue;
-                if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected((*it).first, i))
-                    continue;
+            isminetype mine = IsMine(pcoin->vout[i]);
+            if (IsSpent(wtxid, i))
+                continue;
+            if (mine == ISMINE_NO)
+                continue;
+            if (mine == ISMINE_WATCH_ONLY)
+                continue;
 
-                bool fIsSpendable = false;
-                if ((mine & ISMINE_SPENDABLE) != ISMINE_NO)
-                    fIsSpendable = true;
-                if ((mine & ISMINE_MULTISIG) != ISMINE_NO)
-                    fIsSpendable = true;
-                vCoins.emplace_back(COutput(pcoin, i, nDepth, fIsSpendable));
-            }
+            if (IsLockedCoin(wtxid, i) && nCoinType != ONLY_10000)
+                continue;
+            if (pcoin->vout[i].nValue <= 0 && !fIncludeZeroValue)
+                continue;
+            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(wtxid, i))
+                continue;
+
+            bool fIsSpendable = false;
+            if ((mine & ISMINE_SPENDABLE) != ISMINE_NO)
+                fIsSpendable = true;
+            if ((mine & ISMINE_MULTISIG) != ISMINE_NO)
+                fIsSpendable = true;
+            vCoins.emplace_back(COutput(pcoin, i, nDepth, fIsSpendable));
         }
     }
 }
@@ -2648,6 +2956,8 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
     if (GetAdjustedTime() <= chainActive.Tip()->nTime)
         MilliSleep(10000);
 
+    std::vector<pair<const CWalletTx*, unsigned int> > vStakeCoins;
+    std::vector<CStakeKernelCandidate> vCandidates;
     BOOST_FOREACH (PAIRTYPE(const CWalletTx*, unsigned int) pcoin, setStakeCoins) {
         //make sure that enough time has elapsed between
         CBlockIndex* pindex = NULL;
@@ -2660,76 +2970,77 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
             continue;
         }
 
-        // Read block header
-        CBlockHeader block = pindex->GetBlockHeader();
+        vStakeCoins.push_back(pcoin);
+        vCandidates.push_back(CStakeKernelCandidate(COutPoint(pcoin.first->GetHash(), pcoin.second), pcoin.first->vout[pcoin.second].nValue, pindex));
+    }
 
-        bool fKernelFound = false;
-        uint256 hashProofOfStake = 0;
-        COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
-        nTxNewTime = GetAdjustedTime();
+    //hash the kernels of all stake coins in one sweep, then take the first usable hit
+    std::vector<CStakeKernelHit> vHits;
+    nTxNewTime = GetAdjustedTime();
+    stakeKernelSearch.Search(vCandidates, nBits, nTxNewTime, nHashDrift, vHits);
+    if (fDebug && GetBoolArg("-printcoinstake", false))
+        LogPrintf("CreateCoinStake : searched %u kernels, %u hits, %.0f hashes/s\n", vCandidates.size(), vHits.size(), stakeKernelSearch.GetHashRate());
 
-        //iterates each utxo inside of CheckStakeKernelHash()
-        if (CheckStakeKernelHash(nBits, block, *pcoin.first, prevoutStake, nTxNewTime, nHashDrift, false, hashProofOfStake, true)) {
-            //Double check that this will pass time requirements
-            if (nTxNewTime <= chainActive.Tip()->GetMedianTimePast()) {
-                LogPrintf("CreateCoinStake() : kernel found, but it is too far in the past \n");
-                continue;
-            }
+    BOOST_FOREACH (const CStakeKernelHit& hit, vHits) {
+        PAIRTYPE(const CWalletTx*, unsigned int) pcoin = vStakeCoins[hit.nCandidate];
+        nTxNewTime = hit.nTimeTx;
 
-            // Found a kernel
-            if (fDebug && GetBoolArg("-printcoinstake", false))
-                LogPrintf("CreateCoinStake : kernel found\n");
-
-            vector<valtype> vSolutions;
-            txnouttype whichType;
-            CScript scriptPubKeyOut;
-            scriptPubKeyKernel = pcoin.first->vout[pcoin.second].scriptPubKey;
-            if (!Solver(scriptPubKeyKernel, whichType, vSolutions)) {
-                LogPrintf("CreateCoinStake : failed to parse kernel\n");
-                break;
-            }
+        //Double check that this will pass time requirements
+        if (nTxNewTime <= chainActive.Tip()->GetMedianTimePast()) {
+            LogPrintf("CreateCoinStake() : kernel found, but it is too far in the past \n");
+            continue;
+        }
+
+        // Found a kernel
+        if (fDebug && GetBoolArg("-printcoinstake", false))
+            LogPrintf("CreateCoinStake : kernel found\n");
+
+        vector<valtype> vSolutions;
+        txnouttype whichType;
+        CScript scriptPubKeyOut;
+        scriptPubKeyKernel = pcoin.first->vout[pcoin.second].scriptPubKey;
+        if (!Solver(scriptPubKeyKernel, whichType, vSolutions)) {
+            LogPrintf("CreateCoinStake : failed to parse kernel\n");
+            break;
+        }
+        if (fDebug && GetBoolArg("-printcoinstake", false))
+            LogPrintf("CreateCoinStake : parsed kernel type=%d\n", whichType);
+        if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH) {
             if (fDebug && GetBoolArg("-printcoinstake", false))
-                LogPrintf("CreateCoinStake : parsed kernel type=%d\n", whichType);
-            if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH) {
+                LogPrintf("CreateCoinStake : no support for kernel type=%d\n", whichType);
+            break; // only support pay to public key and pay to address
+        }
+        if (whichType == TX_PUBKEYHASH) // pay to address type
+        {
+            //convert to pay to public key type
+            CKey key;
+            CKeyID keyID = CKeyID(uint160(vSolutions[0]));
+            if (!keystore.GetKey(keyID, key)) {
                 if (fDebug && GetBoolArg("-printcoinstake", false))
-                    LogPrintf("CreateCoinStake : no support for kernel type=%d\n", whichType);
-                break; // only support pay to public key and pay to address
+                    LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+                break; // unable to find corresponding public key
             }
-            if (whichType == TX_PUBKEYHASH) // pay to address type
-            {
-                //convert to pay to public key type
-                CKey key;
-                CKeyID keyID = CKeyID(uint160(vSolutions[0]));
-                if (!keystore.GetKey(keyID, key)) {
-                    if (fDebug && GetBoolArg("-printcoinstake", false))
-                        LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-                    break; // unable to find corresponding public key
-                }
 
-                scriptPubKeyOut << key.GetPubKey() << OP_CHECKSIG;
-            } else
-                scriptPubKeyOut = scriptPubKeyKernel;
+            scriptPubKeyOut << key.GetPubKey() << OP_CHECKSIG;
+        } else
+            scriptPubKeyOut = scriptPubKeyKernel;
 
-            txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
-            nCredit += pcoin.first->vout[pcoin.second].nValue;
-            vwtxPrev.push_back(pcoin.first);
-            txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
+        txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
+        nCredit += pcoin.first->vout[pcoin.second].nValue;
+        vwtxPrev.push_back(pcoin.first);
+        txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
 
-            //presstab HyperStake - calculate the total size of our new output including the stake reward so that we can use it to decide whether to split the stake outputs
-            const CBlockIndex* pIndex0 = chainActive.Tip();
-            uint64_t nTotalSize = pcoin.first->vout[pcoin.second].nValue + GetBlockValue(pIndex0->nHeight);
+        //presstab HyperStake - calculate the total size of our new output including the stake reward so that we can use it to decide whether to split the stake outputs
+        const CBlockIndex* pIndex0 = chainActive.Tip();
+        uint64_t nTotalSize = pcoin.first->vout[pcoin.second].nValue + GetBlockValue(pIndex0->nHeight);
 
-            //presstab HyperStake - if MultiSend is set to send in coinstake we will add our outputs here (values asigned further down)
-            if (nTotalSize / 2 > nStakeSplitThreshold * COIN)
-                txNew.vout.push_back(CTxOut(0, scriptPubKeyOut)); //split stake
+        //presstab HyperStake - if MultiSend is set to send in coinstake we will add our outputs here (values asigned further down)
+        if (nTotalSize / 2 > nStakeSplitThreshold * COIN)
+            txNew.vout.push_back(CTxOut(0, scriptPubKeyOut)); //split stake
 
-            if (fDebug && GetBoolArg("-printcoinstake", false))
-                LogPrintf("CreateCoinStake : added kernel type=%d\n", whichType);
-            fKernelFound = true;
-            break;
-        }
-        if (fKernelFound)
-            break; // if kernel is found stop searching
+        if (fDebug && GetBoolArg("-printcoinstake", false))
+            LogPrintf("CreateCoinStake : added kernel type=%d\n", whichType);
+        break; // if kernel is found stop searching
     }
     if (nCredit == 0 || nCredit > nBalance - nReserveBalance)
         return false;
@@ -2792,16 +3103,16 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, std:
         LOCK2(cs_main, cs_wallet);
         LogPrintf("CommitTransaction:\n%s", wtxNew.ToString());
         {
-            // This is only to keep the database open to defeat the auto-flush for the
-            // duration of this scope.  This is the only place where this optimization
-            // maybe makes sense; please don't do it anywhere else.
-            CWalletDB* pwalletdb = fFileBacked ? new CWalletDB(strWalletFile, "r") : NULL;
+            // the transaction and the key taken from the pool in one commit
+            CDBBatch batch(strWalletFile);
 
             // Take key pair from key pool so it won't be used again
             reservekey.KeepKey();
 
             // Add tx to wallet, because if it has change it's also ours,
             // otherwise just for transaction history.
+            uint256 hash = wtxNew.GetHash();
+            bool fInsertedNew = !mapWallet.count(hash);
             AddToWallet(wtxNew);
 
             // Notify that old coins are spent
@@ -2818,8 +3129,18 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, std:
                 }
             }
 
-            if (fFileBacked)
-                delete pwalletdb;
+            // not broadcast unless it is on disk with the key it pays change to, and
+            // not kept either, or it would be resent and its inputs stay spent
+            if (!batch.Commit()) {
+                if (fInsertedNew) {
+                    RemoveFromSpends(hash);
+                    for (unsigned int i = 0; i < wtxNew.vout.size(); i++)
+                        utxoIndex.Remove(COutPoint(hash, i));
+                    mapWallet.erase(hash);
+                    NotifyTransactionChanged(this, hash, CT_DELETED);
+                }
+                return error("CommitTransaction() : Error: writing the transaction %s failed", hash.ToString());
+            }
         }
 
         // Track how many getdata requests our transaction gets
@@ -3024,6 +3345,9 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
         return nLoadWalletRet;
     fFirstRunRet = !vchDefaultKey.IsValid();
 
+    RebuildUTXOIndex();
+    zparaTracker->Init();
+
     uiInterface.LoadWallet(this);
 
     return DB_LOAD_OK;
@@ -3140,26 +3464,39 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         if (IsLocked())
             return false;
 
-        CWalletDB walletdb(strWalletFile);
-
-        // Top up key pool
-        unsigned int nTargetSize;
-        if (kpSize > 0)
-            nTargetSize = kpSize;
-        else
-            nTargetSize = max(GetArg("-keypool", 1000), (int64_t)0);
+        // one commit for the whole refill, rather than one per key record
+        CDBBatch batch(strWalletFile);
+        std::vector<int64_t> vNewKeys;
+        {
+            CWalletDB walletdb(strWalletFile);
+
+            // Top up key pool
+            unsigned int nTargetSize;
+            if (kpSize > 0)
+                nTargetSize = kpSize;
+            else
+                nTargetSize = max(GetArg("-keypool", 1000), (int64_t)0);
+
+            while (setKeyPool.size() < (nTargetSize + 1)) {
+                int64_t nEnd = 1;
+                if (!setKeyPool.empty())
+                    nEnd = *(--setKeyPool.end()) + 1;
+                if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey())))
+                    throw runtime_error("TopUpKeyPool() : writing generated key failed");
+                setKeyPool.insert(nEnd);
+                vNewKeys.push_back(nEnd);
+                LogPrintf("keypool added key %d, size=%u\n", nEnd, setKeyPool.size());
+                double dProgress = 100.f * nEnd / (nTargetSize + 1);
+                std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
+                uiInterface.InitMessage(strMsg);
+            }
+        }
 
-        while (setKeyPool.size() < (nTargetSize + 1)) {
-            int64_t nEnd = 1;
-            if (!setKeyPool.empty())
-                nEnd = *(--setKeyPool.end()) + 1;
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey())))
-                throw runtime_error("TopUpKeyPool() : writing generated key failed");
-            setKeyPool.insert(nEnd);
-            LogPrintf("keypool added key %d, size=%u\n", nEnd, setKeyPool.size());
-            double dProgress = 100.f * nEnd / (nTargetSize + 1);
-            std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
-            uiInterface.InitMessage(strMsg);
+        // keys that did not make it to disk must not be handed out
+        if (!batch.Commit()) {
+            BOOST_FOREACH (int64_t nIndex, vNewKeys)
+                setKeyPool.erase(nIndex);
+            throw runtime_error("TopUpKeyPool() : writing generated keys failed");
         }
     }
     return true;
@@ -4165,11 +4502,16 @@ bool CWallet::MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, con
     libzerocoin::AccumulatorWitness witness(Params().Zerocoin_Params(), accumulator, pubCoinSelected);
     string strFailReason = "";
     int nMintsAdded = 0;
-    if (!GenerateAccumulatorWitness(pubCoinSelected, accumulator, witness, nSecurityLevel, nMintsAdded, strFailReason)) {
+    CWalletDB walletdb(strWalletFile);
+    CMintWitness mintWitness;
+    walletdb.ReadMintWitness(pubCoinSelected.getValue(), mintWitness);
+    if (!GenerateAccumulatorWitness(pubCoinSelected, accumulator, witness, nSecurityLevel, nMintsAdded, strFailReason, &mintWitness)) {
         receipt.SetStatus("Try to spend with a higher security level to include more coins", Zpapara_FAILED_ACCUMULATOR_INITIALIZATION);
         LogPrintf("%s : %s \n", __func__, receipt.GetStatusMessage());
         return false;
     }
+    if (!mintWitness.IsNull() && !walletdb.WriteMintWitness(pubCoinSelected.getValue(), mintWitness))
+        LogPrintf("%s failed to write mint witness\n", __func__);
 
     // Construct the CoinSpend object. This acts like a signature on the transaction.
     libzerocoin::PrivateCoin privateCoin(Params().Zerocoin_Params(), denomination);
@@ -4216,18 +4558,15 @@ bool CWallet::MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, con
             return false;
         }
 
-        std::list<CBigNum> listCoinSpendSerial = CWalletDB(strWalletFile).ListSpentCoinsSerial();
-        for (const CBigNum& item : listCoinSpendSerial) {
-            if (spend.getCoinSerialNumber() == item) {
-                //Tried to spend an already spent zpara
-                zerocoinSelected.SetUsed(true);
-                if (!CWalletDB(strWalletFile).WriteZerocoinMint(zerocoinSelected))
-                    LogPrintf("%s failed to write zerocoinmint\n", __func__);
+        if (zparaTracker->HasSpend(spend.getCoinSerialNumber())) {
+            //Tried to spend an already spent zpara
+            zerocoinSelected.SetUsed(true);
+            if (!zparaTracker->Add(zerocoinSelected))
+                LogPrintf("%s failed to write zerocoinmint\n", __func__);
 
-                pwalletMain->NotifyZerocoinChanged(pwalletMain, zerocoinSelected.GetValue().GetHex(), "Used", CT_UPDATED);
-                receipt.SetStatus("the coin spend has been used", Zpapara_SPENT_USED_Zpapara);
-                return false;
-            }
+            pwalletMain->NotifyZerocoinChanged(pwalletMain, zerocoinSelected.GetValue().GetHex(), "Used", CT_UPDATED);
+            receipt.SetStatus("the coin spend has been used", Zpapara_SPENT_USED_Zpapara);
+            return false;
         }
 
         uint32_t nAccumulatorChecksum = GetChecksum(accumulator.getValue());
@@ -4263,14 +4602,13 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
     nStatus = Zpapara_TRX_CREATE;
 
     // If not already given pre-selected mints, then select mints from the wallet
-    CWalletDB walletdb(pwalletMain->strWalletFile);
     list<CZerocoinMint> listMints;
     CAmount nValueSelected = 0;
     int nCoinsReturned = 0; // Number of coins returned in change from function below (for debug)
     int nNeededSpends = 0;  // Number of spends which would be needed if selection failed
     const int nMaxSpends = Params().Zerocoin_MaxSpendsPerTransaction(); // Maximum possible spends for one zpara transaction
     if (vSelectedMints.empty()) {
-        listMints = walletdb.ListMintedCoins(true, true, true); // need to find mints to spend
+        listMints = zparaTracker->ListMints(true, true, true); // need to find mints to spend
         if(listMints.empty()) {
             receipt.SetStatus("failed to find Zerocoins in in wallet.dat", nStatus);
             return false;
@@ -4301,7 +4639,7 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
             receipt.SetStatus("trying to spend an already spent serial #, try again.", nStatus);
 
             mint.SetUsed(true);
-            walletdb.WriteZerocoinMint(mint);
+            zparaTracker->Add(mint);
 
             return false;
         }
@@ -4320,7 +4658,7 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
 
         // archive this mint as an orphan
         if (fArchive) {
-            walletdb.ArchiveMintOrphan(mint);
+            zparaTracker->Archive(mint);
             nArchived++;
         }
     }
@@ -4413,7 +4751,7 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
             for (CZerocoinSpend spend : receipt.GetSpends()) {
                 spend.SetTxHash(txHash);
 
-                if (!CWalletDB(strWalletFile).WriteZerocoinSpendSerialEntry(spend)) {
+                if (!zparaTracker->AddSpend(spend)) {
                     receipt.SetStatus("failed to write coin serial number into wallet", nStatus);
                 }
             }
@@ -4435,9 +4773,7 @@ string CWallet::ResetMintZerocoin(bool fExtendedSearch)
 {
     long updates = 0;
     long deletions = 0;
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, true);
+    list<CZerocoinMint> listMints = zparaTracker->ListMints(false, false, true);
     vector<CZerocoinMint> vMintsToFind{ std::make_move_iterator(std::begin(listMints)), std::make_move_iterator(std::end(listMints)) };
     vector<CZerocoinMint> vMintsMissing;
     vector<CZerocoinMint> vMintsToUpdate;
@@ -4448,13 +4784,13 @@ string CWallet::ResetMintZerocoin(bool fExtendedSearch)
     // Update the meta data of mints that were marked for updating
     for (CZerocoinMint mint : vMintsToUpdate) {
         updates++;
-        walletdb.WriteZerocoinMint(mint);
+        zparaTracker->Add(mint);
     }
 
     // Delete any mints that were unable to be located on the blockchain
     for (CZerocoinMint mint : vMintsMissing) {
         deletions++;
-        walletdb.ArchiveMintOrphan(mint);
+        zparaTracker->Archive(mint);
     }
 
     string strResult = _("ResetMintZerocoin finished: ") + to_string(updates) + _(" mints updated, ") + to_string(deletions) + _(" mints deleted\n");
@@ -4466,7 +4802,7 @@ string CWallet::ResetSpentZerocoin()
     long removed = 0;
     CWalletDB walletdb(pwalletMain->strWalletFile);
 
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, false);
+    list<CZerocoinMint> listMints = zparaTracker->ListMints(false, false, false);
     list<CZerocoinSpend> listSpends = walletdb.ListSpentCoins();
     list<CZerocoinSpend> listUnconfirmedSpends;
 
@@ -4489,8 +4825,8 @@ string CWallet::ResetSpentZerocoin()
                 removed++;
                 mint.SetUsed(false);
                 RemoveSerialFromDB(spend.GetSerial());
-                walletdb.WriteZerocoinMint(mint);
-                walletdb.EraseZerocoinSpendSerialEntry(spend.GetSerial());
+                zparaTracker->Add(mint);
+                zparaTracker->EraseSpend(spend.GetSerial());
                 continue;
             }
         }
@@ -4523,7 +4859,7 @@ void CWallet::ReconsiderZerocoins(std::list<CZerocoinMint>& listMintsRestored)
 
         mint.SetTxHash(txHash);
         mint.SetHeight(mapBlockIndex.at(hashBlock)->nHeight);
-        if (!walletdb.UnarchiveZerocoin(mint)) {
+        if (!zparaTracker->Unarchive(mint)) {
             LogPrintf("%s : failed to unarchive mint %s\n", __func__, mint.GetValue().GetHex());
         }
         listMintsRestored.emplace_back(mint);
@@ -4606,10 +4942,9 @@ string CWallet::MintZerocoin(CAmount nValue, CWalletTx& wtxNew, vector<CZerocoin
         return _("Error: The transaction was rejected! This might happen if some of the coins in your wallet were already spent, such as if you used a copy of wallet.dat and coins were spent in the copy but not marked as spent here.");
     } else {
         //update mints with full transaction hash and then database them
-        CWalletDB walletdb(pwalletMain->strWalletFile);
         for (CZerocoinMint mint : vMints) {
             mint.SetTxHash(wtxNew.GetHash());
-            walletdb.WriteZerocoinMint(mint);
+            zparaTracker->Add(mint);
             pwalletMain->NotifyZerocoinChanged(pwalletMain, mint.GetValue().GetHex(), "Used", CT_UPDATED);
         }
     }
@@ -4648,13 +4983,13 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
         //reset all mints
         for (CZerocoinMint mint : vMintsSelected) {
             mint.SetUsed(false); // having error, so set to false, to be able to use again
-            walletdb.WriteZerocoinMint(mint);
+            zparaTracker->Add(mint);
             pwalletMain->NotifyZerocoinChanged(pwalletMain, mint.GetValue().GetHex(), "New", CT_UPDATED);
         }
 
         //erase spends
         for (CZerocoinSpend spend : receipt.GetSpends()) {
-            if (!walletdb.EraseZerocoinSpendSerialEntry(spend.GetSerial())) {
+            if (!zparaTracker->EraseSpend(spend.GetSerial())) {
                 receipt.SetStatus("Error: It cannot delete coin serial number in wallet", Zpapara_ERASE_SPENDS_FAILED);
             }
 
@@ -4664,7 +4999,7 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
 
         // erase new mints
         for (auto& mint : vNewMints) {
-            if (!walletdb.EraseZerocoinMint(mint)) {
+            if (!zparaTracker->Erase(mint)) {
                 receipt.SetStatus("Error: Unable to cannot delete zerocoin mint in wallet", Zpapara_ERASE_NEW_MINTS_FAILED);
             }
         }
@@ -4675,7 +5010,7 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
 
     for (CZerocoinMint mint : vMintsSelected) {
         mint.SetUsed(true);
-        if (!walletdb.WriteZerocoinMint(mint)) {
+        if (!zparaTracker->Add(mint)) {
             receipt.SetStatus("Failed to write mint to db", nStatus);
             return false;
         }
@@ -4695,7 +5030,7 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
     // write new Mints to db
     for (CZerocoinMint mint : vNewMints) {
         mint.SetTxHash(wtxNew.GetHash());
-        walletdb.WriteZerocoinMint(mint);
+        zparaTracker->Add(mint);
     }
 
     receipt.SetStatus("Spend Successful", Zpapara_SPEND_OKAY);  // When we reach this point spending zpara was successful
@@ -11,6 +11,7 @@
 
 #include "amount.h"
 #include "base58.h"
+#include "bloom.h"
 #include "crypter.h"
 #include "kernel.h"
 #include "key.h"
@@ -20,6 +21,7 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "zpara/zerocoin.h"
+#include "zpara/zparatracker.h"
 #include "guiinterface.h"
 #include "util.h"
 #include "validationinterface.h"
@@ -158,6 +160,50 @@ public:
     StringMap destdata;
 };
 
+/**
+ * Unspent outputs of the wallet's own transactions, kept up to date as
+ * transactions are added, spent and (dis)connected so that coin queries only
+ * visit candidate outputs instead of every output in mapWallet. Outputs are
+ * bucketed by use and indexed by amount for the denominated and masternode
+ * collateral lookups. Membership only depends on ownership and on spends in
+ * the main chain: the checks that change with time (depth, maturity, locks,
+ * unconfirmed spends) are still applied by the callers.
+ */
+class CWalletUTXOIndex
+{
+public:
+    enum Bucket {
+        UTXO_STAKABLE = (1U << 0), //!< any output but zerocoin mints
+        UTXO_ZEROCOIN = (1U << 1), //!< zerocoin mints
+    };
+
+    void Add(const COutPoint& outpoint, const CTxOut& txout);
+    bool Remove(const COutPoint& outpoint);
+    bool Contains(const COutPoint& outpoint) const { return mapCoins.count(outpoint) > 0; }
+    void clear();
+    size_t size() const { return mapCoins.size(); }
+    size_t size(Bucket bucket) const;
+
+    //! all outpoints, in outpoint order
+    void GetAll(std::vector<COutPoint>& vOutpoints) const;
+    //! outpoints in a bucket, in outpoint order
+    void Get(Bucket bucket, std::vector<COutPoint>& vOutpoints) const;
+    //! outpoints holding exactly one of the amounts, in outpoint order
+    void GetByAmounts(const std::vector<CAmount>& vAmounts, std::vector<COutPoint>& vOutpoints) const;
+
+private:
+    struct CEntry {
+        CAmount nValue;
+        unsigned int nBuckets;
+    };
+    std::map<COutPoint, CEntry> mapCoins;
+    std::set<COutPoint> setStakable;
+    std::set<COutPoint> setZerocoin;
+    std::map<CAmount, std::set<COutPoint> > mapByAmount;
+
+    const std::set<COutPoint>& GetBucket(Bucket bucket) const { return bucket == UTXO_ZEROCOIN ? setZerocoin : setStakable; }
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -188,6 +234,11 @@ private:
     TxSpends mapTxSpends;
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
+    void RemoveFromSpends(const uint256& wtxid);
+
+    //! unspent outputs of mapWallet, see UpdateUTXOIndex
+    CWalletUTXOIndex utxoIndex;
+    bool IsSpentInMainChain(const COutPoint& outpoint) const;
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
@@ -233,6 +284,8 @@ public:
     bool fWalletUnlockAnonymizeOnly;
     std::string strWalletFile;
     bool fBackupMints;
+    //! zerocoin mints and spent serials of the wallet, see CzparaTracker
+    CzparaTracker* zparaTracker;
 
     std::set<int64_t> setKeyPool;
     std::map<CKeyID, CKeyMetadata> mapKeyMetadata;
@@ -246,6 +299,7 @@ public:
     unsigned int nHashInterval;
     uint64_t nStakeSplitThreshold;
     int nStakeSetUpdateTime;
+    CStakeKernelSearch stakeKernelSearch;
 
     //MultiSend
     std::vector<std::pair<std::string, int> > vMultiSend;
@@ -263,6 +317,7 @@ public:
     CWallet()
     {
         SetNull();
+        zparaTracker = new CzparaTracker(strWalletFile);
     }
 
     CWallet(std::string strWalletFileIn)
@@ -271,11 +326,13 @@ public:
 
         strWalletFile = strWalletFileIn;
         fFileBacked = true;
+        zparaTracker = new CzparaTracker(strWalletFile);
     }
 
     ~CWallet()
     {
         delete pwalletdbEncryption;
+        delete zparaTracker;
     }
 
     void SetNull()
@@ -285,6 +342,7 @@ public:
         fFileBacked = false;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
+        zparaTracker = NULL;
         nOrderPosNext = 0;
         nNextResend = 0;
         nLastResend = 0;
@@ -371,6 +429,16 @@ public:
 
     bool IsSpent(const uint256& hash, unsigned int n) const;
 
+    /**
+     * Re-evaluate whether an outpoint belongs in the wallet's unspent output
+     * index. Requires cs_main and cs_wallet.
+     */
+    void UpdateUTXOIndex(const COutPoint& outpoint);
+    void UpdateUTXOIndex(const CWalletTx& wtx);
+    //! rebuild the unspent output index from mapWallet
+    void RebuildUTXOIndex();
+    const CWalletUTXOIndex& GetUTXOIndex() const { return utxoIndex; }
+
     bool IsLockedCoin(uint256 hash, unsigned int n) const;
     void LockCoin(COutPoint& output);
     void UnlockCoin(COutPoint& output);
@@ -453,6 +521,9 @@ public:
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
+    //! A filter that every transaction AddToWalletIfInvolvingMe would add passes
+    CBloomFilter GetRescanFilter() const;
+    //! @return the number of transactions added or updated, -1 if they could not be written
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions();
@@ -32,6 +32,7 @@ class CWallet;
 class CWalletTx;
 class CZerocoinMint;
 class CZerocoinSpend;
+class CMintWitness;
 class uint160;
 class uint256;
 
@@ -154,14 +155,16 @@ public:
     bool ReadZerocoinMint(const CBigNum &bnSerial, CZerocoinMint& zerocoinMint);
     bool ArchiveMintOrphan(const CZerocoinMint& zerocoinMint);
     bool UnarchiveZerocoin(const CZerocoinMint& mint);
-    std::list<CZerocoinMint> ListMintedCoins(bool fUnusedOnly, bool fMaturedOnly, bool fUpdateStatus);
+    std::list<CZerocoinMint> ListMintedCoins();
     std::list<CZerocoinSpend> ListSpentCoins();
-    std::list<CBigNum> ListMintedCoinsSerial();
     std::list<CBigNum> ListSpentCoinsSerial();
     std::list<CZerocoinMint> ListArchivedZerocoins();
     bool WriteZerocoinSpendSerialEntry(const CZerocoinSpend& zerocoinSpend);
     bool EraseZerocoinSpendSerialEntry(const CBigNum& serialEntry);
     bool ReadZerocoinSpendSerialEntry(const CBigNum& bnSerial);
+    bool WriteMintWitness(const CBigNum& bnPubcoin, const CMintWitness& mintWitness);
+    bool ReadMintWitness(const CBigNum& bnPubcoin, CMintWitness& mintWitness);
+    bool EraseMintWitness(const CBigNum& bnPubcoin);
 
 private:
     CWalletDB(const CWalletDB&);
@@ -0,0 +1,91 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/walletrescan.h"
+
+#include "main.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <boost/bind.hpp>
+
+CWalletRescanPipeline::CWalletRescanPipeline(const std::vector<CBlockIndex*>& vIndexIn, const CBloomFilter& filterIn, int nThreads) : vIndex(vIndexIn), filter(filterIn), nNext(0), fStop(false)
+{
+    for (int i = 0; i < std::max(nThreads, 1); i++)
+        threads.create_thread(boost::bind(&CWalletRescanPipeline::ThreadRead, this));
+}
+
+CWalletRescanPipeline::~CWalletRescanPipeline()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fStop = true;
+    }
+    condWorker.notify_all();
+    threads.join_all();
+}
+
+void CWalletRescanPipeline::ThreadRead()
+{
+    RenameThread("papara-rescan");
+    // a copy of its own, as IsRelevantAndUpdate is not const
+    CBloomFilter filterThread(filter);
+    while (true) {
+        CRescanBlockRef item;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (!fStop && nNext < vIndex.size() && queue.size() >= RESCAN_QUEUE_SIZE)
+                condWorker.wait(lock);
+            if (fStop || nNext == vIndex.size())
+                return;
+            item.reset(new CRescanBlock(vIndex[nNext++]));
+            queue.push_back(item);
+        }
+
+        int64_t nTimeStart = GetTimeMicros();
+        item->fRead = ReadBlockFromDisk(item->block, item->pindex);
+        int64_t nTimeRead = GetTimeMicros();
+        item->vMatch.resize(item->block.vtx.size());
+        for (unsigned int i = 0; i < item->block.vtx.size(); i++) {
+            if (filterThread.IsRelevantAndUpdate(item->block.vtx[i])) {
+                item->vMatch[i] = true;
+                item->nMatches++;
+            }
+        }
+        int64_t nTimeFiltered = GetTimeMicros();
+
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            item->fDone = true;
+            stats.nTimeRead += nTimeRead - nTimeStart;
+            stats.nTimeFilter += nTimeFiltered - nTimeRead;
+        }
+        condConsumer.notify_all();
+    }
+}
+
+bool CWalletRescanPipeline::Next(CRescanBlockRef& item)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    boost::unique_lock<boost::mutex> lock(cs);
+    while (queue.empty() ? nNext < vIndex.size() : !queue.front()->fDone)
+        condConsumer.wait(lock);
+    stats.nTimeWait += GetTimeMicros() - nTimeStart;
+    if (queue.empty())
+        return false;
+
+    item = queue.front();
+    queue.pop_front();
+    stats.nBlocks++;
+    stats.nTx += item->block.vtx.size();
+    stats.nMatches += item->nMatches;
+    condWorker.notify_one();
+    return true;
+}
+
+CWalletRescanStats CWalletRescanPipeline::GetStats()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return stats;
+}
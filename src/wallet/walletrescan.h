@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_WALLET_WALLETRESCAN_H
+#define BITCOIN_WALLET_WALLETRESCAN_H
+
+#include "bloom.h"
+#include "primitives/block.h"
+
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class CBlockIndex;
+
+/** Default for -rescanthreads, 0 = one per core besides the rescanning thread */
+static const int DEFAULT_RESCAN_THREADS = 0;
+/** Maximum number of block reading threads during a rescan */
+static const int MAX_RESCAN_THREADS = 8;
+/** Maximum number of blocks read ahead of the one being scanned */
+static const unsigned int RESCAN_QUEUE_SIZE = 64;
+
+/** A block of the rescan, read and filtered by the pipeline */
+struct CRescanBlock {
+    CBlockIndex* pindex;
+    CBlock block;
+    bool fRead;
+    std::vector<bool> vMatch; // per transaction: it passed the wallet's filter
+    unsigned int nMatches;
+
+    bool fDone;
+
+    CRescanBlock(CBlockIndex* pindexIn) : pindex(pindexIn), fRead(false), nMatches(0), fDone(false) {}
+};
+
+typedef boost::shared_ptr<CRescanBlock> CRescanBlockRef;
+
+struct CWalletRescanStats {
+    uint64_t nBlocks;
+    uint64_t nTx;
+    uint64_t nMatches;
+    int64_t nTimeRead;   // workers: reading and deserializing blocks (us)
+    int64_t nTimeFilter; // workers: matching transactions against the filter (us)
+    int64_t nTimeWait;   // consumer: waiting for the next block (us)
+
+    CWalletRescanStats() : nBlocks(0), nTx(0), nMatches(0), nTimeRead(0), nTimeFilter(0), nTimeWait(0) {}
+};
+
+/**
+ * Read-ahead pipeline for CWallet::ScanForWalletTransactions.
+ *
+ * Worker threads read the blocks from disk and match their transactions
+ * against a bloom filter of the wallet's keys, scripts, transactions and
+ * outpoints, and Next() hands the blocks out in chain order to the caller,
+ * which only needs to look at the transactions that passed. Neither the
+ * workers nor the pipeline take cs_main or cs_wallet.
+ *
+ * The filter is taken as it is when the pipeline starts: spends of outputs
+ * the rescan finds later are left for the caller to pick up.
+ */
+class CWalletRescanPipeline
+{
+private:
+    // Disallow copies
+    CWalletRescanPipeline(const CWalletRescanPipeline&);
+    CWalletRescanPipeline& operator=(const CWalletRescanPipeline&);
+
+    const std::vector<CBlockIndex*> vIndex;
+    const CBloomFilter filter;
+
+    boost::mutex cs;
+    boost::condition_variable condWorker;
+    boost::condition_variable condConsumer;
+    std::deque<CRescanBlockRef> queue; // blocks in chain order
+    unsigned int nNext;                // next block of vIndex to be picked up by a worker
+    bool fStop;
+    CWalletRescanStats stats;
+
+    boost::thread_group threads;
+
+    void ThreadRead();
+
+public:
+    CWalletRescanPipeline(const std::vector<CBlockIndex*>& vIndexIn, const CBloomFilter& filterIn, int nThreads);
+    ~CWalletRescanPipeline();
+
+    /**
+     * Wait for the next block in chain order.
+     * @return false once all blocks were handed out
+     */
+    bool Next(CRescanBlockRef& item);
+
+    CWalletRescanStats GetStats();
+};
+
+#endif // BITCOIN_WALLET_WALLETRESCAN_H
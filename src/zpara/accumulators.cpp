@@ -187,45 +187,33 @@ bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint)
         mapAccumulators.Reset();
     }
 
-    while (pindex->nHeight < nHeight - 10) {
+    //grab the mints of the blocks eligible for accumulation
+    int nHeightStart = std::max(pindex->nHeight, Params().Zerocoin_AccumulatorStartHeight());
+    std::map<int, std::list<PublicCoin> > mapPubcoins;
+    if (!GetBlockRangePubcoins(nHeightStart, nHeight - 10, ZQ_ERROR, mapPubcoins)) {
+        LogPrint("zero","%s: failed to get zerocoin mintlist from blocks %d-%d\n", __func__, nHeightStart, nHeight - 11);
+        return false;
+    }
+
+    for (const auto& blockPubcoins : mapPubcoins) {
         // checking whether we should stop this process due to a shutdown request
         if (ShutdownRequested()) {
             return false;
         }
 
-        //make sure this block is eligible for accumulation
-        if (pindex->nHeight < Params().Zerocoin_AccumulatorStartHeight()) {
-            pindex = chainActive[pindex->nHeight + 1];
-            continue;
-        }
-
-        //grab mints from this block
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex)) {
-            LogPrint("zero","%s: failed to read block from disk\n", __func__);
-            return false;
-        }
-
-        std::list<PublicCoin> listPubcoins;
-        if (!BlockToPubcoinList(block, listPubcoins)) {
-            LogPrint("zero","%s: failed to get zerocoin mintlist from block %n\n", __func__, pindex->nHeight);
-            return false;
-        }
-
-        nTotalMintsFound += listPubcoins.size();
-        LogPrint("zero", "%s found %d mints\n", __func__, listPubcoins.size());
+        nTotalMintsFound += blockPubcoins.second.size();
+        LogPrint("zero", "%s found %d mints\n", __func__, blockPubcoins.second.size());
 
         //add the pubcoins to accumulator
-        for (const PublicCoin pubcoin : listPubcoins) {
+        for (const PublicCoin pubcoin : blockPubcoins.second) {
             if (!pubcoin.validate())
                 continue;
 
             if(!mapAccumulators.Accumulate(pubcoin, true)) {
-                LogPrintf("%s: failed to add pubcoin to accumulator at height %n\n", __func__, pindex->nHeight);
+                LogPrintf("%s: failed to add pubcoin to accumulator at height %d\n", __func__, blockPubcoins.first);
                 return false;
             }
         }
-        pindex = chainActive.Next(pindex);
     }
 
     // if there were no new mints found, the accumulator checkpoint will be the same as the last checkpoint
@@ -247,7 +235,7 @@ bool InvalidCheckpointRange(int nHeight)
     return nHeight > Params().Zerocoin_Block_LastGoodCheckpoint() && nHeight < Params().Zerocoin_Block_RecalculateAccumulators();
 }
 
-bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError)
+bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError, CMintWitness* pMintWitness)
 {
     uint256 txid;
     if (!zerocoinDB->ReadCoinMint(coin.getValue(), txid)) {
@@ -263,27 +251,15 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
     }
 
     int nHeightMintAdded= mapBlockIndex[hashBlock]->nHeight;
-    uint256 nCheckpointBeforeMint = 0;
-    CBlockIndex* pindex = chainActive[nHeightMintAdded];
-    int nChanges = 0;
 
     //find the checksum when this was added to the accumulator officially, which will be two checksum changes later
     //reminder that checksums are generated when the block height is a multiple of 10
-    while (pindex->nHeight < chainActive.Tip()->nHeight - 1) {
-        if (pindex->nHeight == nHeightMintAdded) {
-            pindex = chainActive[pindex->nHeight + 1];
-            continue;
-        }
-
-        //check if the next checksum was generated
-        if (pindex->nHeight % 10 == 0) {
-            nChanges++;
-
-            if (nChanges == 1)
-                nCheckpointBeforeMint = pindex->nAccumulatorCheckpoint;
-        }
-        pindex = chainActive.Next(pindex);
-    }
+    int nHeightTip = chainActive.Tip()->nHeight;
+    uint256 nCheckpointBeforeMint = 0;
+    int nHeightFirstChange = nHeightMintAdded + 10 - (nHeightMintAdded % 10);
+    if (nHeightFirstChange < nHeightTip - 1)
+        nCheckpointBeforeMint = chainActive[nHeightFirstChange]->nAccumulatorCheckpoint;
+    CBlockIndex* pindex = chainActive[std::max(nHeightMintAdded, nHeightTip - 1)];
 
     //the height to start accumulating coins to add to witness
     int nAccStartHeight = nHeightMintAdded - (nHeightMintAdded % 10);
@@ -297,15 +273,6 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
         nAccStartHeight = nHeight_LastGoodCheckpoint - 10;
     }
 
-    //Get the accumulator that is right before the cluster of blocks containing our mint was added to the accumulator
-    CBigNum bnAccValue = 0;
-    if (GetAccumulatorValueFromDB(nCheckpointBeforeMint, coin.getDenomination(), bnAccValue)) {
-        if (bnAccValue > 0) {
-            accumulator.setValue(bnAccValue);
-            witness.resetValue(accumulator, coin);
-        }
-    }
-
     //security level: this is an important prevention of tracing the coins via timing. Security level represents how many checkpoints
     //of accumulated coins are added *beyond* the checkpoint that the mint being spent was added too. If each spend added the exact same
     //amounts of checkpoints after the mint was accumulated, then you could know the range of blocks that the mint originated from.
@@ -318,14 +285,52 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
             nSecurityLevel = 99;
     }
 
-    //add the pubcoins (zerocoinmints that have been published to the chain) up to the next checksum starting from the block
-    pindex = chainActive[nAccStartHeight];
     int nChainHeight = chainActive.Height();
     int nHeightStop = nChainHeight % 10;
     nHeightStop = nChainHeight - nHeightStop - 20; // at least two checkpoints deep
+
+    //a witness kept from an earlier spend is for the same blocks if the mint and the last block it covers are still on the
+    //active chain, and can be extended if this spend would not have stopped accumulating before reaching its end
+    bool fKnownStart = pMintWitness && !pMintWitness->IsNull() && pMintWitness->hashBlockMint == hashBlock &&
+                       pMintWitness->nHeightAccStart == nAccStartHeight;
+    bool fKeptOnChain = fKnownStart && chainActive[pMintWitness->nHeightAccEnd - 1] &&
+                        chainActive[pMintWitness->nHeightAccEnd - 1]->GetBlockHash() == pMintWitness->hashBlockAccEnd;
+    bool fResume = fKeptOnChain && pMintWitness->nHeightAccEnd <= nHeightStop &&
+                   (nSecurityLevel == 100 || pMintWitness->nCheckpointsAdded < nSecurityLevel);
+
     int nCheckpointsAdded = 0;
     nMintsAdded = 0;
+    if (fResume) {
+        accumulator.setValue(pMintWitness->bnWitness);
+        witness.resetValue(accumulator, coin);
+        nCheckpointsAdded = pMintWitness->nCheckpointsAdded;
+        nMintsAdded = pMintWitness->nMintsAdded;
+        pindex = chainActive[pMintWitness->nHeightAccEnd];
+    } else {
+        //Get the accumulator that is right before the cluster of blocks containing our mint was added to the accumulator
+        CBigNum bnAccValue = 0;
+        if (GetAccumulatorValueFromDB(nCheckpointBeforeMint, coin.getDenomination(), bnAccValue)) {
+            if (bnAccValue > 0) {
+                accumulator.setValue(bnAccValue);
+                witness.resetValue(accumulator, coin);
+            }
+        }
+        pindex = chainActive[nAccStartHeight];
+    }
+
+    //the pubcoins of the denomination from the pubcoin index, by height
+    map<int, list<PublicCoin> > mapPubcoins;
+    if (!GetBlockRangePubcoins(pindex->nHeight, nHeightStop, coin.getDenomination(), mapPubcoins)) {
+        LogPrintf("%s: failed to get zerocoin mintlist from blocks %d-%d\n", __func__, pindex->nHeight, nHeightStop - 1);
+        return false;
+    }
+
+    //add the pubcoins (zerocoinmints that have been published to the chain) up to the next checksum starting from the block
+    int nHeightAccEnd = 0;
+    int nCheckpointsBeforeEnd = 0;
+    CBigNum bnWitness = 0;
     while (pindex->nHeight < nHeightStop + 1) {
+        int nCheckpointsBefore = nCheckpointsAdded;
         if (pindex->nHeight != nAccStartHeight && pindex->pprev->nAccumulatorCheckpoint != pindex->nAccumulatorCheckpoint)
             ++nCheckpointsAdded;
 
@@ -338,30 +343,17 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
                 LogPrintf("%s : failed to find checksum in database for accumulator\n", __func__);
                 return false;
             }
+            nHeightAccEnd = pindex->nHeight;
+            nCheckpointsBeforeEnd = nCheckpointsBefore;
+            bnWitness = witness.getValue();
             accumulator.setValue(bnAccValue);
             break;
         }
 
         // if this block contains mints of the denomination that is being spent, then add them to the witness
-        if (pindex->MintedDenomination(coin.getDenomination())) {
-            //grab mints from this block
-            CBlock block;
-            if(!ReadBlockFromDisk(block, pindex)) {
-                LogPrintf("%s: failed to read block from disk while adding pubcoins to witness\n", __func__);
-                return false;
-            }
-
-            list<PublicCoin> listPubcoins;
-            if(!BlockToPubcoinList(block, listPubcoins)) {
-                LogPrintf("%s: failed to get zerocoin mintlist from block %n\n", __func__, pindex->nHeight);
-                return false;
-            }
-
-            //add the mints to the witness
-            for (const PublicCoin pubcoin : listPubcoins) {
-                if (pubcoin.getDenomination() != coin.getDenomination())
-                    continue;
-
+        map<int, list<PublicCoin> >::const_iterator it = mapPubcoins.find(pindex->nHeight);
+        if (it != mapPubcoins.end()) {
+            for (const PublicCoin& pubcoin : it->second) {
                 if (pindex->nHeight == nHeightMintAdded && pubcoin.getValue() == coin.getValue())
                     continue;
 
@@ -372,6 +364,7 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
 
         pindex = chainActive[pindex->nHeight + 1];
     }
+    int nPubcoinsAdded = nMintsAdded;
 
     if (nMintsAdded < Params().Zerocoin_RequiredAccumulation()) {
         strError = _(strprintf("Less than %d mints added, unable to create spend", Params().Zerocoin_RequiredAccumulation()).c_str());
@@ -380,14 +373,30 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
     }
 
     // calculate how many mints of this denomination existed in the accumulator we initialized
-    int nZerocoinStartHeight = GetZerocoinStartHeight();
-    pindex = chainActive[nZerocoinStartHeight];
-    while (pindex->nHeight < nAccStartHeight) {
-        nMintsAdded += count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), coin.getDenomination());
-        pindex = chainActive[pindex->nHeight + 1];
+    if (fKnownStart) {
+        nMintsAdded += pMintWitness->nMintsBefore;
+    } else {
+        int nZerocoinStartHeight = GetZerocoinStartHeight();
+        pindex = chainActive[nZerocoinStartHeight];
+        while (pindex->nHeight < nAccStartHeight) {
+            nMintsAdded += count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), coin.getDenomination());
+            pindex = chainActive[pindex->nHeight + 1];
+        }
+    }
+
+    //keep the witness for the next spend, unless it ends before the one already kept
+    if (pMintWitness && nHeightAccEnd > nAccStartHeight && (!fKeptOnChain || nHeightAccEnd >= pMintWitness->nHeightAccEnd)) {
+        pMintWitness->hashBlockMint = hashBlock;
+        pMintWitness->nHeightAccStart = nAccStartHeight;
+        pMintWitness->nHeightAccEnd = nHeightAccEnd;
+        pMintWitness->hashBlockAccEnd = chainActive[nHeightAccEnd - 1]->GetBlockHash();
+        pMintWitness->nCheckpointsAdded = nCheckpointsBeforeEnd;
+        pMintWitness->nMintsAdded = nPubcoinsAdded;
+        pMintWitness->nMintsBefore = nMintsAdded - nPubcoinsAdded;
+        pMintWitness->bnWitness = bnWitness;
     }
 
-    LogPrint("zero","%s : %d mints added to witness\n", __func__, nMintsAdded);
+    LogPrint("zero","%s : %d mints added to witness%s\n", __func__, nMintsAdded, fResume ? " (resumed)" : "");
     return true;
 }
 map<CoinDenomination, int> GetMintMaturityHeight()
@@ -9,10 +9,62 @@
 #include "libzerocoin/Denominations.h"
 #include "libzerocoin/Coin.h"
 #include "zpara/zerocoin.h"
+#include "serialize.h"
 #include "uint256.h"
+
+/**
+ * A mint's accumulator witness as far as the wallet has computed it, so that the
+ * next spend of the mint only has to add the pubcoins minted since.
+ */
+class CMintWitness
+{
+public:
+    uint256 hashBlockMint;   // block the mint was included in
+    int nHeightAccStart;     // first block whose pubcoins are in the witness
+    int nHeightAccEnd;       // the witness holds the pubcoins of blocks [nHeightAccStart, nHeightAccEnd)
+    uint256 hashBlockAccEnd; // hash of block nHeightAccEnd - 1, a reorg below it invalidates the witness
+    int nCheckpointsAdded;   // accumulator checkpoints passed in [nHeightAccStart, nHeightAccEnd)
+    int nMintsAdded;         // pubcoins added to the witness
+    int nMintsBefore;        // mints of the denomination below nHeightAccStart
+    CBigNum bnWitness;
+
+    CMintWitness()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        hashBlockMint = 0;
+        nHeightAccStart = 0;
+        nHeightAccEnd = 0;
+        hashBlockAccEnd = 0;
+        nCheckpointsAdded = 0;
+        nMintsAdded = 0;
+        nMintsBefore = 0;
+        bnWitness = 0;
+    }
+
+    bool IsNull() const { return nHeightAccEnd == 0; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(hashBlockMint);
+        READWRITE(nHeightAccStart);
+        READWRITE(nHeightAccEnd);
+        READWRITE(hashBlockAccEnd);
+        READWRITE(nCheckpointsAdded);
+        READWRITE(nMintsAdded);
+        READWRITE(nMintsBefore);
+        READWRITE(bnWitness);
+    };
+};
+
 std::map<libzerocoin::CoinDenomination, int> GetMintMaturityHeight();
 
-bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError);
+bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError, CMintWitness* pMintWitness = NULL);
 bool GetAccumulatorValueFromDB(uint256 nCheckpoint, libzerocoin::CoinDenomination denom, CBigNum& bnAccValue);
 bool GetAccumulatorValueFromChecksum(uint32_t nChecksum, bool fMemoryOnly, CBigNum& bnAccValue);
 void AddAccumulatorChecksum(const uint32_t nChecksum, const CBigNum &bnValue, bool fMemoryOnly);
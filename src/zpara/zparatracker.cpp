@@ -0,0 +1,233 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zpara/zparatracker.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "main.h"
+#include "util.h"
+#include "wallet/walletdb.h"
+
+#include <algorithm>
+#include <vector>
+
+void CzparaTracker::AddToMaps(const CZerocoinMint& mint)
+{
+    uint256 hashPubcoin = GetPubCoinHash(mint.GetValue());
+    CMintEntry& entry = mapMints[hashPubcoin];
+    if (entry.mint.GetHeight() != mint.GetHeight())
+        mapAccumulated.erase(hashPubcoin);
+    if (entry.hashSerial != 0)
+        mapSerialHashes.erase(entry.hashSerial);
+    entry.mint = mint;
+    entry.hashSerial = GetSerialHash(mint.GetSerialNumber());
+    mapSerialHashes[entry.hashSerial] = hashPubcoin;
+}
+
+void CzparaTracker::RemoveFromMaps(const CZerocoinMint& mint)
+{
+    uint256 hashPubcoin = GetPubCoinHash(mint.GetValue());
+    std::map<uint256, CMintEntry>::iterator it = mapMints.find(hashPubcoin);
+    if (it == mapMints.end())
+        return;
+    std::map<uint256, uint256>::iterator itSerial = mapSerialHashes.find(it->second.hashSerial);
+    if (itSerial != mapSerialHashes.end() && itSerial->second == hashPubcoin)
+        mapSerialHashes.erase(itSerial);
+    mapAccumulated.erase(hashPubcoin);
+    mapMints.erase(it);
+}
+
+void CzparaTracker::Init()
+{
+    CWalletDB walletdb(strWalletFile);
+    std::list<CZerocoinMint> listMints = walletdb.ListMintedCoins();
+    std::list<CZerocoinSpend> listSpends = walletdb.ListSpentCoins();
+
+    LOCK(cs_tracker);
+    mapMints.clear();
+    mapSerialHashes.clear();
+    setSpentSerialHashes.clear();
+    mapAccumulated.clear();
+    for (const CZerocoinMint& mint : listMints)
+        AddToMaps(mint);
+    for (const CZerocoinSpend& spend : listSpends)
+        setSpentSerialHashes.insert(GetSerialHash(spend.GetSerial()));
+    LogPrintf("%s : %u zerocoin mints, %u spent serials\n", __func__, mapMints.size(), setSpentSerialHashes.size());
+}
+
+bool CzparaTracker::Add(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    if (!CWalletDB(strWalletFile).WriteZerocoinMint(mint))
+        return false;
+    AddToMaps(mint);
+    return true;
+}
+
+bool CzparaTracker::Erase(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    if (!CWalletDB(strWalletFile).EraseZerocoinMint(mint))
+        return false;
+    RemoveFromMaps(mint);
+    return true;
+}
+
+bool CzparaTracker::Archive(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    if (!CWalletDB(strWalletFile).ArchiveMintOrphan(mint))
+        return false;
+    RemoveFromMaps(mint);
+    return true;
+}
+
+bool CzparaTracker::Unarchive(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    if (!CWalletDB(strWalletFile).UnarchiveZerocoin(mint))
+        return false;
+    AddToMaps(mint);
+    return true;
+}
+
+bool CzparaTracker::AddSpend(const CZerocoinSpend& spend)
+{
+    LOCK(cs_tracker);
+    if (!CWalletDB(strWalletFile).WriteZerocoinSpendSerialEntry(spend))
+        return false;
+    setSpentSerialHashes.insert(GetSerialHash(spend.GetSerial()));
+    return true;
+}
+
+bool CzparaTracker::EraseSpend(const CBigNum& bnSerial)
+{
+    LOCK(cs_tracker);
+    if (!CWalletDB(strWalletFile).EraseZerocoinSpendSerialEntry(bnSerial))
+        return false;
+    setSpentSerialHashes.erase(GetSerialHash(bnSerial));
+    return true;
+}
+
+bool CzparaTracker::HasSpend(const CBigNum& bnSerial) const
+{
+    LOCK(cs_tracker);
+    return setSpentSerialHashes.count(GetSerialHash(bnSerial)) > 0;
+}
+
+bool CzparaTracker::HasUnusedSerial(const CBigNum& bnSerial) const
+{
+    uint256 hashSerial = GetSerialHash(bnSerial);
+    LOCK(cs_tracker);
+    std::map<uint256, uint256>::const_iterator it = mapSerialHashes.find(hashSerial);
+    if (it == mapSerialHashes.end() || setSpentSerialHashes.count(hashSerial))
+        return false;
+    return !mapMints.at(it->second).mint.IsUsed();
+}
+
+bool CzparaTracker::IsAccumulated(const uint256& hashPubcoin, const CZerocoinMint& mint)
+{
+    // 30 just to make sure that it is at least 2 checkpoints from the top block
+    std::map<uint256, const CBlockIndex*>::iterator mi = mapAccumulated.find(hashPubcoin);
+    if (mi != mapAccumulated.end()) {
+        if (chainActive.Contains(mi->second) && mi->second->nHeight < chainActive.Height() - 30)
+            return true;
+        mapAccumulated.erase(mi);
+    }
+
+    // check to make sure there are at least 3 other mints added to the accumulators after this
+    if (chainActive.Height() < mint.GetHeight() + 1)
+        return false;
+
+    CBlockIndex* pindex = chainActive[mint.GetHeight() + 1];
+    int nMintsAdded = 0;
+    while (pindex->nHeight < chainActive.Height() - 30) {
+        nMintsAdded += count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), mint.GetDenomination());
+        if (nMintsAdded >= Params().Zerocoin_RequiredAccumulation()) {
+            mapAccumulated[hashPubcoin] = pindex;
+            return true;
+        }
+        pindex = chainActive[pindex->nHeight + 1];
+    }
+
+    return nMintsAdded >= Params().Zerocoin_RequiredAccumulation();
+}
+
+std::list<CZerocoinMint> CzparaTracker::ListMints(bool fUnusedOnly, bool fMatureOnly, bool fUpdateStatus)
+{
+    std::list<CZerocoinMint> listMints;
+    std::vector<CZerocoinMint> vOverWrite;
+    std::vector<CZerocoinMint> vArchive;
+    {
+        LOCK2(cs_main, cs_tracker);
+        for (std::map<uint256, CMintEntry>::const_iterator it = mapMints.begin(); it != mapMints.end(); ++it) {
+            CZerocoinMint mint = it->second.mint;
+
+            if (fUnusedOnly) {
+                if (mint.IsUsed())
+                    continue;
+
+                //double check that we have no record of this serial being used
+                if (setSpentSerialHashes.count(it->second.hashSerial)) {
+                    mint.SetUsed(true);
+                    vOverWrite.push_back(mint);
+                    continue;
+                }
+            }
+
+            if (fMatureOnly || fUpdateStatus) {
+                //if there is not a record of the block height, then look it up and assign it
+                if (!mint.GetHeight()) {
+                    CTransaction tx;
+                    uint256 hashBlock;
+                    if (!GetTransaction(mint.GetTxHash(), tx, hashBlock, true)) {
+                        LogPrintf("%s failed to find tx for mint txid=%s\n", __func__, mint.GetTxHash().GetHex());
+                        vArchive.push_back(mint);
+                        continue;
+                    }
+
+                    //if not in the block index, most likely is unconfirmed tx
+                    if (mapBlockIndex.count(hashBlock)) {
+                        mint.SetHeight(mapBlockIndex[hashBlock]->nHeight);
+                        vOverWrite.push_back(mint);
+                    } else if (fMatureOnly) {
+                        continue;
+                    }
+                }
+
+                //not mature
+                if (mint.GetHeight() > chainActive.Height() - Params().Zerocoin_MintRequiredConfirmations()) {
+                    if (!fMatureOnly)
+                        listMints.push_back(mint);
+                    continue;
+                }
+
+                if (fMatureOnly && !IsAccumulated(it->first, mint))
+                    continue;
+            }
+            listMints.push_back(mint);
+        }
+    }
+
+    //overwrite any updates
+    for (const CZerocoinMint& mint : vOverWrite) {
+        if (!Add(mint))
+            LogPrintf("%s failed to update mint from tx %s\n", __func__, mint.GetTxHash().GetHex());
+    }
+
+    // archive mints
+    for (const CZerocoinMint& mint : vArchive) {
+        if (!Archive(mint))
+            LogPrintf("%s failed to archive mint from %s\n", __func__, mint.GetTxHash().GetHex());
+    }
+
+    return listMints;
+}
+
+unsigned int CzparaTracker::size() const
+{
+    LOCK(cs_tracker);
+    return mapMints.size();
+}
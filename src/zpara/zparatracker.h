@@ -0,0 +1,84 @@
+// Copyright (c) 2019 The papara developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef papara_ZPARATRACKER_H
+#define papara_ZPARATRACKER_H
+
+#include "sync.h"
+#include "uint256.h"
+#include "zpara/zerocoin.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+class CBlockIndex;
+
+/**
+ * The wallet's zerocoin mints and spent serials, kept in memory.
+ *
+ * Loaded from the wallet database once, by Init(), and written through to it
+ * by every change, so that balance queries, coin selection and the spend
+ * checks of block validation no longer scan the "zerocoin" records with a
+ * database cursor. Mints are indexed by the hash of their pubcoin (the key of
+ * their database record) and by the hash of their serial. Mint heights and
+ * used flags found by ListMints() are written back, as before; the block at
+ * which a mint had enough mints of its denomination accumulated after it is
+ * cached, for as long as that block stays in the active chain.
+ */
+class CzparaTracker
+{
+private:
+    struct CMintEntry {
+        CZerocoinMint mint;
+        uint256 hashSerial;
+    };
+
+    mutable CCriticalSection cs_tracker;
+    std::string strWalletFile;
+    std::map<uint256, CMintEntry> mapMints;             // by pubcoin hash
+    std::map<uint256, uint256> mapSerialHashes;         // serial hash to pubcoin hash
+    std::set<uint256> setSpentSerialHashes;             // serials of the wallet's own spends ("zcserial" records)
+    std::map<uint256, const CBlockIndex*> mapAccumulated; // pubcoin hash to the block its accumulation was found complete at
+
+    void AddToMaps(const CZerocoinMint& mint);
+    void RemoveFromMaps(const CZerocoinMint& mint);
+    bool IsAccumulated(const uint256& hashPubcoin, const CZerocoinMint& mint);
+
+public:
+    CzparaTracker(const std::string& strWalletFileIn) : strWalletFile(strWalletFileIn) {}
+
+    //! Load the mints and spent serials from the wallet database
+    void Init();
+
+    //! Add or update a mint
+    bool Add(const CZerocoinMint& mint);
+    //! Drop a mint from the database
+    bool Erase(const CZerocoinMint& mint);
+    //! Move a mint that did not make it into the chain to the orphan archive
+    bool Archive(const CZerocoinMint& mint);
+    //! Move a mint back from the orphan archive
+    bool Unarchive(const CZerocoinMint& mint);
+
+    //! Record a serial spent by the wallet
+    bool AddSpend(const CZerocoinSpend& spend);
+    bool EraseSpend(const CBigNum& bnSerial);
+    bool HasSpend(const CBigNum& bnSerial) const;
+
+    //! Whether the serial belongs to one of the wallet's unused mints
+    bool HasUnusedSerial(const CBigNum& bnSerial) const;
+
+    /**
+     * The mints of the wallet, as CWalletDB::ListMintedCoins used to list them.
+     * @param[in] fUnusedOnly   skip the mints that are used or whose serial the wallet spent
+     * @param[in] fMatureOnly   only the mints that are confirmed and accumulated enough to be spent
+     * @param[in] fUpdateStatus look up the heights of mints without one, and archive the ones not found
+     */
+    std::list<CZerocoinMint> ListMints(bool fUnusedOnly, bool fMatureOnly, bool fUpdateStatus);
+
+    unsigned int size() const;
+};
+
+#endif //papara_ZPARATRACKER_H